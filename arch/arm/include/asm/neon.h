@@ -8,6 +8,7 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/types.h>
 #include <asm/hwcap.h>
 
 #define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
@@ -34,3 +35,17 @@
 void kernel_neon_begin(void);
 #endif
 void kernel_neon_end(void);
+
+#ifdef CONFIG_ARM_NEON_COPY
+/* NEON bodies, only valid inside kernel_neon_begin()/kernel_neon_end() */
+extern void *memcpy_neon(void *dst, const void *src, size_t n);
+extern void memzero_neon(void *p, size_t n);
+extern void copy_page_neon(void *to, const void *from);
+
+/* dispatchers, fall back to the integer routines when NEON can't be used */
+extern void *neon_memcpy(void *dst, const void *src, size_t n);
+extern void neon_memzero(void *p, size_t n);
+#else
+#define neon_memcpy(dst, src, n)	memcpy(dst, src, n)
+#define neon_memzero(p, n)		memset(p, 0, n)
+#endif
@@ -150,6 +150,9 @@ extern void __cpu_copy_user_highpage(struct page *to, struct page *from,
 
 #define clear_page(page)	memset((void *)(page), 0, PAGE_SIZE)
 extern void copy_page(void *to, const void *from);
+#ifdef CONFIG_ARM_NEON_COPY
+extern void copy_page_arm(void *to, const void *from);
+#endif
 
 typedef unsigned long pteval_t;
 
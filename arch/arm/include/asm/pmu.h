@@ -88,4 +88,46 @@ init_pmu(enum arm_pmu_type device)
 
 #endif /* CONFIG_CPU_HAS_PMU */
 
+#ifdef CONFIG_HW_PERF_EVENTS
+
+/**
+ * armpmu_reserve_counters() - keep perf off platform-owned counters
+ * @mask: bitmask of counter indices, as numbered by the CPU PMU driver
+ */
+extern void
+armpmu_reserve_counters(unsigned long mask);
+
+/**
+ * armpmu_cpu_save() - fold running events and save reserved counters
+ * before the core loses power
+ */
+extern void
+armpmu_cpu_save(void);
+
+/**
+ * armpmu_cpu_restore() - reprogram running events and reserved counters
+ * after a power-down
+ */
+extern void
+armpmu_cpu_restore(void);
+
+#else /* CONFIG_HW_PERF_EVENTS */
+
+static inline void
+armpmu_reserve_counters(unsigned long mask)
+{
+}
+
+static inline void
+armpmu_cpu_save(void)
+{
+}
+
+static inline void
+armpmu_cpu_restore(void)
+{
+}
+
+#endif /* CONFIG_HW_PERF_EVENTS */
+
 #endif /* __ARM_PMU_H__ */
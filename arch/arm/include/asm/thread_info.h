@@ -62,6 +62,13 @@ struct thread_info {
 	struct crunch_state	crunchstate;
 	union fp_state		fpstate __attribute__((aligned(8)));
 	union vfp_state		vfpstate;
+#ifdef CONFIG_VFP
+	__u32			vfp_traps;	/* lazy restore traps taken */
+	__u32			vfp_eager;	/* eager restores at switch in */
+	__u8			vfp_history;	/* VFP used in recent lazy slices */
+	__u8			vfp_eager_left;	/* eager slices before next probe */
+	__u8			vfp_eager_slice; /* this slice was eagerly restored */
+#endif
 #ifdef CONFIG_ARM_THUMBEE
 	unsigned long		thumbee_state;	/* ThumbEE Handler Base register */
 #endif
@@ -12,6 +12,7 @@
  */
 #define pr_fmt(fmt) "hw perfevents: " fmt
 
+#include <linux/cpu.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -80,6 +81,8 @@ struct arm_pmu {
 	void		(*start)(void);
 	void		(*stop)(void);
 	void		(*reset)(void *);
+	void		(*save_reserved)(void);
+	void		(*restore_reserved)(void);
 	const unsigned	(*cache_map)[PERF_COUNT_HW_CACHE_MAX]
 				    [PERF_COUNT_HW_CACHE_OP_MAX]
 				    [PERF_COUNT_HW_CACHE_RESULT_MAX];
@@ -92,6 +95,20 @@ struct arm_pmu {
 /* Set at runtime when we know what CPU type we are. */
 static const struct arm_pmu *armpmu;
 
+/*
+ * Counter indices owned by platform code (for example a load monitor
+ * programmed through the external debug interface). The CPU-specific
+ * driver never hands these out and must not reset them.
+ */
+static unsigned long armpmu_reserved_mask;
+
+void
+armpmu_reserve_counters(unsigned long mask)
+{
+	armpmu_reserved_mask = mask;
+}
+EXPORT_SYMBOL_GPL(armpmu_reserve_counters);
+
 enum arm_perf_pmu_ids
 armpmu_get_pmu_id(void)
 {
@@ -611,6 +628,78 @@ static void armpmu_disable(struct pmu *pmu)
 		armpmu->stop();
 }
 
+/*
+ * The counters lose their state when the core is powered down. Platform
+ * code brackets a power-down with these two calls so that running events
+ * are folded into their counts before the state is lost and reprogrammed
+ * on the way back up. Both run on the CPU concerned with IRQs disabled.
+ */
+void
+armpmu_cpu_save(void)
+{
+	struct cpu_hw_events *cpuc = &__get_cpu_var(cpu_hw_events);
+	int idx;
+
+	if (!armpmu)
+		return;
+
+	if (armpmu->save_reserved)
+		armpmu->save_reserved();
+
+	if (!atomic_read(&active_events))
+		return;
+
+	armpmu->stop();
+
+	for (idx = 0; idx <= armpmu->num_events; ++idx) {
+		struct perf_event *event = cpuc->events[idx];
+
+		if (!event || !test_bit(idx, cpuc->active_mask))
+			continue;
+
+		if (!(event->hw.state & PERF_HES_STOPPED))
+			armpmu_event_update(event, &event->hw, idx, 0);
+	}
+}
+EXPORT_SYMBOL_GPL(armpmu_cpu_save);
+
+void
+armpmu_cpu_restore(void)
+{
+	struct cpu_hw_events *cpuc = &__get_cpu_var(cpu_hw_events);
+	int idx, enabled = 0;
+
+	if (!armpmu)
+		return;
+
+	if (!atomic_read(&active_events))
+		goto out;
+
+	armpmu->reset(NULL);
+
+	for (idx = 0; idx <= armpmu->num_events; ++idx) {
+		struct perf_event *event = cpuc->events[idx];
+
+		if (!event || !test_bit(idx, cpuc->active_mask))
+			continue;
+
+		if (event->hw.state & PERF_HES_STOPPED)
+			continue;
+
+		armpmu_event_set_period(event, &event->hw, idx);
+		armpmu->enable(&event->hw, idx);
+		enabled = 1;
+	}
+
+out:
+	if (armpmu->restore_reserved)
+		armpmu->restore_reserved();
+
+	if (enabled)
+		armpmu->start();
+}
+EXPORT_SYMBOL_GPL(armpmu_cpu_restore);
+
 static struct pmu pmu = {
 	.pmu_enable	= armpmu_enable,
 	.pmu_disable	= armpmu_disable,
@@ -640,6 +729,40 @@ armpmu_reset(void)
 }
 arch_initcall(armpmu_reset);
 
+/*
+ * A core coming back from hotplug starts with the PMU in an unknown
+ * state; bring it to the same state armpmu_reset() leaves the others in.
+ * Counters reserved by platform code are saved on the way down and put
+ * back on the way up, both on the CPU concerned with IRQs disabled.
+ */
+static int __cpuinit
+armpmu_cpu_notify(struct notifier_block *b, unsigned long action, void *hcpu)
+{
+	if (!armpmu)
+		return NOTIFY_DONE;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DYING:
+		if (armpmu->save_reserved)
+			armpmu->save_reserved();
+		break;
+	case CPU_STARTING:
+		if (armpmu->reset)
+			armpmu->reset(NULL);
+		if (armpmu->restore_reserved)
+			armpmu->restore_reserved();
+		break;
+	default:
+		return NOTIFY_DONE;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata armpmu_cpu_notifier = {
+	.notifier_call = armpmu_cpu_notify,
+};
+
 static int __init
 init_hw_perf_events(void)
 {
@@ -686,6 +809,7 @@ init_hw_perf_events(void)
 	}
 
 	perf_pmu_register(&pmu, "cpu", PERF_TYPE_RAW);
+	register_cpu_notifier(&armpmu_cpu_notifier);
 
 	return 0;
 }
@@ -700,9 +700,14 @@ static void armv7pmu_enable_event(struct hw_perf_event *hwc, int idx)
 
 	/*
 	 * Set event (if destined for PMNx counters)
-	 * We don't need to set the event if it's a cycle count
+	 * We don't need to set the event if it's a cycle count.
+	 * 0xFF only means "use CCNT"; when CCNT is reserved the cycles
+	 * land on an event counter, which counts them with event 0x11.
 	 */
-	if (idx != ARMV7_CYCLE_COUNTER)
+	if (hwc->config_base == ARMV7_PERFCTR_CPU_CYCLES &&
+	    idx != ARMV7_CYCLE_COUNTER)
+		armv7_pmnc_write_evtsel(idx, ARMV7_PERFCTR_CLOCK_CYCLES);
+	else if (idx != ARMV7_CYCLE_COUNTER)
 		armv7_pmnc_write_evtsel(idx, hwc->config_base);
 
 	/*
@@ -803,11 +808,38 @@ static irqreturn_t armv7pmu_handle_irq(int irq_num, void *dev)
 	return IRQ_HANDLED;
 }
 
+/* CNTENS/INTENS bits of the counters perf may use */
+static u32 armv7pmu_unreserved_bits(void)
+{
+	u32 idx, bits = 0;
+
+	for (idx = ARMV7_CYCLE_COUNTER; idx <= armpmu->num_events; ++idx) {
+		if (test_bit(idx, &armpmu_reserved_mask))
+			continue;
+		if (idx == ARMV7_CYCLE_COUNTER)
+			bits |= ARMV7_CNTENS_C;
+		else
+			bits |= ARMV7_CNTENS_P(idx);
+	}
+
+	return bits;
+}
+
 static void armv7pmu_start(void)
 {
 	unsigned long flags;
+	u32 val;
 
 	raw_spin_lock_irqsave(&pmu_lock, flags);
+	if (armpmu_reserved_mask) {
+		/*
+		 * Re-enable the counters armv7pmu_stop() turned off. An
+		 * event in use always has its overflow interrupt enabled.
+		 */
+		asm volatile("mrc p15, 0, %0, c9, c14, 1" : "=r" (val));
+		val &= armv7pmu_unreserved_bits();
+		asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (val));
+	}
 	/* Enable all counters */
 	armv7_pmnc_write(armv7_pmnc_read() | ARMV7_PMNC_E);
 	raw_spin_unlock_irqrestore(&pmu_lock, flags);
@@ -816,10 +848,88 @@ static void armv7pmu_start(void)
 static void armv7pmu_stop(void)
 {
 	unsigned long flags;
+	u32 val;
+
+	raw_spin_lock_irqsave(&pmu_lock, flags);
+	if (armpmu_reserved_mask) {
+		/*
+		 * PMNC.E gates the reserved counters as well; leave it
+		 * alone and turn off only the counters perf may use.
+		 */
+		val = armv7pmu_unreserved_bits();
+		asm volatile("mcr p15, 0, %0, c9, c12, 2" : : "r" (val));
+	} else {
+		/* Disable all counters */
+		armv7_pmnc_write(armv7_pmnc_read() & ~ARMV7_PMNC_E);
+	}
+	raw_spin_unlock_irqrestore(&pmu_lock, flags);
+}
+
+/*
+ * State of the reserved counters, which their owner programs once and
+ * expects to survive a core power-down (hotplug or deep idle).
+ */
+struct armv7_reserved_state {
+	u32 pmnc;
+	u32 cnten;
+	u32 evtsel[32];
+	u32 count[32];
+};
+
+static DEFINE_PER_CPU(struct armv7_reserved_state, armv7_reserved_state);
+
+static void armv7pmu_save_reserved(void)
+{
+	struct armv7_reserved_state *st = &__get_cpu_var(armv7_reserved_state);
+	unsigned long flags;
+	u32 idx, val;
+
+	if (!armpmu_reserved_mask)
+		return;
 
 	raw_spin_lock_irqsave(&pmu_lock, flags);
-	/* Disable all counters */
-	armv7_pmnc_write(armv7_pmnc_read() & ~ARMV7_PMNC_E);
+	st->pmnc = armv7_pmnc_read();
+	asm volatile("mrc p15, 0, %0, c9, c12, 1" : "=r" (val));
+	st->cnten = val & ~armv7pmu_unreserved_bits();
+
+	for (idx = ARMV7_CYCLE_COUNTER; idx <= armpmu->num_events; ++idx) {
+		if (!test_bit(idx, &armpmu_reserved_mask))
+			continue;
+		if (idx != ARMV7_CYCLE_COUNTER &&
+		    armv7_pmnc_select_counter(idx) == idx) {
+			asm volatile("mrc p15, 0, %0, c9, c13, 1" : "=r" (val));
+			st->evtsel[idx] = val;
+		}
+		st->count[idx] = armv7pmu_read_counter(idx);
+	}
+	raw_spin_unlock_irqrestore(&pmu_lock, flags);
+}
+
+static void armv7pmu_restore_reserved(void)
+{
+	struct armv7_reserved_state *st = &__get_cpu_var(armv7_reserved_state);
+	unsigned long flags;
+	u32 idx, pmnc;
+
+	if (!armpmu_reserved_mask)
+		return;
+
+	raw_spin_lock_irqsave(&pmu_lock, flags);
+	for (idx = ARMV7_CYCLE_COUNTER; idx <= armpmu->num_events; ++idx) {
+		if (!test_bit(idx, &armpmu_reserved_mask))
+			continue;
+		if (idx != ARMV7_CYCLE_COUNTER)
+			armv7_pmnc_write_evtsel(idx, st->evtsel[idx]);
+		armv7pmu_write_counter(idx, st->count[idx]);
+	}
+	asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (st->cnten));
+
+	/* Never P or C, they would clear the counters just restored */
+	pmnc = armv7_pmnc_read() & ~(ARMV7_PMNC_E | ARMV7_PMNC_D |
+				     ARMV7_PMNC_X | ARMV7_PMNC_DP);
+	pmnc |= st->pmnc & (ARMV7_PMNC_E | ARMV7_PMNC_D |
+			    ARMV7_PMNC_X | ARMV7_PMNC_DP);
+	armv7_pmnc_write(pmnc);
 	raw_spin_unlock_irqrestore(&pmu_lock, flags);
 }
 
@@ -828,8 +938,12 @@ static int armv7pmu_get_event_idx(struct cpu_hw_events *cpuc,
 {
 	int idx;
 
-	/* Always place a cycle counter into the cycle counter. */
-	if (event->config_base == ARMV7_PERFCTR_CPU_CYCLES) {
+	/*
+	 * Always place a cycle counter into the cycle counter, unless the
+	 * platform owns it; then an event counter counts it as event 0x11.
+	 */
+	if (event->config_base == ARMV7_PERFCTR_CPU_CYCLES &&
+	    !test_bit(ARMV7_CYCLE_COUNTER, &armpmu_reserved_mask)) {
 		if (test_and_set_bit(ARMV7_CYCLE_COUNTER, cpuc->used_mask))
 			return -EAGAIN;
 
@@ -840,6 +954,8 @@ static int armv7pmu_get_event_idx(struct cpu_hw_events *cpuc,
 		 * the events counters
 		 */
 		for (idx = ARMV7_COUNTER0; idx <= armpmu->num_events; ++idx) {
+			if (test_bit(idx, &armpmu_reserved_mask))
+				continue;
 			if (!test_and_set_bit(idx, cpuc->used_mask))
 				return idx;
 		}
@@ -854,8 +970,17 @@ static void armv7pmu_reset(void *info)
 	u32 idx, nb_cnt = armpmu->num_events;
 
 	/* The counter and interrupt enable registers are unknown at reset. */
-	for (idx = 1; idx < nb_cnt; ++idx)
-		armv7pmu_disable_event(NULL, idx);
+	for (idx = 1; idx < nb_cnt; ++idx) {
+		if (!test_bit(idx, &armpmu_reserved_mask))
+			armv7pmu_disable_event(NULL, idx);
+	}
+
+	/*
+	 * P and C would clear the reserved counters too; ours are
+	 * reprogrammed by armpmu_event_set_period() before use anyway.
+	 */
+	if (armpmu_reserved_mask)
+		return;
 
 	/* Initialize & Reset PMNC: C and P bits */
 	armv7_pmnc_write(ARMV7_PMNC_P | ARMV7_PMNC_C);
@@ -871,6 +996,8 @@ static struct arm_pmu armv7pmu = {
 	.start			= armv7pmu_start,
 	.stop			= armv7pmu_stop,
 	.reset			= armv7pmu_reset,
+	.save_reserved		= armv7pmu_save_reserved,
+	.restore_reserved	= armv7pmu_restore_reserved,
 	.raw_event_mask		= 0xFF,
 	.max_period		= (1LLU << 32) - 1,
 };
@@ -0,0 +1,155 @@
+/*
+ *  linux/arch/arm/lib/neon_copy_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Times the integer and NEON copy/clear routines on load and prints the
+ * throughput in GB/s.  "unaligned" offsets the source by 1 and the
+ * destination by 3 bytes.  copy_page is timed on page aligned buffers only.
+ */
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define BENCH_BUF_SIZE	(1 << 20)
+#define BENCH_BYTES	(64 << 20)
+
+static unsigned int sizes[] = { 1024, 4096, 65536, BENCH_BUF_SIZE - PAGE_SIZE };
+
+enum bench_op {
+	BENCH_MEMCPY,
+	BENCH_MEMCPY_NEON,
+	BENCH_MEMSET,
+	BENCH_MEMZERO_NEON,
+	BENCH_COPY_PAGE,
+	BENCH_COPY_PAGE_NEON,
+};
+
+static const char *bench_names[] = {
+	[BENCH_MEMCPY]		= "memcpy",
+	[BENCH_MEMCPY_NEON]	= "memcpy_neon",
+	[BENCH_MEMSET]		= "memset",
+	[BENCH_MEMZERO_NEON]	= "memzero_neon",
+	[BENCH_COPY_PAGE]	= "copy_page",
+	[BENCH_COPY_PAGE_NEON]	= "copy_page_neon",
+};
+
+static void bench_one(enum bench_op op, char *dst, const char *src,
+		      unsigned int size, const char *align)
+{
+	unsigned int loops = max_t(unsigned int, BENCH_BYTES / size, 1);
+	unsigned int i, off;
+	u64 t0, ns, bytes;
+	u32 rate;
+
+	/* one pass to fault everything in and warm the TLBs */
+	memcpy(dst, src, size);
+
+	if (op == BENCH_MEMCPY_NEON || op == BENCH_MEMZERO_NEON ||
+	    op == BENCH_COPY_PAGE_NEON)
+		kernel_neon_begin();
+	else
+		preempt_disable();
+
+	t0 = sched_clock();
+	for (i = 0; i < loops; i++) {
+		switch (op) {
+		case BENCH_MEMCPY:
+			memcpy(dst, src, size);
+			break;
+		case BENCH_MEMCPY_NEON:
+			memcpy_neon(dst, src, size);
+			break;
+		case BENCH_MEMSET:
+			memset(dst, 0, size);
+			break;
+		case BENCH_MEMZERO_NEON:
+			memzero_neon(dst, size);
+			break;
+		case BENCH_COPY_PAGE:
+			for (off = 0; off < size; off += PAGE_SIZE)
+				copy_page_arm(dst + off, src + off);
+			break;
+		case BENCH_COPY_PAGE_NEON:
+			for (off = 0; off < size; off += PAGE_SIZE)
+				copy_page_neon(dst + off, src + off);
+			break;
+		}
+	}
+	ns = sched_clock() - t0;
+
+	if (op == BENCH_MEMCPY_NEON || op == BENCH_MEMZERO_NEON ||
+	    op == BENCH_COPY_PAGE_NEON)
+		kernel_neon_end();
+	else
+		preempt_enable();
+
+	if (!ns)
+		ns = 1;
+	bytes = (u64)size * loops;
+	/* bytes per ns is GB/s, keep two decimals */
+	rate = div64_u64(bytes * 100, ns);
+
+	printk(KERN_INFO "neon_copy_bench: %-14s %-9s %8u bytes: %u.%02u GB/s\n",
+	       bench_names[op], align, size, rate / 100, rate % 100);
+}
+
+static int __init neon_copy_bench_init(void)
+{
+	char *src, *dst;
+	unsigned int i;
+
+	if (!cpu_has_neon()) {
+		printk(KERN_ERR "neon_copy_bench: no NEON on this CPU\n");
+		return -ENODEV;
+	}
+
+	src = vmalloc(BENCH_BUF_SIZE);
+	dst = vmalloc(BENCH_BUF_SIZE);
+	if (!src || !dst) {
+		vfree(src);
+		vfree(dst);
+		return -ENOMEM;
+	}
+	memset(src, 0x5a, BENCH_BUF_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		unsigned int size = sizes[i];
+
+		bench_one(BENCH_MEMCPY, dst, src, size, "aligned");
+		bench_one(BENCH_MEMCPY_NEON, dst, src, size, "aligned");
+		bench_one(BENCH_MEMCPY, dst + 3, src + 1, size, "unaligned");
+		bench_one(BENCH_MEMCPY_NEON, dst + 3, src + 1, size, "unaligned");
+		bench_one(BENCH_MEMSET, dst, src, size, "aligned");
+		bench_one(BENCH_MEMZERO_NEON, dst, src, size, "aligned");
+		bench_one(BENCH_MEMSET, dst + 3, src, size, "unaligned");
+		bench_one(BENCH_MEMZERO_NEON, dst + 3, src, size, "unaligned");
+		if (size >= PAGE_SIZE) {
+			bench_one(BENCH_COPY_PAGE, dst, src, size & PAGE_MASK,
+				  "aligned");
+			bench_one(BENCH_COPY_PAGE_NEON, dst, src,
+				  size & PAGE_MASK, "aligned");
+		}
+		cond_resched();
+	}
+
+	vfree(src);
+	vfree(dst);
+	return 0;
+}
+
+static void __exit neon_copy_bench_exit(void)
+{
+}
+
+module_init(neon_copy_bench_init);
+module_exit(neon_copy_bench_exit);
+MODULE_DESCRIPTION("NEON copy routine benchmark");
+MODULE_LICENSE("GPL");
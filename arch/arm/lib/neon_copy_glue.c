@@ -0,0 +1,82 @@
+/*
+ *  linux/arch/arm/lib/neon_copy_glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Picks the NEON routines in neon_copy.S for large copies and clears once
+ * VFP init has found NEON.  kernel_neon_begin() may have to save the live
+ * user VFP state, and the task then traps to reload it, so small copies
+ * stay on the integer routines.
+ */
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define NEON_COPY_MIN	1024
+
+static bool neon_copy_enabled __read_mostly;
+
+static inline bool neon_copy_usable(size_t n)
+{
+	return n >= NEON_COPY_MIN && neon_copy_enabled && !in_interrupt();
+}
+
+void *neon_memcpy(void *dst, const void *src, size_t n)
+{
+	if (!neon_copy_usable(n))
+		return memcpy(dst, src, n);
+
+	kernel_neon_begin();
+	memcpy_neon(dst, src, n);
+	kernel_neon_end();
+
+	return dst;
+}
+EXPORT_SYMBOL(neon_memcpy);
+
+void neon_memzero(void *p, size_t n)
+{
+	if (!neon_copy_usable(n)) {
+		memset(p, 0, n);
+		return;
+	}
+
+	kernel_neon_begin();
+	memzero_neon(p, n);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(neon_memzero);
+
+void copy_page(void *to, const void *from)
+{
+	if (!neon_copy_usable(PAGE_SIZE)) {
+		copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+/* for the benchmark module */
+EXPORT_SYMBOL_GPL(memcpy_neon);
+EXPORT_SYMBOL_GPL(memzero_neon);
+EXPORT_SYMBOL_GPL(copy_page_neon);
+EXPORT_SYMBOL_GPL(copy_page_arm);
+
+/* vfp_init() is a late_initcall and sets HWCAP_NEON */
+static int __init neon_copy_init(void)
+{
+	neon_copy_enabled = cpu_has_neon();
+	if (neon_copy_enabled)
+		pr_info("NEON copy routines enabled\n");
+	return 0;
+}
+late_initcall_sync(neon_copy_init);
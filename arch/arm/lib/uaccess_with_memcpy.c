@@ -18,6 +18,7 @@
 #include <linux/hardirq.h> /* for in_atomic() */
 #include <linux/gfp.h>
 #include <asm/current.h>
+#include <asm/neon.h>
 #include <asm/page.h>
 
 static int
@@ -88,7 +89,7 @@ __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 		if (tocopy > n)
 			tocopy = n;
 
-		memcpy((void *)to, from, tocopy);
+		neon_memcpy((void *)to, from, tocopy);
 		to += tocopy;
 		from += tocopy;
 		n -= tocopy;
@@ -142,7 +143,7 @@ __clear_user_memset(void __user *addr, unsigned long n)
 		if (tocopy > n)
 			tocopy = n;
 
-		memset((void *)addr, 0, tocopy);
+		neon_memzero((void *)addr, tocopy);
 		addr += tocopy;
 		n -= tocopy;
 
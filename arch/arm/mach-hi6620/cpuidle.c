@@ -42,6 +42,7 @@
 #include <linux/ktime.h>
 #include <linux/hrtimer.h>
 #include <linux/tick.h>
+#include <asm/pmu.h>
 #include "pwrctrl_multi_def.h"
 #include "pwrctrl_multi_sleep.h"
 #include <mach/common/mem/bsp_mem.h>
@@ -216,7 +217,10 @@ int enter_lowpm(struct cpuidle_device *dev,
     }
     else
     {
+        /* the PMU is powered down with the core */
+        armpmu_cpu_save();
         pwrctrl_deep_sleep(PM_SUSPEND_MEM);
+        armpmu_cpu_restore();
     }
 #if 0
     if(enter_state >= SPECIAL_HANDLE_STATE)
@@ -7,34 +7,36 @@
 #include <mach/io.h>
 #include <mach/board-hi6421-regulator.h>
 
-#if 0
+#ifdef CONFIG_HW_PERF_EVENTS
+#include <asm/pmu.h>
 
-static struct resource  A9_pmu_resource[] = {
+/* one overflow interrupt per core, in cpu order */
+static struct resource A9_pmu_resource[] = {
 	[0] = {
-		.start = IRQ_PMIRQ0,
-		.end   = IRQ_PMIRQ0,
+		.start = IRQ_PMU0,
+		.end   = IRQ_PMU0,
 		.flags = IORESOURCE_IRQ,
 	},
 #if (CONFIG_NR_CPUS >= 2)
 	[1] = {
-		.start = IRQ_PMIRQ1,
-		.end   = IRQ_PMIRQ1,
+		.start = IRQ_PMU1,
+		.end   = IRQ_PMU1,
 		.flags = IORESOURCE_IRQ,
 	},
 #endif
 
 #if (CONFIG_NR_CPUS >= 3)
 	[2] = {
-		.start = IRQ_PMIRQ2,
-		.end   = IRQ_PMIRQ2,
+		.start = IRQ_PMU2,
+		.end   = IRQ_PMU2,
 		.flags = IORESOURCE_IRQ,
 	},
 #endif
 
 #if (CONFIG_NR_CPUS >= 4)
 	[3] = {
-		.start = IRQ_PMIRQ3,
-		.end   = IRQ_PMIRQ3,
+		.start = IRQ_PMU3,
+		.end   = IRQ_PMU3,
 		.flags = IORESOURCE_IRQ,
 	},
 #endif
@@ -44,13 +46,22 @@ static struct resource  A9_pmu_resource[] = {
 static struct platform_device A9_pmu_device = {
 	.name			= "arm-pmu",
 	.id				= ARM_PMU_DEVICE_CPU,
-	.resource			= &A9_pmu_resource,
+	.resource			= A9_pmu_resource,
 	.num_resources	= ARRAY_SIZE(A9_pmu_resource),
 };
 
+/*
+ * CCNT, PMN0 and PMN1 are programmed over the APB debug interface by the
+ * cpuload monitor (see hotplug.c), keep perf on the remaining counters.
+ * Indices follow perf_event_v7.c: CCNT is 1, PMNx is x + 2.
+ */
+#define A9_PMU_CPULOAD_COUNTERS	(BIT(1) | BIT(2) | BIT(3))
+
 static int __init plat_pmu_init(void)
 {
 	int ret = 0;
+
+	armpmu_reserve_counters(A9_PMU_CPULOAD_COUNTERS);
 	ret = platform_device_register(&A9_pmu_device);
 	return ret;
 };
@@ -62,9 +62,15 @@ static unsigned long timer1_clk_khz = (CONFIG_DEFAULT_TIMERCLK / 1000);
 
 /* free run timer for sched_clock */
 static void __iomem *clksrc_base;
-static unsigned long long cycles_2_ns(unsigned long long cyc)
+static const unsigned long cyc2ns_scale =
+	(1000000 << 10) / (CONFIG_DEFAULT_TIMERCLK / 1000);
+
+/*
+ * sched_clock() stamps every ftrace event, so neither it nor its helpers
+ * may be traced themselves, and the scale must not cost a divide per call.
+ */
+static inline unsigned long long notrace cycles_2_ns(unsigned long long cyc)
 {
-	unsigned long cyc2ns_scale = (1000000 << 10) / timer1_clk_khz;
 	return (cyc * cyc2ns_scale) >> 10;
 }
 
@@ -111,7 +117,7 @@ static struct irqaction freerun_timer_irq = {
 
 /* FIXME: timer IO can be read after system IO mapped */
 static unsigned long iomapped = 0;
-unsigned long long sched_clock(void)
+unsigned long long notrace sched_clock(void)
 {
 	unsigned long long ticks64;
 	unsigned long ticks2, ticks1;
@@ -18,6 +18,7 @@ extern "C"
 **************************************************************************/
 BSP_S32 BSP_MEM_Init(VOID);
 BSP_S32 BSP_MEM_SetMostUsedSize(BSP_U32 u32Size, BSP_U32 u32PoolType);
+BSP_U32 BSP_MEM_GetIccPoolBase(BSP_U32 *pu32Size);
 
 BSP_VOID* BSP_Malloc(BSP_U32 u32Size, MEM_POOL_TYPE enFlags);
 BSP_VOID* BSP_MallocDbg(BSP_U32 u32Size, MEM_POOL_TYPE enFlags, BSP_U8* pFileName, BSP_U32 u32Line);
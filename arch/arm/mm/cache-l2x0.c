@@ -22,15 +22,74 @@
 #include <linux/module.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/sched.h>
 
 #include <asm/uaccess.h>
+#include <asm/sections.h>
+#include <asm/sizes.h>
 #include <asm/cacheflush.h>
 #include <asm/hardware/cache-l2x0.h>
 
 #define CACHE_LINE_SIZE		32
 
 static void __iomem *l2x0_base;
-static DEFINE_RAW_SPINLOCK(l2x0_lock);
+/*
+ * Line operations by PA are atomic on PL310 r3p0 and later, so range
+ * maintenance from several CPUs may run side by side and only needs to
+ * keep out of the way of background (way) operations, which take the
+ * lock for writing.  Older revisions need the errata workarounds around
+ * each line operation and take it for writing throughout.
+ *
+ * rwlock_t favours readers, so a way operation announces itself in
+ * l2x0_way_waiting and new line operations hold off until it got the
+ * lock; otherwise back to back DMA maintenance on other CPUs could keep
+ * it spinning indefinitely.
+ */
+static DEFINE_RWLOCK(l2x0_lock);
+static bool l2x0_line_ops_shared;
+static atomic_t l2x0_way_waiting = ATOMIC_INIT(0);
+
+#define l2x0_line_lock(flags)					\
+	do {							\
+		if (l2x0_line_ops_shared) {			\
+			while (atomic_read(&l2x0_way_waiting))	\
+				cpu_relax();			\
+			read_lock_irqsave(&l2x0_lock, flags);	\
+		} else						\
+			write_lock_irqsave(&l2x0_lock, flags);	\
+	} while (0)
+
+#define l2x0_line_unlock(flags)					\
+	do {							\
+		if (l2x0_line_ops_shared)			\
+			read_unlock_irqrestore(&l2x0_lock, flags); \
+		else						\
+			write_unlock_irqrestore(&l2x0_lock, flags); \
+	} while (0)
+
+/*
+ * IRQs go off before the way operation announces itself: an interrupt
+ * doing DMA maintenance on this CPU would otherwise spin in
+ * l2x0_line_lock() on the very writer it interrupted.
+ */
+#define l2x0_way_lock(flags)					\
+	do {							\
+		local_irq_save(flags);				\
+		atomic_inc(&l2x0_way_waiting);			\
+		write_lock(&l2x0_lock);				\
+		atomic_dec(&l2x0_way_waiting);			\
+	} while (0)
+
+#define l2x0_way_unlock(flags)	write_unlock_irqrestore(&l2x0_lock, flags)
+
+/*
+ * Ranges at or above this size are cleaned/flushed by way rather than by
+ * line.  Tunable, and calibrated by "bench", through /proc/l2x0-maint,
+ * but never below L2X0_WAY_THRESHOLD_MIN: a way operation stalls every
+ * other CPU's maintenance, small ranges must not turn into one.
+ */
+#define L2X0_WAY_THRESHOLD_MIN	SZ_64K
+static unsigned long l2x0_way_threshold;
 
 static uint32_t l2x0_way_mask;	/* Bitmask of active ways */
 static uint32_t l2x0_size;
@@ -184,9 +243,9 @@ void l2x0_cache_sync(void)
 {
 	unsigned long flags;
 
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_line_lock(flags);
 	cache_sync();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_line_unlock(flags);
 }
 
 #ifdef CONFIG_PL310_ERRATA_727915
@@ -197,11 +256,11 @@ static void l2x0_for_each_set_way(void __iomem *reg)
 	unsigned long flags;
 
 	for (way = 0; way < l2x0_ways; way++) {
-		raw_spin_lock_irqsave(&l2x0_lock, flags);
+		l2x0_way_lock(flags);
 		for (set = 0; set < l2x0_sets; set++)
 			writel_relaxed((way << 28) | (set << 5), reg);
 		cache_sync();
-		raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+		l2x0_way_unlock(flags);
 	}
 }
 #endif
@@ -227,9 +286,9 @@ void l2x0_flush_all(void)
 #endif
 
 	/* clean all ways */
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_way_lock(flags);
 	__l2x0_flush_all();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_way_unlock(flags);
 }
 
 void l2x0_clean_all(void)
@@ -244,13 +303,13 @@ void l2x0_clean_all(void)
 #endif
 
 	/* clean all ways */
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_way_lock(flags);
 	debug_writel(0x03);
 	writel_relaxed(l2x0_way_mask, l2x0_base + L2X0_CLEAN_WAY);
 	cache_wait_way(l2x0_base + L2X0_CLEAN_WAY, l2x0_way_mask);
 	cache_sync();
 	debug_writel(0x00);
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_way_unlock(flags);
 }
 
 void l2x0_inv_all(void)
@@ -258,13 +317,13 @@ void l2x0_inv_all(void)
 	unsigned long flags;
 
 	/* invalidate all ways */
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_way_lock(flags);
 	/* Invalidating when L2 is enabled is a nono */
 	BUG_ON(readl(l2x0_base + L2X0_CTRL) & 1);
 	writel_relaxed(l2x0_way_mask, l2x0_base + L2X0_INV_WAY);
 	cache_wait_way(l2x0_base + L2X0_INV_WAY, l2x0_way_mask);
 	cache_sync();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_way_unlock(flags);
 }
 
 static void l2x0_inv_range(unsigned long start, unsigned long end)
@@ -272,7 +331,11 @@ static void l2x0_inv_range(unsigned long start, unsigned long end)
 	void __iomem *base = l2x0_base;
 	unsigned long flags;
 
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	/*
+	 * Always by line: there is no way operation that leaves the lines
+	 * outside the range alone.
+	 */
+	l2x0_line_lock(flags);
 	if (start & (CACHE_LINE_SIZE - 1)) {
 		start &= ~(CACHE_LINE_SIZE - 1);
 		debug_writel(0x03);
@@ -297,26 +360,21 @@ static void l2x0_inv_range(unsigned long start, unsigned long end)
 		}
 
 		if (blk_end < end) {
-			raw_spin_unlock_irqrestore(&l2x0_lock, flags);
-			raw_spin_lock_irqsave(&l2x0_lock, flags);
+			l2x0_line_unlock(flags);
+			l2x0_line_lock(flags);
 		}
 	}
 	cache_wait(base + L2X0_INV_LINE_PA, 1);
 	cache_sync();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_line_unlock(flags);
 }
 
-static void l2x0_clean_range(unsigned long start, unsigned long end)
+static void __l2x0_clean_range(unsigned long start, unsigned long end)
 {
 	void __iomem *base = l2x0_base;
 	unsigned long flags;
 
-	if ((end - start) >= l2x0_size) {
-		l2x0_clean_all();
-		return;
-	}
-
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_line_lock(flags);
 	start &= ~(CACHE_LINE_SIZE - 1);
 	while (start < end) {
 		unsigned long blk_end = start + min(end - start, 4096UL);
@@ -327,28 +385,33 @@ static void l2x0_clean_range(unsigned long start, unsigned long end)
 		}
 
 		if (blk_end < end) {
-			raw_spin_unlock_irqrestore(&l2x0_lock, flags);
-			raw_spin_lock_irqsave(&l2x0_lock, flags);
+			l2x0_line_unlock(flags);
+			l2x0_line_lock(flags);
 		}
 	}
 	cache_wait(base + L2X0_CLEAN_LINE_PA, 1);
         asm("DSB");
         asm("ISB");
 	cache_sync();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_line_unlock(flags);
 }
 
-static void l2x0_flush_range(unsigned long start, unsigned long end)
+static void l2x0_clean_range(unsigned long start, unsigned long end)
 {
-	void __iomem *base = l2x0_base;
-	unsigned long flags;
-
-	if ((end - start) >= l2x0_size) {
-		l2x0_flush_all();
+	if ((end - start) >= l2x0_way_threshold) {
+		l2x0_clean_all();
 		return;
 	}
 
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	__l2x0_clean_range(start, end);
+}
+
+static void __l2x0_flush_range(unsigned long start, unsigned long end)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	l2x0_line_lock(flags);
 	start &= ~(CACHE_LINE_SIZE - 1);
 	while (start < end) {
 		unsigned long blk_end = start + min(end - start, 4096UL);
@@ -361,24 +424,34 @@ static void l2x0_flush_range(unsigned long start, unsigned long end)
 		debug_writel(0x00);
 
 		if (blk_end < end) {
-			raw_spin_unlock_irqrestore(&l2x0_lock, flags);
-			raw_spin_lock_irqsave(&l2x0_lock, flags);
+			l2x0_line_unlock(flags);
+			l2x0_line_lock(flags);
 		}
 	}
 	cache_wait(base + L2X0_CLEAN_INV_LINE_PA, 1);
 	cache_sync();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_line_unlock(flags);
+}
+
+static void l2x0_flush_range(unsigned long start, unsigned long end)
+{
+	if ((end - start) >= l2x0_way_threshold) {
+		l2x0_flush_all();
+		return;
+	}
+
+	__l2x0_flush_range(start, end);
 }
 
 static void l2x0_disable(void)
 {
 	unsigned long flags;
 
-	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_way_lock(flags);
 	__l2x0_flush_all();
 	writel_relaxed(0, l2x0_base + L2X0_CTRL);
 	dsb();
-	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+	l2x0_way_unlock(flags);
 }
 
 static unsigned char ev_name[2][20];
@@ -510,10 +583,158 @@ static const struct file_operations l2x0_proc_fops = {
 	.write          = l2x0_proc_write,
 };
 
+/*
+ * /proc/l2x0-maint: shows and sets the by-way threshold, and "bench"
+ * measures line against way maintenance over a range of buffer sizes
+ * (on the kernel image, which only ever gets cleaned or flushed) and
+ * moves the threshold to where the way operation starts to win.
+ */
+#define L2X0_BENCH_SIZES	8
+
+static struct {
+	unsigned long	size;
+	unsigned long	clean_ns;
+	unsigned long	flush_ns;
+} l2x0_bench[L2X0_BENCH_SIZES];
+static unsigned int l2x0_bench_nr;
+static unsigned long l2x0_bench_clean_all_ns;
+static unsigned long l2x0_bench_flush_all_ns;
+
+/*
+ * Range operations are timed a chunk at a time, with interrupts only off
+ * inside each chunk, so that a bench over a large image does not become
+ * one long irq-off section.  A way operation cannot be split; it already
+ * runs with interrupts off under the lock and is bounded by the cache
+ * size, exactly as when l2x0_flush_all() is called for a large DMA.
+ */
+#define L2X0_BENCH_CHUNK	SZ_64K
+
+static unsigned long l2x0_time(void (*op)(unsigned long, unsigned long),
+			       void (*all)(void), unsigned long size)
+{
+	unsigned long start = virt_to_phys(_text) & PAGE_MASK;
+	unsigned long end = start + size;
+	unsigned long long t0, total = 0;
+	unsigned long flags, len;
+
+	if (!op) {
+		t0 = sched_clock();
+		all();
+		return (unsigned long)(sched_clock() - t0);
+	}
+
+	while (start < end) {
+		len = min(end - start, (unsigned long)L2X0_BENCH_CHUNK);
+
+		local_irq_save(flags);
+		t0 = sched_clock();
+		op(start, start + len);
+		total += sched_clock() - t0;
+		local_irq_restore(flags);
+
+		start += len;
+		cond_resched();
+	}
+
+	return (unsigned long)total;
+}
+
+static void l2x0_run_bench(void)
+{
+	unsigned long size, limit;
+	unsigned int i = 0;
+
+	limit = min_t(unsigned long, 2 * l2x0_size, _etext - _text);
+
+	l2x0_bench_clean_all_ns = l2x0_time(NULL, l2x0_clean_all, 0);
+	l2x0_bench_flush_all_ns = l2x0_time(NULL, l2x0_flush_all, 0);
+
+	for (size = SZ_4K; size <= limit && i < L2X0_BENCH_SIZES; size *= 4) {
+		l2x0_bench[i].size = size;
+		l2x0_bench[i].clean_ns = l2x0_time(__l2x0_clean_range, NULL,
+						   size);
+		l2x0_bench[i].flush_ns = l2x0_time(__l2x0_flush_range, NULL,
+						   size);
+		i++;
+	}
+	l2x0_bench_nr = i;
+
+	/* flush is the costlier of the two and what DMA mostly does */
+	for (i = 0; i < l2x0_bench_nr; i++) {
+		if (l2x0_bench[i].flush_ns >= l2x0_bench_flush_all_ns) {
+			l2x0_way_threshold = max_t(unsigned long,
+						   l2x0_bench[i].size,
+						   L2X0_WAY_THRESHOLD_MIN);
+			break;
+		}
+	}
+}
+
+static int l2x0_maint_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	seq_printf(m, "cache_id:      0x%08x\n", l2x0_cache_id);
+	seq_printf(m, "size:          %u\n", l2x0_size);
+	seq_printf(m, "shared_lines:  %d\n", l2x0_line_ops_shared);
+	seq_printf(m, "way_threshold: %lu\n", l2x0_way_threshold);
+
+	if (!l2x0_bench_nr)
+		return 0;
+
+	seq_printf(m, "\n%10s %12s %12s\n", "size", "clean_ns", "flush_ns");
+	for (i = 0; i < l2x0_bench_nr; i++)
+		seq_printf(m, "%10lu %12lu %12lu\n", l2x0_bench[i].size,
+			   l2x0_bench[i].clean_ns, l2x0_bench[i].flush_ns);
+	seq_printf(m, "%10s %12lu %12lu\n", "by way",
+		   l2x0_bench_clean_all_ns, l2x0_bench_flush_all_ns);
+
+	return 0;
+}
+
+static int l2x0_maint_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, l2x0_maint_show, NULL);
+}
+
+static ssize_t l2x0_maint_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *pos)
+{
+	char buf[32];
+	unsigned long val;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (!strncmp(buf, "bench", 5)) {
+		l2x0_run_bench();
+		return count;
+	}
+
+	if (strict_strtoul(strim(buf), 0, &val) || val < L2X0_WAY_THRESHOLD_MIN)
+		return -EINVAL;
+	l2x0_way_threshold = val;
+
+	return count;
+}
+
+static const struct file_operations l2x0_maint_fops = {
+	.owner          = THIS_MODULE,
+	.open           = l2x0_maint_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+	.write          = l2x0_maint_write,
+};
+
 static void l2x0_proc_init(void)
 {
 	l2x0_ev_enable = 0;
 	proc_create("l2x0-proc", 0, NULL, &l2x0_proc_fops);
+	proc_create("l2x0-maint", S_IRUGO | S_IWUSR, NULL, &l2x0_maint_fops);
 }
 
 static void l2x0_lockdown_vectors(void)
@@ -612,6 +833,11 @@ void __init l2x0_init(void __iomem *base, __u32 aux_val, __u32 aux_mask)
 	way_size = SZ_1K << (way_size + 3);
 	l2x0_size = l2x0_ways * way_size;
 	l2x0_sets = way_size / CACHE_LINE_SIZE;
+	l2x0_way_threshold = max_t(unsigned long, l2x0_size, L2X0_WAY_THRESHOLD_MIN);
+
+	if ((l2x0_cache_id & L2X0_CACHE_ID_PART_MASK) == L2X0_CACHE_ID_PART_L310 &&
+	    (l2x0_cache_id & L2X0_CACHE_ID_REV_MASK) >= REV_PL310_R3P0)
+		l2x0_line_ops_shared = true;
 
 	/*
 	 * Check if l2x0 controller is already enabled.
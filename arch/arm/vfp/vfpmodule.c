@@ -18,6 +18,9 @@
 #include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <asm/cputype.h>
 #include <asm/thread_notify.h>
@@ -49,6 +52,19 @@ union vfp_state *vfp_current_hw_state[NR_CPUS];
  */
 unsigned int VFP_arch;
 
+/*
+ * Eager restore.  A task that took the lazy restore trap in each of its
+ * last eager_threshold timeslices gets its state loaded at switch in for
+ * the next eager_slices slices.  Usage can't be seen while eager, so the
+ * slice after that is lazy again and probes whether the task still uses
+ * VFP.  eager_threshold = 0 turns this off.
+ */
+static unsigned int vfp_eager_threshold = 3;
+module_param_named(eager_threshold, vfp_eager_threshold, uint, 0644);
+
+static unsigned int vfp_eager_slices = 16;
+module_param_named(eager_slices, vfp_eager_slices, uint, 0644);
+
 /*
  * Is 'thread's most up to date state stored in this CPUs hardware?
  * Must be called from non-preemptible context.
@@ -121,6 +137,66 @@ static void vfp_thread_copy(struct thread_info *thread)
 
 	vfp_sync_hwstate(parent);
 	thread->vfpstate = parent->vfpstate;
+
+	/* thread_info was copied wholesale, start the child's stats afresh */
+	thread->vfp_traps = 0;
+	thread->vfp_eager = 0;
+	thread->vfp_history = 0;
+	thread->vfp_eager_left = 0;
+	thread->vfp_eager_slice = 0;
+}
+
+/*
+ * Note whether the outgoing thread used VFP in the slice that is ending.
+ * FPEXC.EN is only set if it took the lazy restore trap, as it is cleared
+ * on every switch.  Eager slices say nothing about usage and are skipped.
+ */
+static void vfp_account_slice(struct thread_info *prev, u32 fpexc)
+{
+	unsigned int mask;
+
+	if (prev->vfp_eager_slice) {
+		prev->vfp_eager_slice = 0;
+		return;
+	}
+
+	prev->vfp_history = (prev->vfp_history << 1) | !!(fpexc & FPEXC_EN);
+
+	if (!vfp_eager_threshold)
+		return;
+	mask = (1 << min(vfp_eager_threshold, 8U)) - 1;
+	if ((prev->vfp_history & mask) == mask)
+		prev->vfp_eager_left = min(vfp_eager_slices, 255U);
+}
+
+/*
+ * Load the incoming thread's state and leave VFP enabled, as the lazy
+ * restore trap would.  A pending exception is left for the trap to deal
+ * with.  fpexc is the hardware FPEXC on entry.
+ */
+static bool vfp_eager_restore(struct thread_info *thread, unsigned int cpu,
+			      u32 fpexc)
+{
+	union vfp_state *vfp = &thread->vfpstate;
+
+	if (vfp->hard.fpexc & FPEXC_EX)
+		return false;
+
+	if (vfp_current_hw_state[cpu] != vfp) {
+		fmxr(FPEXC, (fpexc | FPEXC_EN) & ~FPEXC_EX);
+#ifndef CONFIG_SMP
+		/* UP saves lazily, the owner's state may only be in hardware */
+		if (vfp_current_hw_state[cpu])
+			vfp_save_state(vfp_current_hw_state[cpu],
+				       fpexc | FPEXC_EN);
+#endif
+		vfp_load_state(vfp);
+		vfp_current_hw_state[cpu] = vfp;
+		fpexc = vfp->hard.fpexc;
+	}
+
+	fmxr(FPEXC, fpexc | FPEXC_EN);
+	return true;
 }
 
 /*
@@ -150,16 +226,17 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 {
 	struct thread_info *thread = v;
 	u32 fpexc;
-#ifdef CONFIG_SMP
 	unsigned int cpu;
-#endif
 
 	switch (cmd) {
 	case THREAD_NOTIFY_SWITCH:
 		fpexc = fmrx(FPEXC);
+		cpu = thread->cpu;
+
+		/* still on the outgoing thread's stack */
+		vfp_account_slice(current_thread_info(), fpexc);
 
 #ifdef CONFIG_SMP
-		cpu = thread->cpu;
 
 		/*
 		 * On SMP, if VFP is enabled, save the old state in
@@ -179,6 +256,14 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 			vfp_current_hw_state[cpu] = NULL;
 #endif
 
+		if (thread->vfp_eager_left &&
+		    vfp_eager_restore(thread, cpu, fpexc)) {
+			thread->vfp_eager_left--;
+			thread->vfp_eager_slice = 1;
+			thread->vfp_eager++;
+			break;
+		}
+
 		/*
 		 * Always disable VFP so we can lazily save/restore the
 		 * old state.
@@ -188,6 +273,9 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 
 	case THREAD_NOTIFY_FLUSH:
 		vfp_thread_flush(thread);
+		/* new program, its VFP use has to be learnt again */
+		thread->vfp_history = 0;
+		thread->vfp_eager_left = 0;
 		break;
 
 	case THREAD_NOTIFY_EXIT:
@@ -611,6 +699,55 @@ EXPORT_SYMBOL(kernel_neon_end);
 
 #endif /* CONFIG_KERNEL_MODE_NEON */
 
+#ifdef CONFIG_PROC_FS
+/*
+ * /proc/vfp_stats: lazy restore traps and eager restores per thread, for
+ * threads that have had either.
+ */
+static int vfp_stats_show(struct seq_file *m, void *v)
+{
+	struct task_struct *g, *p;
+
+	seq_printf(m, "eager_threshold %u eager_slices %u\n",
+		   vfp_eager_threshold, vfp_eager_slices);
+	seq_printf(m, "%-6s %-16s %10s %10s %8s\n",
+		   "pid", "comm", "traps", "eager", "history");
+
+	rcu_read_lock();
+	do_each_thread(g, p) {
+		struct thread_info *ti = task_thread_info(p);
+
+		if (!ti->vfp_traps && !ti->vfp_eager)
+			continue;
+		seq_printf(m, "%-6d %-16s %10u %10u     0x%02x\n",
+			   task_pid_nr(p), p->comm, ti->vfp_traps,
+			   ti->vfp_eager, ti->vfp_history);
+	} while_each_thread(g, p);
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int vfp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vfp_stats_show, NULL);
+}
+
+static const struct file_operations vfp_stats_fops = {
+	.open		= vfp_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init vfp_stats_init(void)
+{
+	proc_create("vfp_stats", S_IRUGO, NULL, &vfp_stats_fops);
+}
+#else
+static inline void vfp_stats_init(void) { }
+#endif
+
 /*
  * VFP support code initialisation.
  */
@@ -653,6 +790,7 @@ static int __init vfp_init(void)
 
 		thread_register_notifier(&vfp_notifier_block);
 		vfp_pm_init();
+		vfp_stats_init();
 
 		/*
 		 * We detected VFP, and the support code is
@@ -20,6 +20,13 @@
 #include <linux/highmem.h>
 #include <linux/firmware.h>
 #include <linux/slab.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/async.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/ctype.h>
+#include <linux/namei.h>
 
 #define to_dev(obj) container_of(obj, struct device, kobj)
 
@@ -85,6 +92,39 @@ static int loading_timeout = 60;	/* In seconds */
  * guarding for corner cases a global lock should be OK */
 static DEFINE_MUTEX(fw_lock);
 
+/*
+ * Firmware cache. Every image loaded through _request_firmware() gets an
+ * entry, concurrent requests for the same name wait for the one loader,
+ * and idle images stay cached up to fw_cache_limit bytes so that reloads
+ * after resume or a Wi-Fi/modem reset don't go back to the filesystem.
+ * Only images read directly from the filesystem outlive their last user:
+ * a hit re-checks the file's size and mtime, while helper-loaded images
+ * can't be checked and are dropped on their last release_firmware().
+ */
+struct fw_cache_entry {
+	struct list_head list;
+	struct kref ref;		/* one for the list, one per user */
+	struct completion done;
+	int status;			/* -EINPROGRESS while loading */
+	struct firmware fw;
+	unsigned long last_used;
+	bool direct;			/* read from @path, may stay cached */
+	char *path;
+	struct timespec mtime;		/* of @path when it was read */
+	char name[];
+};
+
+static LIST_HEAD(fw_cache);
+static DEFINE_SPINLOCK(fw_cache_lock);
+static size_t fw_cache_bytes;
+static size_t fw_cache_limit = CONFIG_FW_CACHE_SIZE * 1024;
+static unsigned int fw_cache_hits, fw_cache_misses;
+static atomic_t fw_direct_loads = ATOMIC_INIT(0);
+static atomic_t fw_helper_loads = ATOMIC_INIT(0);
+
+static void fw_cache_trim(size_t limit);
+static void fw_cache_preload(const char *buf, size_t count);
+
 struct firmware_priv {
 	struct completion completion;
 	struct firmware *fw;
@@ -141,9 +181,78 @@ static ssize_t firmware_timeout_store(struct class *class,
 	return count;
 }
 
+static ssize_t firmware_cache_show(struct class *class,
+				   struct class_attribute *attr,
+				   char *buf)
+{
+	struct fw_cache_entry *entry;
+	int len;
+
+	spin_lock(&fw_cache_lock);
+	len = snprintf(buf, PAGE_SIZE,
+		       "bytes %zu limit %zu hits %u misses %u direct %u helper %u\n",
+		       fw_cache_bytes, fw_cache_limit, fw_cache_hits,
+		       fw_cache_misses, atomic_read(&fw_direct_loads),
+		       atomic_read(&fw_helper_loads));
+	list_for_each_entry(entry, &fw_cache, list) {
+		if (len >= PAGE_SIZE)
+			break;
+		len += snprintf(buf + len, PAGE_SIZE - len, "%s %zu %d%s\n",
+				entry->name, entry->fw.size,
+				atomic_read(&entry->ref.refcount) - 1,
+				entry->status ? " loading" : "");
+	}
+	spin_unlock(&fw_cache_lock);
+
+	return min_t(int, len, PAGE_SIZE - 1);
+}
+
+/**
+ * firmware_cache_store - drop idle images from the firmware cache
+ * @class: device class pointer
+ * @attr: device attribute pointer
+ * @buf: buffer to scan for the new cache limit
+ * @count: number of bytes in @buf
+ *
+ *	Sets the cache limit in KiB and drops idle images, oldest first,
+ *	until the cache fits. Writing 0 flushes every idle image.
+ **/
+static ssize_t firmware_cache_store(struct class *class,
+				    struct class_attribute *attr,
+				    const char *buf, size_t count)
+{
+	fw_cache_limit = simple_strtoul(buf, NULL, 10) * 1024;
+	fw_cache_trim(fw_cache_limit);
+
+	return count;
+}
+
+/**
+ * firmware_preload_store - load images into the firmware cache
+ * @class: device class pointer
+ * @attr: device attribute pointer
+ * @buf: whitespace separated firmware names
+ * @count: number of bytes in @buf
+ *
+ *	Loads every named image from the filesystem in parallel, without
+ *	the usermode helper. Meant to be written from an init script once
+ *	the firmware partition is mounted.
+ **/
+static ssize_t firmware_preload_store(struct class *class,
+				      struct class_attribute *attr,
+				      const char *buf, size_t count)
+{
+	fw_cache_preload(buf, count);
+
+	return count;
+}
+
 static struct class_attribute firmware_class_attrs[] = {
 	__ATTR(timeout, S_IWUSR | S_IRUGO,
 		firmware_timeout_show, firmware_timeout_store),
+	__ATTR(cache, S_IWUSR | S_IRUGO,
+		firmware_cache_show, firmware_cache_store),
+	__ATTR(preload, S_IWUSR, NULL, firmware_preload_store),
 	__ATTR_NULL
 };
 
@@ -510,44 +619,307 @@ static void fw_destroy_instance(struct firmware_priv *fw_priv)
 	device_unregister(f_dev);
 }
 
-static int _request_firmware(const struct firmware **firmware_p,
-			     const char *name, struct device *device,
-			     bool uevent, bool nowait)
+static void fw_cache_entry_release(struct kref *ref)
 {
-	struct firmware_priv *fw_priv;
-	struct firmware *firmware;
-	int retval = 0;
+	struct fw_cache_entry *entry =
+		container_of(ref, struct fw_cache_entry, ref);
 
-	if (!firmware_p)
+	firmware_free_data(&entry->fw);
+	kfree(entry->path);
+	kfree(entry);
+}
+
+/*
+ * Takes @entry off the cache list and drops the list's reference. Safe
+ * against a concurrent trim or unhash, only one of them drops it.
+ */
+static void fw_cache_unhash(struct fw_cache_entry *entry)
+{
+	bool listed;
+
+	spin_lock(&fw_cache_lock);
+	listed = !list_empty(&entry->list);
+	if (listed) {
+		list_del_init(&entry->list);
+		if (!entry->status)
+			fw_cache_bytes -= entry->fw.size;
+	}
+	spin_unlock(&fw_cache_lock);
+
+	if (listed)
+		kref_put(&entry->ref, fw_cache_entry_release);
+}
+
+/*
+ * Drops the cache reference of idle images, least recently used first,
+ * until the cache holds at most @limit bytes.
+ */
+static void fw_cache_trim(size_t limit)
+{
+	struct fw_cache_entry *entry, *victim;
+
+	for (;;) {
+		victim = NULL;
+
+		spin_lock(&fw_cache_lock);
+		if (fw_cache_bytes > limit) {
+			list_for_each_entry(entry, &fw_cache, list) {
+				if (entry->status ||
+				    atomic_read(&entry->ref.refcount) != 1)
+					continue;
+				if (!victim || time_before(entry->last_used,
+							   victim->last_used))
+					victim = entry;
+			}
+			if (victim) {
+				list_del_init(&victim->list);
+				fw_cache_bytes -= victim->fw.size;
+			}
+		}
+		spin_unlock(&fw_cache_lock);
+
+		if (!victim)
+			break;
+		kref_put(&victim->ref, fw_cache_entry_release);
+	}
+}
+
+static struct fw_cache_entry *fw_cache_alloc(const char *name)
+{
+	struct fw_cache_entry *entry;
+
+	entry = kzalloc(sizeof(*entry) + strlen(name) + 1, GFP_KERNEL);
+	if (entry) {
+		INIT_LIST_HEAD(&entry->list);
+		kref_init(&entry->ref);
+		init_completion(&entry->done);
+		entry->status = -EINPROGRESS;
+		strcpy(entry->name, name);
+	}
+	return entry;
+}
+
+/*
+ * Returns the cache entry for @name with a reference held. If there is
+ * none a new one is inserted and *@loader is set: the caller must load
+ * the image and report the result with fw_cache_done().
+ */
+static struct fw_cache_entry *fw_cache_get(const char *name, bool *loader)
+{
+	struct fw_cache_entry *entry, *new;
+
+	new = fw_cache_alloc(name);
+
+	spin_lock(&fw_cache_lock);
+	list_for_each_entry(entry, &fw_cache, list) {
+		if (!strcmp(entry->name, name)) {
+			kref_get(&entry->ref);
+			entry->last_used = jiffies;
+			fw_cache_hits++;
+			spin_unlock(&fw_cache_lock);
+			kfree(new);
+			*loader = false;
+			return entry;
+		}
+	}
+	if (new) {
+		kref_get(&new->ref);
+		new->last_used = jiffies;
+		list_add(&new->list, &fw_cache);
+		fw_cache_misses++;
+	}
+	spin_unlock(&fw_cache_lock);
+
+	*loader = true;
+	return new;
+}
+
+static void fw_cache_done(struct fw_cache_entry *entry, int status)
+{
+	spin_lock(&fw_cache_lock);
+	entry->status = status;
+	if (status)
+		list_del_init(&entry->list);
+	else
+		fw_cache_bytes += entry->fw.size;
+	spin_unlock(&fw_cache_lock);
+
+	complete_all(&entry->done);
+
+	if (status)
+		kref_put(&entry->ref, fw_cache_entry_release);
+	else
+		fw_cache_trim(fw_cache_limit);
+}
+
+static void fw_cache_put(struct fw_cache_entry *entry)
+{
+	bool last = false;
+
+	/* Nothing tells whether a helper-loaded image is stale, drop it */
+	if (!entry->direct) {
+		spin_lock(&fw_cache_lock);
+		last = atomic_read(&entry->ref.refcount) == 2;
+		spin_unlock(&fw_cache_lock);
+	}
+	if (last)
+		fw_cache_unhash(entry);
+
+	kref_put(&entry->ref, fw_cache_entry_release);
+	fw_cache_trim(fw_cache_limit);
+}
+
+#ifdef CONFIG_FW_LOADER_DIRECT
+/* Searched in order by the direct loading path */
+static const char * const fw_path[] = {
+	"/system/etc/firmware",
+	"/system/vendor/firmware",
+	"/vendor/firmware",
+	"/lib/firmware",
+};
+
+static int fw_read_file(struct file *file, struct fw_cache_entry *entry)
+{
+	struct firmware *fw = &entry->fw;
+	struct kstat stat;
+	loff_t size;
+	struct page **pages;
+	void *buf;
+	int i, nr_pages, retval;
+
+	retval = vfs_getattr(file->f_path.mnt, file->f_path.dentry, &stat);
+	if (retval)
+		return retval;
+	size = stat.size;
+
+	if (!S_ISREG(stat.mode) || size <= 0 || size > INT_MAX)
 		return -EINVAL;
 
-	*firmware_p = firmware = kzalloc(sizeof(*firmware), GFP_KERNEL);
-	if (!firmware) {
-		dev_err(device, "%s: kmalloc(struct firmware) failed\n",
-			__func__);
+	nr_pages = PFN_UP(size);
+	pages = kcalloc(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	retval = -ENOMEM;
+	for (i = 0; i < nr_pages; i++) {
+		pages[i] = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
+		if (!pages[i])
+			goto err_free;
+	}
+
+	buf = vmap(pages, nr_pages, 0, PAGE_KERNEL);
+	if (!buf)
+		goto err_free;
+	retval = kernel_read(file, 0, buf, size);
+	vunmap(buf);
+	if (retval != size) {
+		retval = retval < 0 ? retval : -EIO;
+		goto err_free;
+	}
+
+	/* Same layout as images written through the usermode helper */
+	fw->data = vmap(pages, nr_pages, 0, PAGE_KERNEL_RO);
+	if (!fw->data) {
 		retval = -ENOMEM;
-		goto out;
+		goto err_free;
 	}
+	fw->pages = pages;
+	fw->size = size;
+	entry->mtime = stat.mtime;
 
-	if (fw_get_builtin_firmware(firmware, name)) {
-		dev_dbg(device, "firmware: using built-in firmware %s\n", name);
-		return 0;
+	return 0;
+
+err_free:
+	for (i = 0; i < nr_pages && pages[i]; i++)
+		__free_page(pages[i]);
+	kfree(pages);
+	return retval;
+}
+
+/*
+ * Reads the image straight from the filesystem. Unlike the usermode
+ * helper this also works while helpers are disabled around suspend.
+ */
+static int fw_load_from_fs(struct fw_cache_entry *entry, const char *name)
+{
+	struct file *file;
+	char *path;
+	int i, retval = -ENOENT;
+
+	path = __getname();
+	if (!path)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(fw_path) && retval; i++) {
+		snprintf(path, PATH_MAX, "%s/%s", fw_path[i], name);
+		file = filp_open(path, O_RDONLY, 0);
+		if (IS_ERR(file))
+			continue;
+		retval = fw_read_file(file, entry);
+		filp_close(file, NULL);
+	}
+
+	if (!retval) {
+		entry->path = kstrdup(path, GFP_KERNEL);
+		entry->direct = entry->path != NULL;
 	}
 
+	__putname(path);
+	return retval;
+}
+
+/*
+ * Returns true if the file a cached image was read from has been
+ * replaced or changed since, going by its size and mtime.
+ */
+static bool fw_cache_stale(struct fw_cache_entry *entry)
+{
+	struct path path;
+	struct kstat stat;
+	int retval;
+
+	if (!entry->direct)
+		return false;
+
+	retval = kern_path(entry->path, LOOKUP_FOLLOW, &path);
+	if (retval)
+		return true;
+	retval = vfs_getattr(path.mnt, path.dentry, &stat);
+	path_put(&path);
+
+	return retval || stat.size != entry->fw.size ||
+		!timespec_equal(&stat.mtime, &entry->mtime);
+}
+#else
+static inline int fw_load_from_fs(struct fw_cache_entry *entry,
+				  const char *name)
+{
+	return -ENOENT;
+}
+
+static inline bool fw_cache_stale(struct fw_cache_entry *entry)
+{
+	return false;
+}
+#endif /* CONFIG_FW_LOADER_DIRECT */
+
+static int fw_load_with_helper(struct firmware *firmware, const char *name,
+			       struct device *device, bool uevent, bool nowait)
+{
+	struct firmware_priv *fw_priv;
+	int retval = 0;
+
 	if (WARN_ON(usermodehelper_is_disabled())) {
 		dev_err(device, "firmware: %s will not be loaded\n", name);
-		retval = -EBUSY;
-		goto out;
+		return -EBUSY;
 	}
 
 	if (uevent)
 		dev_dbg(device, "firmware: requesting %s\n", name);
 
 	fw_priv = fw_create_instance(firmware, name, device, uevent, nowait);
-	if (IS_ERR(fw_priv)) {
-		retval = PTR_ERR(fw_priv);
-		goto out;
-	}
+	if (IS_ERR(fw_priv))
+		return PTR_ERR(fw_priv);
 
 	if (uevent) {
 		if (loading_timeout > 0)
@@ -571,6 +943,81 @@ static int _request_firmware(const struct firmware **firmware_p,
 
 	fw_destroy_instance(fw_priv);
 
+	return retval;
+}
+
+static int _request_firmware(const struct firmware **firmware_p,
+			     const char *name, struct device *device,
+			     bool uevent, bool nowait)
+{
+	struct fw_cache_entry *entry;
+	struct firmware *firmware;
+	bool loader;
+	int retval = 0;
+
+	if (!firmware_p)
+		return -EINVAL;
+
+	*firmware_p = firmware = kzalloc(sizeof(*firmware), GFP_KERNEL);
+	if (!firmware) {
+		dev_err(device, "%s: kmalloc(struct firmware) failed\n",
+			__func__);
+		retval = -ENOMEM;
+		goto out;
+	}
+
+	if (fw_get_builtin_firmware(firmware, name)) {
+		dev_dbg(device, "firmware: using built-in firmware %s\n", name);
+		return 0;
+	}
+
+	entry = fw_cache_get(name, &loader);
+	if (entry && !loader) {
+		wait_for_completion(&entry->done);
+		if (!entry->status && fw_cache_stale(entry)) {
+			/*
+			 * The file changed under the cached image. Drop it and
+			 * look again: the next entry is either ours to load or
+			 * one loaded after the change.
+			 */
+			fw_cache_unhash(entry);
+			kref_put(&entry->ref, fw_cache_entry_release);
+			entry = fw_cache_get(name, &loader);
+			if (entry && !loader)
+				wait_for_completion(&entry->done);
+		}
+	}
+	if (!entry) {
+		retval = -ENOMEM;
+		goto out;
+	}
+
+	if (loader) {
+		retval = fw_load_from_fs(entry, name);
+		if (!retval) {
+			dev_dbg(device, "firmware: direct-loaded %s\n", name);
+			atomic_inc(&fw_direct_loads);
+		} else {
+			retval = fw_load_with_helper(&entry->fw, name, device,
+						     uevent, nowait);
+			if (!retval)
+				atomic_inc(&fw_helper_loads);
+		}
+		fw_cache_done(entry, retval);
+	} else {
+		retval = entry->status;
+	}
+
+	if (retval) {
+		kref_put(&entry->ref, fw_cache_entry_release);
+		goto out;
+	}
+
+	firmware->size = entry->fw.size;
+	firmware->data = entry->fw.data;
+	firmware->pages = entry->fw.pages;
+	firmware->priv = entry;
+
 out:
 	if (retval) {
 		release_firmware(firmware);
@@ -609,12 +1056,103 @@ request_firmware(const struct firmware **firmware_p, const char *name,
 void release_firmware(const struct firmware *fw)
 {
 	if (fw) {
-		if (!fw_is_builtin_firmware(fw))
+		if (fw->priv)
+			fw_cache_put(fw->priv);
+		else if (!fw_is_builtin_firmware(fw))
 			firmware_free_data(fw);
 		kfree(fw);
 	}
 }
 
+/*
+ * Adds a preloaded image to the cache unless a request got there first.
+ * Preloads never become the loader other requests wait for, so a
+ * request never sees the failure of a preload, which has no helper to
+ * fall back to.
+ */
+static void fw_cache_add(struct fw_cache_entry *new)
+{
+	struct fw_cache_entry *entry;
+
+	spin_lock(&fw_cache_lock);
+	list_for_each_entry(entry, &fw_cache, list) {
+		if (!strcmp(entry->name, new->name)) {
+			spin_unlock(&fw_cache_lock);
+			kref_put(&new->ref, fw_cache_entry_release);
+			return;
+		}
+	}
+	new->status = 0;
+	new->last_used = jiffies;
+	complete_all(&new->done);
+	list_add(&new->list, &fw_cache);
+	fw_cache_bytes += new->fw.size;
+	spin_unlock(&fw_cache_lock);
+
+	fw_cache_trim(fw_cache_limit);
+}
+
+static bool fw_cache_present(const char *name)
+{
+	struct fw_cache_entry *entry;
+	bool found = false;
+
+	spin_lock(&fw_cache_lock);
+	list_for_each_entry(entry, &fw_cache, list) {
+		if (!strcmp(entry->name, name)) {
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&fw_cache_lock);
+
+	return found;
+}
+
+static void fw_preload_func(void *data, async_cookie_t cookie)
+{
+	struct fw_cache_entry *entry;
+	char *name = data;
+
+	if (fw_cache_present(name))
+		goto out;
+
+	entry = fw_cache_alloc(name);
+	if (!entry)
+		goto out;
+
+	if (fw_load_from_fs(entry, name)) {
+		pr_warn("firmware: preload of %s failed\n", name);
+		kref_put(&entry->ref, fw_cache_entry_release);
+	} else {
+		atomic_inc(&fw_direct_loads);
+		fw_cache_add(entry);
+	}
+out:
+	kfree(name);
+}
+
+static void fw_cache_preload(const char *buf, size_t count)
+{
+	const char *end = buf + count;
+	char *name;
+	size_t len;
+
+	while (buf < end) {
+		buf = skip_spaces(buf);
+		len = 0;
+		while (buf + len < end && buf[len] && !isspace(buf[len]))
+			len++;
+		if (!len)
+			break;
+
+		name = kstrndup(buf, len, GFP_KERNEL);
+		if (name)
+			async_schedule(fw_preload_func, name);
+		buf += len;
+	}
+}
+
 /* Async support */
 struct firmware_work {
 	struct work_struct work;
@@ -708,6 +1246,8 @@ static int __init firmware_class_init(void)
 
 static void __exit firmware_class_exit(void)
 {
+	async_synchronize_full();
+	fw_cache_trim(0);
 	class_unregister(&firmware_class);
 }
 
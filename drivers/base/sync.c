@@ -18,6 +18,7 @@
 #include <linux/module.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/hash.h>
 #include <linux/kernel.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -39,8 +40,46 @@ static void sync_dump(void);
 static LIST_HEAD(sync_timeline_list_head);
 static DEFINE_SPINLOCK(sync_timeline_list_lock);
 
-static LIST_HEAD(sync_fence_list_head);
-static DEFINE_SPINLOCK(sync_fence_list_lock);
+/*
+ * Fences are spread over several lists so that fences created and released
+ * on different cpus do not contend on one lock.  The lists are only walked
+ * for debugging.
+ */
+#define SYNC_FENCE_LIST_BITS	4
+#define SYNC_FENCE_LIST_SIZE	(1 << SYNC_FENCE_LIST_BITS)
+
+struct sync_fence_list {
+	struct hlist_head	head;
+	spinlock_t		lock;
+};
+
+static struct sync_fence_list sync_fence_lists[SYNC_FENCE_LIST_SIZE] = {
+	[0 ... SYNC_FENCE_LIST_SIZE - 1] = {
+		.head = HLIST_HEAD_INIT,
+		.lock = __SPIN_LOCK_UNLOCKED(sync_fence_lists.lock),
+	},
+};
+
+/* merges with up to this many pts don't need to allocate a pt array */
+#define SYNC_MERGE_STACK_PTS	8
+
+static struct {
+	atomic_t	created;
+	atomic_t	merged;
+	atomic_t	freed;
+	atomic_t	deduped_pts;
+	atomic_t	waits;
+	atomic64_t	wait_ns;
+	atomic64_t	lifetime_ns;
+	/* updated without locking, only used for debugging */
+	u64		max_wait_ns;
+	u64		max_lifetime_ns;
+} sync_stats;
+
+static struct sync_fence_list *sync_fence_list_for(struct sync_fence *fence)
+{
+	return &sync_fence_lists[hash_ptr(fence, SYNC_FENCE_LIST_BITS)];
+}
 
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
@@ -253,6 +292,7 @@ static const struct file_operations sync_fence_fops = {
 static struct sync_fence *sync_fence_alloc(const char *name)
 {
 	struct sync_fence *fence;
+	struct sync_fence_list *list;
 	unsigned long flags;
 
 	fence = kzalloc(sizeof(struct sync_fence), GFP_KERNEL);
@@ -273,9 +313,13 @@ static struct sync_fence *sync_fence_alloc(const char *name)
 
 	init_waitqueue_head(&fence->wq);
 
-	spin_lock_irqsave(&sync_fence_list_lock, flags);
-	list_add_tail(&fence->sync_fence_list, &sync_fence_list_head);
-	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+	fence->timestamp = ktime_get();
+	atomic_inc(&sync_stats.created);
+
+	list = sync_fence_list_for(fence);
+	spin_lock_irqsave(&list->lock, flags);
+	hlist_add_head(&fence->sync_fence_list, &list->head);
+	spin_unlock_irqrestore(&list->lock, flags);
 
 	return fence;
 
@@ -310,44 +354,51 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt)
 }
 EXPORT_SYMBOL(sync_fence_create);
 
-static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src)
+static int sync_fence_count_pts(struct sync_fence *fence)
 {
-	struct list_head *pos, *test_pos;
+	struct sync_pt *pt;
+	int count = 0;
 
-	list_for_each(pos, &src->pt_list_head) {
-		struct sync_pt *orig_pt =
-			container_of(pos, struct sync_pt, pt_list);
-		struct sync_pt *new_pt;
+	list_for_each_entry(pt, &fence->pt_list_head, pt_list)
+		count++;
+
+	return count;
+}
+
+/*
+ * Adds the unsignaled pts of @src to the @pts array, which already holds
+ * @num_pts entries.  Only the pt which signals last is kept for each
+ * sync_timeline.  Returns the new number of entries.
+ */
+static int sync_fence_collect_pts(struct sync_pt **pts, int num_pts,
+				  struct sync_fence *src)
+{
+	struct sync_pt *orig_pt;
+	int i;
 
+	list_for_each_entry(orig_pt, &src->pt_list_head, pt_list) {
 		/* Skip already signaled points */
 		if (1 == orig_pt->status)
 			continue;
 
-		list_for_each(test_pos, &src->pt_list_head) {
-			struct sync_pt *test_pt =
-				container_of(pos, struct sync_pt, pt_list);
-			if (orig_pt->parent == test_pt->parent) {
-				int diff;
-				diff = orig_pt->parent->ops->compare(orig_pt, test_pt);
-				if (diff == -1) {
-					/* Skip orig_pt; another point will
-					 * signal after it */
-					continue;
-				}
+		for (i = 0; i < num_pts; i++) {
+			if (pts[i]->parent == orig_pt->parent)
 				break;
-			}
 		}
 
-		new_pt = sync_pt_dup(orig_pt);
+		if (i == num_pts) {
+			pts[num_pts++] = orig_pt;
+			continue;
+		}
 
-		if (new_pt == NULL)
-			return -ENOMEM;
+		atomic_inc(&sync_stats.deduped_pts);
 
-		new_pt->fence = dst;
-		list_add(&new_pt->pt_list, &dst->pt_list_head);
+		/* replace the collected pt if it will signal before orig_pt */
+		if (orig_pt->parent->ops->compare(pts[i], orig_pt) == -1)
+			pts[i] = orig_pt;
 	}
 
-	return 0;
+	return num_pts;
 }
 
 static void sync_fence_detach_pts(struct sync_fence *fence)
@@ -423,26 +474,39 @@ static int sync_fence_get_status(struct sync_fence *fence)
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b)
 {
+	struct sync_pt *stack_pts[SYNC_MERGE_STACK_PTS];
+	struct sync_pt **pts = stack_pts;
 	struct list_head *pos;
 	struct sync_fence *fence;
-	int err;
+	int num_pts = 0;
+	int max_pts;
+	int i;
+
+	max_pts = sync_fence_count_pts(a) + sync_fence_count_pts(b);
+	if (max_pts > ARRAY_SIZE(stack_pts)) {
+		pts = kmalloc(max_pts * sizeof(*pts), GFP_KERNEL);
+		if (pts == NULL)
+			return NULL;
+	}
+
+	/* pick the pts first so that only the ones we keep get duplicated */
+	num_pts = sync_fence_collect_pts(pts, num_pts, a);
+	num_pts = sync_fence_collect_pts(pts, num_pts, b);
+
+	/* Make sure there is at least one point in the fence */
+	if (num_pts == 0)
+		pts[num_pts++] = list_first_entry(&a->pt_list_head,
+						  struct sync_pt, pt_list);
 
 	fence = sync_fence_alloc(name);
 	if (fence == NULL)
-		return NULL;
-
-	err = sync_fence_copy_pts(fence, a);
-	if (err < 0)
-		goto err;
+		goto out;
 
-	err = sync_fence_copy_pts(fence, b);
-	if (err < 0)
-		goto err;
+	for (i = 0; i < num_pts; i++) {
+		struct sync_pt *new_pt = sync_pt_dup(pts[i]);
 
-	/* Make sure there is at least one point in the fence */
-	if (list_empty(&fence->pt_list_head)) {
-		struct sync_pt *orig_pt = list_first_entry(&a->pt_list_head, struct sync_pt, pt_list);
-		struct sync_pt *new_pt = sync_pt_dup(orig_pt);
+		if (new_pt == NULL)
+			goto err;
 
 		new_pt->fence = fence;
 		list_add(&new_pt->pt_list, &fence->pt_list_head);
@@ -462,11 +526,17 @@ struct sync_fence *sync_fence_merge(const char *name,
 					      struct sync_pt,
 					      pt_list));
 
+	atomic_inc(&sync_stats.merged);
+out:
+	if (pts != stack_pts)
+		kfree(pts);
 	return fence;
+
 err:
-	sync_fence_free_pts(fence);
-	kfree(fence);
-	return NULL;
+	/* releasing the file detaches and frees the pts added so far */
+	sync_fence_put(fence);
+	fence = NULL;
+	goto out;
 }
 EXPORT_SYMBOL(sync_fence_merge);
 
@@ -479,6 +549,14 @@ static void sync_fence_signal_pt(struct sync_pt *pt)
 	unsigned long flags;
 	int status;
 
+	/*
+	 * a fence signals only once.  When a timeline signals several pts of
+	 * the same fence, only the first one needs to walk the pts and wake
+	 * the waiters.
+	 */
+	if (fence->status)
+		return;
+
 	status = sync_fence_get_status(fence);
 
 	spin_lock_irqsave(&fence->waiter_list_lock, flags);
@@ -569,10 +647,21 @@ static bool sync_fence_check(struct sync_fence *fence)
 	return fence->status != 0;
 }
 
+static void sync_fence_account_wait(ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	atomic_inc(&sync_stats.waits);
+	atomic64_add(ns, &sync_stats.wait_ns);
+	if (ns > sync_stats.max_wait_ns)
+		sync_stats.max_wait_ns = ns;
+}
+
 int sync_fence_wait(struct sync_fence *fence, long timeout)
 {
 	int err = 0;
 	struct sync_pt *pt;
+	ktime_t start = ktime_get();
 
 	trace_sync_wait(fence, 1);
 	list_for_each_entry(pt, &fence->pt_list_head, pt_list)
@@ -588,6 +677,7 @@ int sync_fence_wait(struct sync_fence *fence, long timeout)
 					       sync_fence_check(fence));
 	}
 	trace_sync_wait(fence, 0);
+	sync_fence_account_wait(start);
 
 	if (err < 0)
 		return err;
@@ -614,6 +704,12 @@ EXPORT_SYMBOL(sync_fence_wait);
 static void sync_fence_free(struct kref *kref)
 {
 	struct sync_fence *fence = container_of(kref, struct sync_fence, kref);
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), fence->timestamp));
+
+	atomic_inc(&sync_stats.freed);
+	atomic64_add(ns, &sync_stats.lifetime_ns);
+	if (ns > sync_stats.max_lifetime_ns)
+		sync_stats.max_lifetime_ns = ns;
 
 	sync_fence_free_pts(fence);
 
@@ -623,6 +719,7 @@ static void sync_fence_free(struct kref *kref)
 static int sync_fence_release(struct inode *inode, struct file *file)
 {
 	struct sync_fence *fence = file->private_data;
+	struct sync_fence_list *list = sync_fence_list_for(fence);
 	unsigned long flags;
 
 	/*
@@ -631,9 +728,9 @@ static int sync_fence_release(struct inode *inode, struct file *file)
 	 *
 	 * start with its membership in the global fence list
 	 */
-	spin_lock_irqsave(&sync_fence_list_lock, flags);
-	list_del(&fence->sync_fence_list);
-	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+	spin_lock_irqsave(&list->lock, flags);
+	hlist_del(&fence->sync_fence_list);
+	spin_unlock_irqrestore(&list->lock, flags);
 
 	/*
 	 * remove its pts from their parents so that sync_timeline_signal()
@@ -920,6 +1017,7 @@ static int sync_debugfs_show(struct seq_file *s, void *unused)
 {
 	unsigned long flags;
 	struct list_head *pos;
+	int i;
 
 	seq_printf(s, "objs:\n--------------\n");
 
@@ -936,18 +1034,54 @@ static int sync_debugfs_show(struct seq_file *s, void *unused)
 
 	seq_printf(s, "fences:\n--------------\n");
 
-	spin_lock_irqsave(&sync_fence_list_lock, flags);
-	list_for_each(pos, &sync_fence_list_head) {
-		struct sync_fence *fence =
-			container_of(pos, struct sync_fence, sync_fence_list);
+	for (i = 0; i < SYNC_FENCE_LIST_SIZE; i++) {
+		struct sync_fence_list *list = &sync_fence_lists[i];
+		struct sync_fence *fence;
+		struct hlist_node *node;
 
-		sync_print_fence(s, fence);
-		seq_printf(s, "\n");
+		spin_lock_irqsave(&list->lock, flags);
+		hlist_for_each_entry(fence, node, &list->head,
+				     sync_fence_list) {
+			sync_print_fence(s, fence);
+			seq_printf(s, "\n");
+		}
+		spin_unlock_irqrestore(&list->lock, flags);
 	}
-	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
 	return 0;
 }
 
+static int sync_stats_debugfs_show(struct seq_file *s, void *unused)
+{
+	int waits = atomic_read(&sync_stats.waits);
+	int freed = atomic_read(&sync_stats.freed);
+
+	seq_printf(s, "fences created: %d\n", atomic_read(&sync_stats.created));
+	seq_printf(s, "fences merged: %d\n", atomic_read(&sync_stats.merged));
+	seq_printf(s, "fences freed: %d\n", freed);
+	seq_printf(s, "pts deduplicated on merge: %d\n",
+		   atomic_read(&sync_stats.deduped_pts));
+	seq_printf(s, "lifetime avg: %llu ns max: %llu ns\n",
+		   freed ? div_u64(atomic64_read(&sync_stats.lifetime_ns), freed) : 0,
+		   sync_stats.max_lifetime_ns);
+	seq_printf(s, "waits: %d\n", waits);
+	seq_printf(s, "wait avg: %llu ns max: %llu ns\n",
+		   waits ? div_u64(atomic64_read(&sync_stats.wait_ns), waits) : 0,
+		   sync_stats.max_wait_ns);
+	return 0;
+}
+
+static int sync_stats_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sync_stats_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations sync_stats_debugfs_fops = {
+	.open           = sync_stats_debugfs_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int sync_debugfs_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, sync_debugfs_show, inode->i_private);
@@ -963,6 +1097,8 @@ static const struct file_operations sync_debugfs_fops = {
 static __init int sync_debugfs_init(void)
 {
 	debugfs_create_file("sync", S_IRUGO, NULL, NULL, &sync_debugfs_fops);
+	debugfs_create_file("sync_stats", S_IRUGO, NULL, NULL,
+			    &sync_stats_debugfs_fops);
 	return 0;
 }
 late_initcall(sync_debugfs_init);
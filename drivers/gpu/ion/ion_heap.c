@@ -23,6 +23,9 @@
 #include <linux/sched.h>
 #include <linux/scatterlist.h>
 #include <linux/vmalloc.h>
+#ifdef CONFIG_ARM_NEON_COPY
+#include <asm/neon.h>
+#endif
 #include "ion_priv.h"
 
 void *ion_heap_map_kernel(struct ion_heap *heap,
@@ -108,7 +111,11 @@ static int ion_heap_clear_pages(struct page **pages, int num, pgprot_t pgprot)
 	void *addr = vm_map_ram(pages, num, -1, pgprot);
 	if (!addr)
 		return -ENOMEM;
+#ifdef CONFIG_ARM_NEON_COPY
+	neon_memzero(addr, PAGE_SIZE * num);
+#else
 	memset(addr, 0, PAGE_SIZE * num);
+#endif
 	vm_unmap_ram(addr, num);
 
 	return 0;
@@ -106,6 +106,43 @@ static void free_buffer_page(struct ion_system_heap *heap,
 }
 
 
+/*
+ * Once a cached buffer is down to order-0 pages, the rest are taken in
+ * chunks of up to ION_BULK_PAGES with alloc_pages_bulk(), which refills
+ * the per-cpu list once per chunk rather than once per batch.
+ */
+#define ION_BULK_PAGES	256
+
+static unsigned long alloc_order0_bulk(struct ion_buffer *buffer,
+				       unsigned long nr_pages,
+				       struct list_head *pages)
+{
+	struct page **array;
+	struct page_info *info;
+	unsigned long nr, i, j;
+
+	array = kmalloc(nr_pages * sizeof(*array), GFP_KERNEL);
+	if (!array)
+		return 0;
+
+	nr = alloc_pages_bulk(low_order_gfp_flags, nr_pages, array);
+	for (i = 0; i < nr; i++) {
+		info = kmalloc(sizeof(struct page_info), GFP_KERNEL);
+		if (!info)
+			break;
+		__dma_page_cpu_to_dev(array[i], 0, PAGE_SIZE,
+				      DMA_BIDIRECTIONAL);
+		info->page = array[i];
+		info->order = 0;
+		list_add_tail(&info->list, pages);
+	}
+	for (j = i; j < nr; j++)
+		__free_page(array[j]);
+
+	kfree(array);
+	return i;
+}
+
 static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 						 struct ion_buffer *buffer,
 						 unsigned long size,
@@ -158,6 +195,21 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 
 	INIT_LIST_HEAD(&pages);
 	while (size_remaining > 0) {
+		if (!max_order && ion_buffer_cached(buffer)) {
+			unsigned long nr;
+
+			nr = alloc_order0_bulk(buffer,
+					       min_t(unsigned long,
+						     size_remaining / PAGE_SIZE,
+						     ION_BULK_PAGES),
+					       &pages);
+			if (!nr)
+				goto err;
+			size_remaining -= nr * PAGE_SIZE;
+			i += nr;
+			continue;
+		}
+
 		info = alloc_largest_available(sys_heap, buffer, size_remaining, max_order);
 		if (!info)
 			goto err;
@@ -8,6 +8,7 @@
  * published by the Free Software Foundation.
  */
 #include <linux/kernel.h>
+#include <linux/ctype.h>
 #include <linux/syscalls.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
@@ -15,6 +16,15 @@
 #include <linux/time.h>
 #include <linux/uaccess.h>
 #include <linux/fs.h>
+#include <linux/io.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/module.h>
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+#include <linux/lz4.h>
+#endif
 #include <mntn/excDrv.h>
 #include <bsp_ao_sctrl.h>
 #include "mntn_save_logdata.h"
@@ -38,9 +48,85 @@ Define macros here
 
 #define MODEM_SYS_MEM_SAVE_SIZE 0x06F00000
 
+#define MNTN_LOG_RING_MAGIC		0x474e5252	/*"RRNG"*/
+#define MNTN_LOG_RING_INDEX		"_ring.idx"
+#define MNTN_LOG_RING_STAMP		"reason.txt"
+
+#define MNTN_SNAP_FILE_SUFFIX	".lz4"
+#define MNTN_SNAP_CHUNK_SIZE	(64 * 1024)	/*also the lz4 frame block max size, see BD below*/
+#define MNTN_SNAP_ARENA_SIZE	(1024 * 1024)	/*largest arena, small regions get one sized to fit*/
+#define MNTN_SNAP_ARENA_HDR_SIZE	offsetof(struct mntn_snap_arena, data)
+#define MNTN_SNAP_MAX_SIZE		(48 * 1024 * 1024)	/*RAM allowed for snapshots not yet written*/
+
+#define MNTN_SAVE_JOB_HISTORY_MAX	2
+
+/*
+ * LZ4 frame format (lz4 -d reads it): magic, FLG = version 01 with
+ * independent blocks and no checksums, BD = 64KB max block, HC = second
+ * byte of xxh32(FLG BD), fixed since the descriptor never changes.
+ */
+#define MNTN_LZ4_FRAME_FLG		0x60
+#define MNTN_LZ4_FRAME_BD		0x40
+#define MNTN_LZ4_FRAME_HC		0x82
+#define MNTN_LZ4_BLOCK_UNCOMPRESSED	0x80000000
+
+/*dirs named by mntn_get_cur_time_str, used before the log ring*/
+#define MNTN_LEGACY_DIR_NAME_LEN	15	/*"yyyymmdd-hhmmss"*/
+
+/********************************************************************
+Define struct here
+********************************************************************/
+/*index of the log ring of a subsystem, "<logdir><name>_ring.idx"*/
+struct mntn_log_ring_index {
+    unsigned int magic;
+    unsigned int next;		/*slot the next log goes to, the oldest one*/
+    unsigned int count;		/*logs saved so far*/
+};
+
+struct mntn_snap_arena {
+    struct list_head list;
+    unsigned int size;		/*bytes allocated, header included, charged to the budget*/
+    unsigned int used;
+    unsigned char data[0];
+};
+
+/*RAM image of one log file, or the open file once it is streamed*/
+struct mntn_snap_region {
+    struct list_head list;
+    struct list_head arenas;
+    char filename[MNTN_RGZNAME_SZ];
+    unsigned int raw_len;
+    unsigned int file_len;
+    unsigned int bound;		/*largest the file image can get*/
+    long fd;		/*>= 0 once the region no longer fits in RAM*/
+};
+
+/*one subsystem reset: snapshots taken in the reset path, written later*/
+struct mntn_save_job {
+    struct work_struct work;
+    struct list_head regions;
+    const char *plogdir;
+    const char *pname;
+    const char *phistory[MNTN_SAVE_JOB_HISTORY_MAX];
+    unsigned int uring_max;
+    umode_t dir_mode;
+    int dir_ready;
+    char slotdir[MNTN_FULLPATH_STRING_LEN + 1];
+    char time_arr[MNTN_TIME_STRING_LEN + 1];
+    char reason[MNTN_FULLPATH_STRING_LEN + 1];
+};
+
 /********************************************************************
 Define global variables here
 ********************************************************************/
+static struct workqueue_struct *mntn_logsave_wq;
+static DEFINE_MUTEX(mntn_snap_mutex);
+static atomic_t mntn_snap_bytes = ATOMIC_INIT(0);
+static unsigned char *mntn_snap_bounce;
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+static unsigned char *mntn_snap_lz4buf;
+static void *mntn_snap_wrkmem;
+#endif
 
 /********************************************************************
 extern global variables here
@@ -54,11 +140,7 @@ extern unsigned int g_dump_size;
 /********************************************************************
 extern functions here
 *******************************************************************/
-extern void mntn_rm_old_log(const char *path, unsigned int unumber);
 extern unsigned int get_boot_into_recovery_flag(void);
-extern void sort(void *base, size_t num, size_t size,
-	  int (*cmp_func)(const void *, const void *),
-	  void (*swap_func)(void *, void *, int size));
 extern int mcpu_debug_req(void);
 extern int read_nogui_flag(void);
 extern int mcpu_pll_enable_set(void);
@@ -270,51 +352,594 @@ int mntn_upadte_history_info(const char *pdir, const char *ptimestr, const char
 
     return iret;
 }
-int mntn_str_cmp(const void *a, const void *b)
+static int mntn_log_ring_read_index(const char *pindex, struct mntn_log_ring_index *pidx)
 {
-    return strncmp((char *)a, (char *)b, MNTN_FILESYS_PURE_DIR_NAME_LEN);
+    long    fd = 0;
+    int    bytes = 0;
+    mm_segment_t old_fs = 0;
+
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    fd = sys_open(pindex, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        set_fs(old_fs);
+        return -1;
+    }
+    bytes = sys_read((unsigned int)fd, (char *)pidx, sizeof(*pidx));
+    (void)sys_close((unsigned int)fd);
+    set_fs(old_fs);
+
+    if ((bytes != sizeof(*pidx)) || (MNTN_LOG_RING_MAGIC != pidx->magic))
+    {
+        return -1;
+    }
+    return 0;
 }
 
+static int mntn_log_ring_write_index(const char *pindex, struct mntn_log_ring_index *pidx)
+{
+    long    fd = 0;
+    int    bytes = 0;
+    int    iret = 0;
+    mm_segment_t old_fs = 0;
 
-void mntn_rm_old_log(const char *ppath, unsigned int unumber)
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    fd = sys_open(pindex, O_CREAT | O_RDWR | O_TRUNC, MNTN_LOG_FILE_PRO_VALUE);
+    if (fd < 0)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to open %s!\n", pindex);
+        set_fs(old_fs);
+        return -1;
+    }
+    bytes = sys_write((unsigned int)fd, (const char *)pidx, sizeof(*pidx));
+    if (bytes != sizeof(*pidx))
+    {
+        iret = -1;
+    }
+    iret += sys_fsync((unsigned int)fd);
+    (void)sys_close((unsigned int)fd);
+    set_fs(old_fs);
+
+    (void)mntn_filesys_chown(pindex, MNTN_LOG_FILE_OWNER_UID, MNTN_LOG_FILE_OWNER_GID);
+    return iret;
+}
+
+static int mntn_log_is_legacy_dir(const char *pname)
+{
+    int i = 0;
+
+    if (MNTN_LEGACY_DIR_NAME_LEN != strnlen(pname, MNTN_FILESYS_PURE_DIR_NAME_LEN))
+    {
+        return 0;
+    }
+    for (i = 0; i < MNTN_LEGACY_DIR_NAME_LEN; i++)
+    {
+        if ((8 == i) ? ('-' != pname[i]) : !isdigit(pname[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Drop the time named log dirs left by the old scheme, which pruned them by
+ * listing and sorting the log dir. Only done once, when the ring of the
+ * log dir is set up, so the listing stays out of the normal save path.
+ */
+static void mntn_log_ring_rm_legacy(const char *plogdir)
 {
     char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
-    int       i = 0;
-    int       iret = 0;
-    unsigned int ulen = 0;
-    int	tmp_cnt = MNTN_FILESYS_MAX_CYCLE * MNTN_FILESYS_PURE_DIR_NAME_LEN;	
     char    *pbuff = NULL;
+    char    *pname = NULL;
+    int    tmp_cnt = MNTN_FILESYS_MAX_CYCLE * MNTN_FILESYS_PURE_DIR_NAME_LEN;
+    int    i = 0;
 
-    pbuff = kmalloc(tmp_cnt, GFP_KERNEL);
+    /*the lister may store one name past cnt*/
+    pbuff = kzalloc(tmp_cnt + MNTN_FILESYS_PURE_DIR_NAME_LEN, GFP_KERNEL);
     if (NULL == pbuff)
     {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to kmalloc when removing old log\n");    
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to kmalloc when removing old log\n");
         return;
     }
-    memset((void*)pbuff, 0, tmp_cnt);
-    tmp_cnt = mntn_filesys_dir_list(ppath, pbuff, tmp_cnt, DT_DIR);
-    if (tmp_cnt >= unumber)
+
+    tmp_cnt = mntn_filesys_dir_list(plogdir, pbuff, tmp_cnt, DT_DIR);
+    for (i = 0; i < tmp_cnt; i++)
     {
-        sort((void*)pbuff, tmp_cnt, MNTN_FILESYS_PURE_DIR_NAME_LEN, mntn_str_cmp, NULL);
-        for (i = 0;i < (tmp_cnt - unumber + 1);i++)
+        pname = pbuff + i * MNTN_FILESYS_PURE_DIR_NAME_LEN;
+        if (!mntn_log_is_legacy_dir(pname))
         {
-            strncat(fullpath_arr, ppath, strlen(ppath));
-	     ulen = strlen(pbuff + i * MNTN_FILESYS_PURE_DIR_NAME_LEN);
-            strncat(fullpath_arr, (const char*)(pbuff + i * MNTN_FILESYS_PURE_DIR_NAME_LEN), ulen);
-	     strncat(fullpath_arr, "/", strlen("/"));
-	     
-            iret = mntn_filesys_rm_all_file(fullpath_arr);
-            iret += mntn_filesys_rm_dir(fullpath_arr);
-	     if (0 != iret)
-            {
-	         MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to rm dir, %d", i);
-	     }
-	     memset((void*)fullpath_arr, 0, sizeof(fullpath_arr));
-        }	 
+            continue;
+        }
+        snprintf(fullpath_arr, MNTN_FULLPATH_STRING_LEN, "%s%s/", plogdir, pname);
+        (void)mntn_filesys_rm_all_file(fullpath_arr);
+        if (0 != mntn_filesys_rm_dir(fullpath_arr))
+        {
+            MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to rm old log dir %s\n", fullpath_arr);
+        }
     }
     kfree(pbuff);
 }
 
+/*
+ * Take the next slot of the log ring of a subsystem. The ring is a fixed
+ * set of directories "<name>_log<n>" in the log dir, the index file only
+ * remembers which one is the oldest, so nothing has to be listed or
+ * sorted and the old log is simply overwritten.
+ */
+static int mntn_save_job_prepare_dir(struct mntn_save_job *pjob)
+{
+    char    index_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    char    stamp_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    char    countent_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    struct mntn_log_ring_index    idx;
+    unsigned int    uslot = 0;
+    int iret = 0;
+
+    if (pjob->dir_ready)
+    {
+        return 0;
+    }
+
+    snprintf(index_arr, MNTN_FULLPATH_STRING_LEN, "%s%s%s", pjob->plogdir, pjob->pname, MNTN_LOG_RING_INDEX);
+    if (0 != mntn_log_ring_read_index(index_arr, &idx))
+    {
+        mntn_log_ring_rm_legacy(pjob->plogdir);
+        memset(&idx, 0, sizeof(idx));
+        idx.magic = MNTN_LOG_RING_MAGIC;
+    }
+    else if (idx.next >= pjob->uring_max)
+    {
+        memset(&idx, 0, sizeof(idx));
+        idx.magic = MNTN_LOG_RING_MAGIC;
+    }
+    uslot = idx.next;
+    idx.next = (uslot + 1) % pjob->uring_max;
+    idx.count++;
+    iret += mntn_log_ring_write_index(index_arr, &idx);
+
+    snprintf(pjob->slotdir, MNTN_FULLPATH_STRING_LEN, "%s%s_log%u/", pjob->plogdir, pjob->pname, uslot);
+
+    /*the slot may hold an old log, drop its files and reuse the dir*/
+    (void)mntn_filesys_rm_all_file(pjob->slotdir);
+    iret += mntn_filesys_create_dir(pjob->slotdir, pjob->dir_mode);
+    if (0 != iret)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to prepare log dir %s!\n", pjob->slotdir);
+    }
+    (void)mntn_filesys_chown((const char *)pjob->slotdir, MNTN_LOG_DIR_OWNER_UID, MNTN_LOG_DIR_OWNER_GID);
+
+    /*the dir is no longer named by time, keep the time and reason inside*/
+    snprintf(stamp_arr, MNTN_FULLPATH_STRING_LEN, "%s%s", pjob->slotdir, MNTN_LOG_RING_STAMP);
+    snprintf(countent_arr, MNTN_FULLPATH_STRING_LEN, "%s : %s", pjob->time_arr, pjob->reason);
+    (void)mntn_filesys_write_log(stamp_arr, countent_arr, strlen(countent_arr), MNTN_LOG_FILE_PRO_VALUE);
+
+    pjob->dir_ready = 1;
+    return iret;
+}
+
+static void mntn_snap_free_region(struct mntn_snap_region *pregion)
+{
+    struct mntn_snap_arena *parena = NULL;
+    struct mntn_snap_arena *ptmp = NULL;
+
+    list_for_each_entry_safe(parena, ptmp, &pregion->arenas, list)
+    {
+        list_del(&parena->list);
+        atomic_sub(parena->size, &mntn_snap_bytes);
+        vfree(parena);
+    }
+    kfree(pregion);
+}
+
+static int mntn_snap_write(long fd, const void *pdata, unsigned int ulen)
+{
+    int    bytes = 0;
+    mm_segment_t old_fs = 0;
+
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    bytes = sys_write((unsigned int)fd, (const char *)pdata, ulen);
+    set_fs(old_fs);
+    if (bytes != ulen)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to write all the data into the file, %d/%u\n", bytes, ulen);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * The snapshot budget is used up: open the log file in the slot dir, move
+ * what the region holds so far into it and free the arenas. The rest of
+ * the region is compressed straight into the file. The subsystem is still
+ * held in reset, so nothing is lost, the reset only waits for this region.
+ */
+static int mntn_snap_spill(struct mntn_save_job *pjob, struct mntn_snap_region *pregion)
+{
+    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    struct mntn_snap_arena *parena = NULL;
+    struct mntn_snap_arena *ptmp = NULL;
+    mm_segment_t old_fs = 0;
+    int iret = 0;
+
+    (void)mntn_save_job_prepare_dir(pjob);
+
+    snprintf(fullpath_arr, MNTN_FULLPATH_STRING_LEN, "%s%s", pjob->slotdir, pregion->filename);
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    pregion->fd = sys_open(fullpath_arr, O_CREAT | O_WRONLY | O_TRUNC, MNTN_LOG_FILE_PRO_VALUE);
+    set_fs(old_fs);
+    if (pregion->fd < 0)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to open %s!, fd %lx\n", pregion->filename, pregion->fd);
+        return -1;
+    }
+    MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: no room to snapshot %s, stream it now\n", pregion->filename);
+
+    list_for_each_entry_safe(parena, ptmp, &pregion->arenas, list)
+    {
+        iret = iret ? iret : mntn_snap_write(pregion->fd, parena->data, parena->used);
+        list_del(&parena->list);
+        atomic_sub(parena->size, &mntn_snap_bytes);
+        vfree(parena);
+    }
+    return iret;
+}
+
+/*close the file of a streamed region, the writer thread has nothing left to do for it*/
+static int mntn_snap_close(struct mntn_save_job *pjob, struct mntn_snap_region *pregion)
+{
+    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    mm_segment_t old_fs = 0;
+    int iret = 0;
+
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    iret = sys_fsync((unsigned int)pregion->fd);
+    (void)sys_close((unsigned int)pregion->fd);
+    set_fs(old_fs);
+    pregion->fd = -1;
+
+    snprintf(fullpath_arr, MNTN_FULLPATH_STRING_LEN, "%s%s", pjob->slotdir, pregion->filename);
+    iret += mntn_filesys_chown((const char *)fullpath_arr, MNTN_LOG_FILE_OWNER_UID, MNTN_LOG_FILE_OWNER_GID);
+    MNTN_FILESYS_PRINT(KERN_INFO"mntn: saved %s, %u -> %u bytes\n", pregion->filename, pregion->raw_len, pregion->file_len);
+    return iret;
+}
+
+/*
+ * Append data to the file image of a region, growing it by one arena at a
+ * time. An arena is no larger than what is left of the region bound, so a
+ * small region costs the budget about its own size rather than a whole
+ * MNTN_SNAP_ARENA_SIZE, and the last arena may take whatever is left of the
+ * budget. Once the budget is used up the region is streamed to its file
+ * instead.
+ */
+static int mntn_snap_append(struct mntn_save_job *pjob, struct mntn_snap_region *pregion,
+                            const void *pdata, unsigned int ulen)
+{
+    struct mntn_snap_arena *parena = NULL;
+    unsigned int    ucopy = 0;
+    unsigned int    usize = 0;
+    unsigned int    uleft = 0;
+    int iret = 0;
+
+    if (pregion->fd >= 0)
+    {
+        pregion->file_len += ulen;
+        return mntn_snap_write(pregion->fd, pdata, ulen);
+    }
+
+    while (ulen > 0)
+    {
+        parena = list_empty(&pregion->arenas) ? NULL :
+                 list_entry(pregion->arenas.prev, struct mntn_snap_arena, list);
+        if ((NULL == parena) || (parena->used == parena->size - MNTN_SNAP_ARENA_HDR_SIZE))
+        {
+            parena = NULL;
+            usize = MNTN_SNAP_ARENA_HDR_SIZE + max(ulen, pregion->bound - min(pregion->bound, pregion->file_len));
+            usize = min(usize, (unsigned int)MNTN_SNAP_ARENA_SIZE);
+            uleft = MNTN_SNAP_MAX_SIZE - min(MNTN_SNAP_MAX_SIZE, atomic_read(&mntn_snap_bytes));
+            usize = min(usize, uleft);
+            if (usize > MNTN_SNAP_ARENA_HDR_SIZE)
+            {
+                parena = vmalloc(usize);
+            }
+            if (NULL == parena)
+            {
+                iret = mntn_snap_spill(pjob, pregion);
+                return iret ? iret : mntn_snap_append(pjob, pregion, pdata, ulen);
+            }
+            atomic_add(usize, &mntn_snap_bytes);
+            parena->size = usize;
+            parena->used = 0;
+            list_add_tail(&parena->list, &pregion->arenas);
+        }
+
+        ucopy = min(ulen, (unsigned int)(parena->size - MNTN_SNAP_ARENA_HDR_SIZE - parena->used));
+        memcpy(parena->data + parena->used, pdata, ucopy);
+        parena->used += ucopy;
+        pregion->file_len += ucopy;
+        pdata = (const unsigned char *)pdata + ucopy;
+        ulen -= ucopy;
+    }
+    return 0;
+}
+
+/*
+ * Give the slack of the last arena of a snapshotted region back to the
+ * budget, so that a large region after it, the modem memory taken last in
+ * a modem reset, still fits in RAM rather than being streamed from the
+ * reset path.
+ */
+static void mntn_snap_trim(struct mntn_snap_region *pregion)
+{
+    struct mntn_snap_arena *parena = NULL;
+    struct mntn_snap_arena *ptight = NULL;
+    unsigned int    usize = 0;
+
+    if (list_empty(&pregion->arenas))
+    {
+        return;
+    }
+    parena = list_entry(pregion->arenas.prev, struct mntn_snap_arena, list);
+    usize = MNTN_SNAP_ARENA_HDR_SIZE + parena->used;
+    if (parena->size - usize < MNTN_SNAP_CHUNK_SIZE)
+    {
+        return;
+    }
+    ptight = vmalloc(usize);
+    if (NULL == ptight)
+    {
+        return;
+    }
+    memcpy(ptight->data, parena->data, parena->used);
+    ptight->size = usize;
+    ptight->used = parena->used;
+    list_replace(&parena->list, &ptight->list);
+    atomic_sub(parena->size - usize, &mntn_snap_bytes);
+    vfree(parena);
+}
+
+/*
+ * Copy a memory region into RAM, as an LZ4 frame of 64KB blocks when LZ4
+ * is available, so that the subsystem can be restarted before the log is
+ * written. The region is read with memcpy_fromio into a bounce buffer
+ * since the compressor does unaligned loads. Caller holds mntn_snap_mutex.
+ */
+static int mntn_snap_virtual_region(struct mntn_save_job *pjob, const void __iomem *pviradd,
+                                    unsigned int ulen, const char *pfilename)
+{
+    struct mntn_snap_region *pregion = NULL;
+    unsigned int    uoff = 0;
+    unsigned int    uchunk = 0;
+    int iret = 0;
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    static const unsigned char frame_hdr[] = {
+        0x04, 0x22, 0x4d, 0x18,		/*magic 0x184d2204, little endian*/
+        MNTN_LZ4_FRAME_FLG, MNTN_LZ4_FRAME_BD, MNTN_LZ4_FRAME_HC
+    };
+    __le32    block_size = 0;
+    size_t    clen = 0;
+#endif
+
+    if (NULL == mntn_snap_bounce)
+    {
+        return -ENOMEM;
+    }
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    if ((NULL == mntn_snap_lz4buf) || (NULL == mntn_snap_wrkmem))
+    {
+        return -ENOMEM;
+    }
+#endif
+
+    pregion = kzalloc(sizeof(*pregion), GFP_KERNEL);
+    if (NULL == pregion)
+    {
+        return -ENOMEM;
+    }
+    INIT_LIST_HEAD(&pregion->arenas);
+    pregion->raw_len = ulen;
+    pregion->fd = -1;
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    /*also covers the frame header, block sizes and end mark*/
+    pregion->bound = lz4_compressbound(ulen);
+#else
+    pregion->bound = ulen;
+#endif
+    strncpy(pregion->filename, pfilename, MNTN_RGZNAME_SZ - sizeof(MNTN_SNAP_FILE_SUFFIX));
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    strncat(pregion->filename, MNTN_SNAP_FILE_SUFFIX, strlen(MNTN_SNAP_FILE_SUFFIX));
+    iret = mntn_snap_append(pjob, pregion, frame_hdr, sizeof(frame_hdr));
+#endif
+
+    for (uoff = 0; (0 == iret) && (uoff < ulen); uoff += uchunk)
+    {
+        uchunk = min(ulen - uoff, (unsigned int)MNTN_SNAP_CHUNK_SIZE);
+        memcpy_fromio(mntn_snap_bounce, pviradd + uoff, uchunk);
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+        /*blocks that do not shrink are stored as they are, flagged in the size*/
+        if ((0 == lz4_compress(mntn_snap_bounce, uchunk, mntn_snap_lz4buf, &clen, mntn_snap_wrkmem))
+            && (clen < uchunk))
+        {
+            block_size = cpu_to_le32(clen);
+            iret = mntn_snap_append(pjob, pregion, &block_size, sizeof(block_size));
+            iret = iret ? iret : mntn_snap_append(pjob, pregion, mntn_snap_lz4buf, clen);
+        }
+        else
+        {
+            block_size = cpu_to_le32(uchunk | MNTN_LZ4_BLOCK_UNCOMPRESSED);
+            iret = mntn_snap_append(pjob, pregion, &block_size, sizeof(block_size));
+            iret = iret ? iret : mntn_snap_append(pjob, pregion, mntn_snap_bounce, uchunk);
+        }
+#else
+        iret = mntn_snap_append(pjob, pregion, mntn_snap_bounce, uchunk);
+#endif
+    }
+
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    /*end mark of the frame*/
+    block_size = 0;
+    iret = iret ? iret : mntn_snap_append(pjob, pregion, &block_size, sizeof(block_size));
+#endif
+
+    if (pregion->fd >= 0)
+    {
+        iret += mntn_snap_close(pjob, pregion);
+        mntn_snap_free_region(pregion);
+        return iret;
+    }
+    if (0 != iret)
+    {
+        mntn_snap_free_region(pregion);
+        return iret;
+    }
+    mntn_snap_trim(pregion);
+    list_add_tail(&pregion->list, &pjob->regions);
+    return 0;
+}
+
+/*
+ * Snapshot a physical region for the async writer. Regions past the
+ * snapshot budget are streamed to their file from here. If neither works,
+ * fall back to writing the raw region right away.
+ */
+static int mntn_snap_phy_addr_log(struct mntn_save_job *pjob, unsigned int phyadd, unsigned int ulen, const char *pfilename)
+{
+    int iret = 0;
+    unsigned char    *pdatabuf = NULL;
+
+    pdatabuf = ioremap(phyadd, ulen);
+    if (NULL == pdatabuf)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to ioremap when saving %s data!\n", pfilename);
+        return -1;
+    }
+    iret = mntn_snap_virtual_region(pjob, pdatabuf, ulen, pfilename);
+    if (0 != iret)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to snapshot %s, save it raw\n", pfilename);
+        iret = mntn_save_job_prepare_dir(pjob);
+        iret += mntn_do_save_virtual_addr_log(pdatabuf, ulen, (const char *)pjob->slotdir, pfilename);
+    }
+    iounmap(pdatabuf);
+    return iret;
+}
+
+static int mntn_do_save_snap_log(struct mntn_snap_region *pregion, const char *ppath)
+{
+    int iret = 0;
+    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    long	fd = 0;
+    int    bytes = 0;
+    struct mntn_snap_arena *parena = NULL;
+    mm_segment_t old_fs = 0;
+
+    snprintf(fullpath_arr, MNTN_FULLPATH_STRING_LEN, "%s%s", ppath, pregion->filename);
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    fd = sys_open(fullpath_arr, O_CREAT | O_RDWR | O_TRUNC, MNTN_LOG_FILE_PRO_VALUE);
+    if (fd < 0)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to open %s!, fd %lx\n", pregion->filename, fd);
+        set_fs(old_fs);
+        return -1;
+    }
+
+    list_for_each_entry(parena, &pregion->arenas, list)
+    {
+        bytes = sys_write((unsigned int)fd, (const char *)parena->data, parena->used);
+        if (bytes != parena->used)
+        {
+            MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to write all the data into the file, %d/%u\n", bytes, parena->used);
+            iret = -1;
+            break;
+        }
+    }
+    if (0 == iret)
+    {
+        iret = sys_fsync((unsigned int)fd);
+    }
+    (void)sys_close((unsigned int)fd);
+    set_fs(old_fs);
+
+    iret += mntn_filesys_chown((const char *)fullpath_arr, MNTN_LOG_FILE_OWNER_UID, MNTN_LOG_FILE_OWNER_GID);
+    MNTN_FILESYS_PRINT(KERN_INFO"mntn: saved %s, %u -> %u bytes\n", pregion->filename, pregion->raw_len, pregion->file_len);
+    return iret;
+}
+
+static void mntn_save_job_work(struct work_struct *work)
+{
+    struct mntn_save_job *pjob = container_of(work, struct mntn_save_job, work);
+    struct mntn_snap_region *pregion = NULL;
+    struct mntn_snap_region *ptmp = NULL;
+    int iret = 0;
+    int i = 0;
+
+    if (!list_empty(&pjob->regions))
+    {
+        iret = mntn_save_job_prepare_dir(pjob);
+    }
+
+    list_for_each_entry_safe(pregion, ptmp, &pjob->regions, list)
+    {
+        if (0 == iret)
+        {
+            iret = mntn_do_save_snap_log(pregion, (const char *)pjob->slotdir);
+        }
+        list_del(&pregion->list);
+        mntn_snap_free_region(pregion);
+    }
+
+    /*Write reset reason into history.log*/
+    for (i = 0; i < MNTN_SAVE_JOB_HISTORY_MAX; i++)
+    {
+        if (NULL != pjob->phistory[i])
+        {
+            iret += mntn_upadte_history_info(pjob->phistory[i], (const char*)pjob->time_arr, pjob->reason);
+        }
+    }
+
+    MNTN_FILESYS_PRINT(KERN_ERR"mntn: %s log saved, iret = %d\n", pjob->pname, iret);
+    kfree(pjob);
+}
+
+static struct mntn_save_job *mntn_save_job_alloc(const char *plogdir, const char *pname,
+                                                 unsigned int uring_max, umode_t dir_mode, const char *preason)
+{
+    struct mntn_save_job *pjob = NULL;
+
+    pjob = kzalloc(sizeof(*pjob), GFP_KERNEL);
+    if (NULL == pjob)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to kmalloc save job\n");
+        return NULL;
+    }
+    INIT_LIST_HEAD(&pjob->regions);
+    INIT_WORK(&pjob->work, mntn_save_job_work);
+    pjob->plogdir = plogdir;
+    pjob->pname = pname;
+    pjob->uring_max = uring_max;
+    pjob->dir_mode = dir_mode;
+    strncpy(pjob->reason, preason, MNTN_FULLPATH_STRING_LEN);
+    mntn_get_cur_time_str(pjob->time_arr, MNTN_TIME_STRING_LEN);
+    return pjob;
+}
+
+/*hand the snapshot to the writer thread, or write it now if there is none*/
+static void mntn_save_job_submit(struct mntn_save_job *pjob, int bsync)
+{
+    if (bsync || (NULL == mntn_logsave_wq))
+    {
+        mntn_save_job_work(&pjob->work);
+        return;
+    }
+    queue_work(mntn_logsave_wq, &pjob->work);
+}
+
 
 int mntn_need_save_log(emntn_module etype)
 {
@@ -352,8 +977,7 @@ int mntn_need_save_log(emntn_module etype)
 int mntn_mdm_reset_save_log(const char *preason)
 {
     int iret = 0;
-    char    time_arr[MNTN_TIME_STRING_LEN+1] = {0};
-    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    struct mntn_save_job *pjob = NULL;
 
     if (NULL == preason)
     {
@@ -366,86 +990,74 @@ int mntn_mdm_reset_save_log(const char *preason)
         MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Needn't save log data!\n");
         return 0;
     }
-	
-    /*to remove old log data if there has been MAX_NUMBER logs.*/
-    mntn_rm_old_log(MNTN_CP_LOGDIR, MNTN_MDM_LOG_MAX);
-
-    /*Create dir named by time in cp_log/coredump*/
-    mntn_get_cur_time_str(time_arr, MNTN_TIME_STRING_LEN);
-    strncat(fullpath_arr, MNTN_CP_LOGDIR, strlen(MNTN_CP_LOGDIR));
-    strncat(fullpath_arr, time_arr, strlen(time_arr));
-    strncat(fullpath_arr, "/", strlen("/"));
-    iret = mntn_filesys_create_dir(fullpath_arr, MNTN_CP_DIR_PRO_VALUE);
-    if (0 != iret)
-    {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to create cp log dir!\n");
-	 goto oper_over;
-    }
-    /*change owner*/
-    iret += mntn_filesys_chown((const char *)fullpath_arr, MNTN_LOG_DIR_OWNER_UID, MNTN_LOG_DIR_OWNER_GID);
-    if (0 != iret)
+
+    pjob = mntn_save_job_alloc(MNTN_CP_LOGDIR, "cp", MNTN_MDM_LOG_MAX, MNTN_CP_DIR_PRO_VALUE, preason);
+    if (NULL == pjob)
     {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to chown cp log dir!\n");
+        return -1;
     }
-	
+    pjob->phistory[0] = MNTN_AP_LOGDIR;
+    pjob->phistory[1] = MNTN_CP_LOGDIR;
+
     /*modem reboot ... needn't save log, but update history.log*/
     if (0 != strstr(preason, "modem reboot"))
     {
-        /*Write reset reason into history.log*/
-        iret += mntn_upadte_history_info(MNTN_AP_LOGDIR, (const char*)time_arr, preason);
-        iret += mntn_upadte_history_info(MNTN_CP_LOGDIR, (const char*)time_arr, preason);
+        mntn_save_job_submit(pjob, 0);
         return 0;
     }
-	
+
+    /*
+     * Only snapshot the memory here, the files are written by the log
+     * save thread once the modem is running again.
+     */
+    mutex_lock(&mntn_snap_mutex);
+
     /*save sram data*/
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_ON, REG_SRAM_ON_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_ON_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_OFF, REG_SRAM_OFF_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_OFF_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_ON, REG_SRAM_ON_IOSIZE, MNTN_SRAME_ON_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_OFF, REG_SRAM_OFF_IOSIZE, MNTN_SRAME_OFF_FILE);
 
     if(get_domain_access_status(ACCESS_DOMAIN_MDM_SRAM) == 1)
     {
-        iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_MDM, REG_SRAM_MDM_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_MDM_FILE);
+        iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_MDM, REG_SRAM_MDM_IOSIZE, MNTN_SRAME_MDM_FILE);
 	 mntn_dump_sram_mdm_finish();
     }
     /*save mcu sram data*/
     mntn_dump_sram_mcu_prepare();
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_MCU, REG_SRAM_MCU_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_MCU_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_MCU, REG_SRAM_MCU_IOSIZE, MNTN_SRAME_MCU_FILE);
     mntn_dump_sram_mcu_finish();
 
     /*save bbe16 data*/
-    iret += mntn_do_save_phy_addr_log(GLOBAL_MEM_LCS_ADDR, GLOBAL_MEM_LCS_SIZE, (const char*)fullpath_arr, MNTN_BBE16_LCS_FILE);
-    iret += mntn_do_save_phy_addr_log(GLOBAL_MEM_TDS_TABLE_ADDR, GLOBAL_MEM_TDS_TABLE_SIZE, (const char*)fullpath_arr, MNTN_BBE16_TDSTABLE_FILE);
-    iret += mntn_do_save_phy_addr_log(GLOBAL_MEM_LT_IMAGE_ADDR, GLOBAL_MEM_LT_IMAGE_SIZE, (const char*)fullpath_arr, MNTN_BBE16_IMGDDR_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, GLOBAL_MEM_LCS_ADDR, GLOBAL_MEM_LCS_SIZE, MNTN_BBE16_LCS_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, GLOBAL_MEM_TDS_TABLE_ADDR, GLOBAL_MEM_TDS_TABLE_SIZE, MNTN_BBE16_TDSTABLE_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, GLOBAL_MEM_LT_IMAGE_ADDR, GLOBAL_MEM_LT_IMAGE_SIZE, MNTN_BBE16_IMGDDR_FILE);
     if(get_domain_access_status(ACCESS_DOMAIN_BBE16_DTCM) == 1)
     {
-        iret += mntn_do_save_phy_addr_log(REG_BASE_DTCM_BBE16, REG_DTCM_BBE16_IOSIZE, (const char*)fullpath_arr, MNTN_BBE16_DTCM_FILE);    
+        iret += mntn_snap_phy_addr_log(pjob, REG_BASE_DTCM_BBE16, REG_DTCM_BBE16_IOSIZE, MNTN_BBE16_DTCM_FILE);
     }
 
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SC_OFF, REG_SC_OFF_IOSIZE, (const char*)fullpath_arr, MNTN_SC_OFF_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SC_ON, REG_SC_ON_IOSIZE, (const char*)fullpath_arr, MNTN_SC_ON_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_PMCTRL, REG_PMCTRL_IOSIZE, (const char*)fullpath_arr, MNTN_PMCTRL_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SC_OFF, REG_SC_OFF_IOSIZE, MNTN_SC_OFF_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SC_ON, REG_SC_ON_IOSIZE, MNTN_SC_ON_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_PMCTRL, REG_PMCTRL_IOSIZE, MNTN_PMCTRL_FILE);
 
 
     /*save modem log data*/
-    iret += mntn_do_save_phy_addr_log(MODEM_DUMP_LOG_ADDR, MODEM_DUMP_LOG_SIZE, (const char*)fullpath_arr, MNTN_MODEM_LOG_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, MODEM_DUMP_LOG_ADDR, MODEM_DUMP_LOG_SIZE, MNTN_MODEM_LOG_FILE);
     /*save modem memory data*/
-    iret += mntn_do_save_phy_addr_log(MODEM_SYS_MEM_ADDR, MODEM_SYS_MEM_SAVE_SIZE, (const char*)fullpath_arr, MNTN_MODEM_MEMORY_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, MODEM_SYS_MEM_ADDR, MODEM_SYS_MEM_SAVE_SIZE, MNTN_MODEM_MEMORY_FILE);
 
-	
-    /*Write reset reason into history.log*/
-    iret += mntn_upadte_history_info(MNTN_AP_LOGDIR, (const char*)time_arr, preason);
-    iret += mntn_upadte_history_info(MNTN_CP_LOGDIR, (const char*)time_arr, preason);
+    mutex_unlock(&mntn_snap_mutex);
+
+    mntn_save_job_submit(pjob, 0);
 
     MNTN_FILESYS_PRINT(KERN_ERR"End of mntn_mdm_reset_save_log!iret = %d\n", iret);
 
-oper_over:
     return iret;
 }
 
 int mntn_hifi_reset_save_log(const char *preason)
 {
     int iret = 0;
-    char    time_arr[MNTN_TIME_STRING_LEN+1] = {0};
-    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    struct mntn_save_job *pjob = NULL;
 
     if (NULL == preason)
     {
@@ -458,45 +1070,31 @@ int mntn_hifi_reset_save_log(const char *preason)
         MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Needn't save log data!\n");
         return 0;
     }
-	
-    /*to remove old log data if there has been MAX_NUMBER logs.*/
-    mntn_rm_old_log(MNTN_HIFI_LOGDIR, MNTN_HIFI_LOG_MAX);
-
-    /*Create dir named by time in hifi_log/coredump*/
-    mntn_get_cur_time_str(time_arr, MNTN_TIME_STRING_LEN);
-    strncat(fullpath_arr, MNTN_HIFI_LOGDIR, strlen(MNTN_HIFI_LOGDIR));
-    strncat(fullpath_arr, time_arr, strlen(time_arr));
-    strncat(fullpath_arr, "/", strlen("/"));
-    iret = mntn_filesys_create_dir(fullpath_arr, MNTN_HIFI_DIR_PRO_VALUE);
-    if (0 != iret)
-    {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to create hifi log dir!\n");
-        goto oper_over;
-    }
-    /*change owner*/
-    iret += mntn_filesys_chown((const char *)fullpath_arr, MNTN_LOG_DIR_OWNER_UID, MNTN_LOG_DIR_OWNER_GID);
-    if (0 != iret)
+
+    pjob = mntn_save_job_alloc(MNTN_HIFI_LOGDIR, "hifi", MNTN_HIFI_LOG_MAX, MNTN_HIFI_DIR_PRO_VALUE, preason);
+    if (NULL == pjob)
     {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to chown hifi log dir!\n");
+        return -1;
     }
+    pjob->phistory[0] = MNTN_AP_LOGDIR;
+    pjob->phistory[1] = MNTN_HIFI_LOGDIR;
 
     /*save hifi memory data*/
-    iret += mntn_do_save_phy_addr_log(HIFI_SYS_MEM_ADDR, HIFI_SYS_MEM_SIZE, (const char*)fullpath_arr, MNTN_HIFI_MEMORY_FILE);
+    mutex_lock(&mntn_snap_mutex);
+    iret += mntn_snap_phy_addr_log(pjob, HIFI_SYS_MEM_ADDR, HIFI_SYS_MEM_SIZE, MNTN_HIFI_MEMORY_FILE);
 #ifdef CONFIG_DEBUG_FS
  //   iret += mntn_do_save_virtual_addr_log((unsigned char*)g_dump_addr, g_dump_size, (const char*)fullpath_arr, MNTN_HIFI_RH_FILE);
 #endif
-	
-    /*Write reset reason into history.log*/
-    iret += mntn_upadte_history_info(MNTN_AP_LOGDIR, (const char*)time_arr, preason);
-    iret += mntn_upadte_history_info(MNTN_HIFI_LOGDIR, (const char*)time_arr, preason);
-oper_over:
+    mutex_unlock(&mntn_snap_mutex);
+
+    mntn_save_job_submit(pjob, 0);
+
     return iret;
 }
 int mntn_mcu_reset_save_log(const char *preason)
 {
     int iret = 0;
-    char    time_arr[MNTN_TIME_STRING_LEN+1] = {0};
-    char    fullpath_arr[MNTN_FULLPATH_STRING_LEN + 1] = {0};
+    struct mntn_save_job *pjob = NULL;
 
     if (NULL == preason)
     {
@@ -509,65 +1107,68 @@ int mntn_mcu_reset_save_log(const char *preason)
         MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Needn't save log data!\n");
         return 0;
     }
-    /*to remove old log data if there has been MAX_NUMBER logs.*/
-    mntn_rm_old_log(MNTN_MCU_LOGDIR, MNTN_MDM_LOG_MAX);
-
-    /*Create dir named by time in ap_log/coredump*/
-    mntn_get_cur_time_str(time_arr, MNTN_TIME_STRING_LEN);
-    strncat(fullpath_arr, MNTN_MCU_LOGDIR, strlen(MNTN_MCU_LOGDIR));
-    strncat(fullpath_arr, time_arr, strlen(time_arr));
-    strncat(fullpath_arr, "/", strlen("/"));
 
     MNTN_FILESYS_PRINT(KERN_ERR"mntn_err:save mcu log step 0!\n");
-    iret = mntn_filesys_create_dir(fullpath_arr, MNTN_MCU_DIR_PRO_VALUE);
-    if (0 != iret)
-    {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to create cp log dir!\n");
-        goto oper_over;
-    }
-    /*change owner*/
-    iret += mntn_filesys_chown((const char *)fullpath_arr, MNTN_LOG_DIR_OWNER_UID, MNTN_LOG_DIR_OWNER_GID);
-    if (0 != iret)
+    pjob = mntn_save_job_alloc(MNTN_MCU_LOGDIR, "mcu", MNTN_MCU_LOG_MAX, MNTN_MCU_DIR_PRO_VALUE, preason);
+    if (NULL == pjob)
     {
-        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: Fail to chown mcu log dir!\n");
+        return -1;
     }
+    pjob->phistory[0] = MNTN_MCU_LOGDIR;
+
+    mutex_lock(&mntn_snap_mutex);
 
     /*save mcu memory data*/
-    iret += mntn_do_save_phy_addr_log(MCU_SYS_MEM_ADDR, MCU_SYS_MEM_SIZE, (const char*)fullpath_arr, MNTN_MCU_MEMORY_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, MCU_SYS_MEM_ADDR, MCU_SYS_MEM_SIZE, MNTN_MCU_MEMORY_FILE);
     /*save sram data*/
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_ON, REG_SRAM_ON_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_ON_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_OFF, REG_SRAM_OFF_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_OFF_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_ON, REG_SRAM_ON_IOSIZE, MNTN_SRAME_ON_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_OFF, REG_SRAM_OFF_IOSIZE, MNTN_SRAME_OFF_FILE);
     if(get_domain_access_status(ACCESS_DOMAIN_MDM_SRAM) == 1)
     {
-        iret += mntn_do_save_phy_addr_log(SOC_SRAM_OFF_BASE_ADDR, SRAM_SIZE, (const char*)fullpath_arr, MNTN_SRAME_MDM_FILE);
+        iret += mntn_snap_phy_addr_log(pjob, SOC_SRAM_OFF_BASE_ADDR, SRAM_SIZE, MNTN_SRAME_MDM_FILE);
 	 mntn_dump_sram_mdm_finish();
     }
     /*save mcu sram data*/
     mntn_dump_sram_mcu_prepare();
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SRAM_MCU, REG_SRAM_MCU_IOSIZE, (const char*)fullpath_arr, MNTN_SRAME_MCU_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SRAM_MCU, REG_SRAM_MCU_IOSIZE, MNTN_SRAME_MCU_FILE);
     mntn_dump_sram_mcu_finish();
 
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SC_OFF, REG_SC_OFF_IOSIZE, (const char*)fullpath_arr, MNTN_SC_OFF_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_SC_ON, REG_SC_ON_IOSIZE, (const char*)fullpath_arr, MNTN_SC_ON_FILE);
-    iret += mntn_do_save_phy_addr_log(REG_BASE_PMCTRL, REG_PMCTRL_IOSIZE, (const char*)fullpath_arr, MNTN_PMCTRL_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SC_OFF, REG_SC_OFF_IOSIZE, MNTN_SC_OFF_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_SC_ON, REG_SC_ON_IOSIZE, MNTN_SC_ON_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, REG_BASE_PMCTRL, REG_PMCTRL_IOSIZE, MNTN_PMCTRL_FILE);
 
     /*save mcu log data*/
-    iret += mntn_do_save_phy_addr_log(MCU_DUMP_LOG_ADDR, MCU_DUMP_LOG_SIZE, (const char*)fullpath_arr, MNTN_MCU_LOG_FILE);
+    iret += mntn_snap_phy_addr_log(pjob, MCU_DUMP_LOG_ADDR, MCU_DUMP_LOG_SIZE, MNTN_MCU_LOG_FILE);
 
-    /*Write reset reason into history.log*/
-    iret += mntn_upadte_history_info(MNTN_MCU_LOGDIR, (const char*)time_arr, preason);
+    mutex_unlock(&mntn_snap_mutex);
+
+    /*the whole system goes down after this, write the log before returning*/
+    mntn_save_job_submit(pjob, 1);
 
     /*reboot, have to msleep, or fail to update history.log*/
     msleep(1000);
   /*  machine_restart((char*)"reboot");*/
     MNTN_FILESYS_PRINT(KERN_ERR"mntn_err:save mcu log over!\n");
-oper_over:
     return iret;
 }
 
+static int __init mntn_save_logdata_init(void)
+{
+    mntn_logsave_wq = create_singlethread_workqueue("mntn_logsave");
+    if (NULL == mntn_logsave_wq)
+    {
+        MNTN_FILESYS_PRINT(KERN_ERR"mntn_err: fail to create log save workqueue\n");
+    }
+
+    mntn_snap_bounce = vmalloc(MNTN_SNAP_CHUNK_SIZE);
+#ifdef CONFIG_HISI_MNTN_LOG_LZ4
+    mntn_snap_lz4buf = vmalloc(lz4_compressbound(MNTN_SNAP_CHUNK_SIZE));
+    mntn_snap_wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+#endif
+    return 0;
+}
+module_init(mntn_save_logdata_init);
+
 EXPORT_SYMBOL(mntn_mdm_reset_save_log);
 EXPORT_SYMBOL(mntn_hifi_reset_save_log);
 EXPORT_SYMBOL(mntn_mcu_reset_save_log);
-
-
-
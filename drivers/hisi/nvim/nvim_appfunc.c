@@ -201,6 +201,14 @@ VOS_UINT32 NV_Init(VOS_VOID)
 
     NV_BuildGlobalVar();
 
+#if (VOS_LINUX == VOS_OS_VER)
+    /* ط쳣NV־øȼNVдػ */
+    if (NV_OK != NV_WbCacheInit())
+    {
+        vos_printf("\r\nNV_Init: NV write-back cache disabled\r\n");
+    }
+#endif
+
     vos_printf("\r\n---------------------NV_Init End-----------------------------\r\n");
 
     g_ulNVInitEndSlice = DRV_GET_SLICE();
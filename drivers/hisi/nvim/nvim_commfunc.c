@@ -13,6 +13,9 @@ extern "C" {
 #include <linux/proc_fs.h>
 #include <linux/kallsyms.h>
 #include <linux/semaphore.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/reboot.h>
 #include <asm/uaccess.h>
 #endif
 
@@ -39,6 +42,32 @@ VOS_CHAR                  g_acNvAcpuWriteSlicePath[] = "/yaffs0/A_NvWriteSlice.b
 VOS_CHAR                  g_acNvCcpuWriteSlicePath[] = "/yaffs0/C_NvWriteSlice.bin";
 #endif
 #endif
+
+/* NV ID ֱֵΪοϢ±10ʾδ */
+static VOS_UINT16         g_ausNvIdIndex[NV_ID_INDEX_SIZE];
+
+#if (VOS_LINUX == VOS_OS_VER)
+#if (FEATURE_ON == FEATURE_MULTI_FS_PARTITION)
+VOS_CHAR                  g_acNvAcpuJournalPath[] = "/mnvm2:0/A_NvJournal.bin";
+#else
+VOS_CHAR                  g_acNvAcpuJournalPath[] = "/yaffs0/A_NvJournal.bin";
+#endif
+
+/* ȼNVдػ棺־״̬ͳ */
+NV_WB_ENTRY_STRU          g_astNvWbEntry[NV_WB_CACHE_MAX_ENTRY];
+VOS_UINT32                g_ulNvWbEntryNum  = 0;
+VOS_UINT32                g_ulNvWbEnable    = VOS_FALSE;
+VOS_UINT32                g_ulNvJournalSize = 0;
+VOS_UINT32                g_ulNvJournalBad  = VOS_FALSE;
+NV_WB_STAT_STRU           g_stNvWbStat;
+
+VOS_VOID NV_WbFlushWorkFunc(struct work_struct *pstWork);
+
+/* ˢд᳤ʱȴIPCӲʹöĹУռsystem_wq */
+static struct workqueue_struct *g_pstNvWbFlushWq = VOS_NULL_PTR;
+static DECLARE_DELAYED_WORK(g_stNvWbFlushWork, NV_WbFlushWorkFunc);
+#endif
+
 VOS_VOID NV_RecordNvWriteSlice(VOS_UINT16 usNvId, VOS_UINT32 ulNvWriteSlice)
 {
     FILE                               *pFIle;
@@ -227,6 +256,40 @@ VOS_VOID NV_MemCpy( VOS_VOID * Dest, const VOS_VOID * Src,  VOS_UINT32 ulnbytes,
     return;
 }
 
+/*****************************************************************************
+Function   : NV_BuildIdIndex
+Description: Build the direct-indexed NV ID table from the reference list in
+             the share memory, so a lookup costs one table access instead of
+             a binary search with a copy per probe.
+Input      : none
+Return     : none
+Other      : Entries hold the reference index plus one, 0 means not indexed.
+*****************************************************************************/
+VOS_VOID NV_BuildIdIndex(VOS_VOID)
+{
+    NV_REFERENCE_DATA_INFO_STRU        *pstNvRef;
+    VOS_UINT32                          i;
+
+    VOS_MemSet(g_ausNvIdIndex, 0, sizeof(g_ausNvIdIndex));
+
+    /* ֵΪ16λΧʱֻʹöֲ */
+    if (g_pstNVDataBuf->ulNvRefCount >= NV_ID_INDEX_SIZE)
+    {
+        return;
+    }
+
+    pstNvRef = (NV_REFERENCE_DATA_INFO_STRU *)((VOS_CHAR *)g_pstNVDataBuf
+                + sizeof(NV_CONTROL_FILE_INFO_STRU)
+                + (sizeof(NV_FILE_LIST_INFO_STRU) * g_pstNVDataBuf->ulFileListNum));
+
+    for (i = 0; i < g_pstNVDataBuf->ulNvRefCount; i++)
+    {
+        g_ausNvIdIndex[pstNvRef[i].usNvId] = (VOS_UINT16)(i + 1);
+    }
+
+    return;
+}
+
 /*****************************************************************************
 Function   : NV_Ctrl_File_Search_InMemory
 Description: Find NV ID info. from the NV Control File
@@ -244,8 +307,10 @@ VOS_UINT32 NV_Ctrl_File_Search_InMemory(VOS_UINT16                  usID,
     VOS_UINT32 ulLow;
     VOS_UINT32 ulHigh;
     VOS_UINT32 ulMid;
+    VOS_UINT32 ulIndex;
     VOS_UINT32 ulOffset;
     VOS_CHAR   *pfileContent;
+    NV_REFERENCE_DATA_INFO_STRU *pstNvRef;
 
     if(VOS_NULL_PTR == pstNVCtrlInfo)
     {
@@ -258,45 +323,56 @@ VOS_UINT32 NV_Ctrl_File_Search_InMemory(VOS_UINT16                  usID,
 
     pfileContent = (VOS_CHAR *)pstNVCtrlInfo;
 
+    pstNvRef = (NV_REFERENCE_DATA_INFO_STRU *)(pfileContent + sizeof(NV_CONTROL_FILE_INFO_STRU)
+                + (sizeof(NV_FILE_LIST_INFO_STRU)*(pstNVCtrlInfo->ulFileListNum)));
+
     /* Get total ID Num */
-    ulHigh = pstNVCtrlInfo->ulNvRefCount;
-    ulLow  = 1;
+    ulHigh  = pstNVCtrlInfo->ulNvRefCount;
+    ulLow   = 1;
+    ulIndex = g_ausNvIdIndex[usID];
 
-    /* Binary Search */
-    while(ulLow <= ulHigh)
+    /* Direct index, checked against the reference entry in case the table is being rebuilt */
+    if ((g_pstNVDataBuf != pstNVCtrlInfo) || (ulIndex > ulHigh)
+        || ((0 != ulIndex) && (usID != pstNvRef[ulIndex - 1].usNvId)))
     {
-        ulMid = (ulLow + ulHigh)/2;
-
-        /* Seek the fp to the beginning of ulMid ID */
-        ulOffset = sizeof(NV_CONTROL_FILE_INFO_STRU) +
-                        (sizeof(NV_FILE_LIST_INFO_STRU)*(pstNVCtrlInfo->ulFileListNum))
-                        +(sizeof(NV_REFERENCE_DATA_INFO_STRU)*(ulMid-1));
+        ulIndex = 0;
+    }
 
-        /* Get the Id info of the ulMid ID */
-        NVIM_MemCpy(pstNvIdInfo, pfileContent + ulOffset, sizeof(NV_REFERENCE_DATA_INFO_STRU));
+    /* Binary Search, only the key of each probe is read from the share memory */
+    while((0 == ulIndex) && (ulLow <= ulHigh))
+    {
+        ulMid = (ulLow + ulHigh)/2;
 
-        if(usID < pstNvIdInfo->usNvId)
+        if(usID < pstNvRef[ulMid-1].usNvId)
         {
             ulHigh = ulMid - 1;
         }
-        else if(usID > pstNvIdInfo->usNvId)
+        else if(usID > pstNvRef[ulMid-1].usNvId)
         {
             ulLow = ulMid + 1;
         }
         else
         {
-            /* Get the file info of this ID */
-            ulOffset = sizeof(NV_CONTROL_FILE_INFO_STRU) +
-                                (sizeof(NV_FILE_LIST_INFO_STRU)* (pstNvIdInfo->usFileId-1));
-
-            NVIM_MemCpy(pstFileListInfo, pfileContent + ulOffset, sizeof(NV_FILE_LIST_INFO_STRU));
+            ulIndex = ulMid;
+        }
+    }
 
-            return VOS_OK;
-         }
+    if (0 == ulIndex)
+    {
+        /* ID not exist */
+        return VOS_ERR;
     }
 
-    /* ID not exist */
-    return VOS_ERR;
+    /* Get the Id info of the found ID */
+    NVIM_MemCpy(pstNvIdInfo, &pstNvRef[ulIndex-1], sizeof(NV_REFERENCE_DATA_INFO_STRU));
+
+    /* Get the file info of this ID */
+    ulOffset = sizeof(NV_CONTROL_FILE_INFO_STRU) +
+                        (sizeof(NV_FILE_LIST_INFO_STRU)* (pstNvIdInfo->usFileId-1));
+
+    NVIM_MemCpy(pstFileListInfo, pfileContent + ulOffset, sizeof(NV_FILE_LIST_INFO_STRU));
+
+    return VOS_OK;
 }
 
 /*****************************************************************************
@@ -479,6 +555,596 @@ VOS_UINT32 NV_WriteDataToFile(
     return NV_OK;
 }
 
+#if (VOS_LINUX == VOS_OS_VER)
+/*****************************************************************************
+Function   : NV_WbCheckSum
+Description: Check sum of a journal record, covering the header and the data.
+Input      : pstRecord - journal record header
+             pucData   - NV data of the record
+Return     : check sum
+Other      :
+*****************************************************************************/
+VOS_UINT32 NV_WbCheckSum(NV_JOURNAL_RECORD_STRU *pstRecord, VOS_UINT8 *pucData)
+{
+    VOS_UINT32                          ulSum;
+    VOS_UINT32                          i;
+
+    ulSum = pstRecord->ulMagicNum + pstRecord->usFileId + pstRecord->ulFileOffset
+            + pstRecord->ulTotalOffset + pstRecord->ulLength;
+
+    for (i = 0; i < pstRecord->ulLength; i++)
+    {
+        ulSum = ((ulSum << 1) | (ulSum >> 31)) + pucData[i];
+    }
+
+    return ulSum;
+}
+
+/*****************************************************************************
+Function   : NV_WbGetFilePath
+Description: Get the absolute path of a NV file by its file id.
+Input      : usFileId   - file id, starts from 1
+             pcFilePath - buffer of NV_ABSLT_PATH_LEN bytes
+Return     : Ok or Err.
+Other      :
+*****************************************************************************/
+VOS_UINT32 NV_WbGetFilePath(VOS_UINT16 usFileId, VOS_CHAR *pcFilePath)
+{
+    NV_FILE_LIST_INFO_STRU              stFileListInfo;
+
+    if ((0 == usFileId) || (usFileId > g_pstNVDataBuf->ulFileListNum))
+    {
+        return VOS_ERR;
+    }
+
+    NVIM_MemCpy(&stFileListInfo, (VOS_CHAR *)g_pstNVDataBuf + sizeof(NV_CONTROL_FILE_INFO_STRU)
+                + (sizeof(NV_FILE_LIST_INFO_STRU) * (usFileId - 1)), sizeof(NV_FILE_LIST_INFO_STRU));
+
+    stFileListInfo.aucFileName[NV_FILE_NAME_LEN - 1] = '\0';
+
+    NV_GetFileAbsltPath(g_aucNvFolderPath, (VOS_CHAR *)stFileListInfo.aucFileName, pcFilePath, NV_ABSLT_PATH_LEN);
+
+    return VOS_OK;
+}
+
+/*****************************************************************************
+Function   : NV_JournalTruncate
+Description: Empty the journal file once every record in it is on the flash.
+Input      : none
+Return     : Ok or Err.
+Other      :
+*****************************************************************************/
+VOS_UINT32 NV_JournalTruncate(VOS_VOID)
+{
+    FILE                               *fp;
+
+    fp = NV_File_Open(g_acNvAcpuJournalPath, NV_FILE_OPEN_MODE_W);
+
+    if (VOS_NULL_PTR == fp)
+    {
+        return VOS_ERR;
+    }
+
+    NV_File_Close(fp);
+
+    g_ulNvJournalSize = 0;
+    g_ulNvJournalBad  = VOS_FALSE;
+
+    return VOS_OK;
+}
+
+/*****************************************************************************
+Function   : NV_JournalAppend
+Description: Append one NV write to the journal file.
+Input      : usFileId      - file id of the NV
+             ulFileOffset  - offset in the NV file
+             ulTotalOffset - offset in the share memory
+             pItem         - NV data
+             ulLength      - NV data length
+Return     : Ok or Err.
+Other      : A failed append may leave a torn record, the caller has to flush
+             and empty the journal before appending again.
+*****************************************************************************/
+VOS_UINT32 NV_JournalAppend(VOS_UINT16 usFileId, VOS_UINT32 ulFileOffset,
+                            VOS_UINT32 ulTotalOffset, VOS_VOID *pItem, VOS_UINT32 ulLength)
+{
+    FILE                               *fp;
+    NV_JOURNAL_RECORD_STRU              stRecord;
+
+    stRecord.ulMagicNum    = NV_JOURNAL_MAGIC_NUM;
+    stRecord.usFileId      = usFileId;
+    stRecord.usRsv         = 0;
+    stRecord.ulFileOffset  = ulFileOffset;
+    stRecord.ulTotalOffset = ulTotalOffset;
+    stRecord.ulLength      = ulLength;
+    stRecord.ulCheckSum    = NV_WbCheckSum(&stRecord, (VOS_UINT8 *)pItem);
+
+    fp = NV_File_Open(g_acNvAcpuJournalPath, NV_FILE_OPEN_MODE_APEND);
+
+    if (VOS_NULL_PTR == fp)
+    {
+        return VOS_ERR;
+    }
+
+    if ((1 != NV_File_Write(&stRecord, sizeof(stRecord), 1, fp))
+        || (1 != NV_File_Write(pItem, ulLength, 1, fp)))
+    {
+        NV_File_Close(fp);
+
+        return VOS_ERR;
+    }
+
+    NV_File_Close(fp);
+
+    g_ulNvJournalSize += sizeof(stRecord) + ulLength;
+    g_stNvWbStat.ulJournalWrite++;
+
+    return VOS_OK;
+}
+
+/*****************************************************************************
+Function   : NV_WbCacheAdd
+Description: Add a dirty range to the write-back table, merging it with an
+             overlapping or adjacent range of the same file.
+Input      : usFileId      - file id of the NV
+             ulFileOffset  - offset in the NV file
+             ulTotalOffset - offset in the share memory
+             ulLength      - length of the range
+Return     : Ok or Err.
+Other      :
+*****************************************************************************/
+VOS_UINT32 NV_WbCacheAdd(VOS_UINT16 usFileId, VOS_UINT32 ulFileOffset,
+                         VOS_UINT32 ulTotalOffset, VOS_UINT32 ulLength)
+{
+    NV_WB_ENTRY_STRU                   *pstEntry;
+    VOS_UINT32                          ulEnd;
+    VOS_UINT32                          i;
+
+    for (i = 0; i < g_ulNvWbEntryNum; i++)
+    {
+        pstEntry = &g_astNvWbEntry[i];
+
+        if ((usFileId != pstEntry->usFileId)
+            || (ulFileOffset > (pstEntry->ulFileOffset + pstEntry->ulLength))
+            || (pstEntry->ulFileOffset > (ulFileOffset + ulLength)))
+        {
+            continue;
+        }
+
+        /* ͬһļļƫƺͻƫԶӦϲ */
+        ulEnd = pstEntry->ulFileOffset + pstEntry->ulLength;
+
+        if ((ulFileOffset + ulLength) > ulEnd)
+        {
+            ulEnd = ulFileOffset + ulLength;
+        }
+
+        if (ulFileOffset < pstEntry->ulFileOffset)
+        {
+            pstEntry->ulFileOffset  = ulFileOffset;
+            pstEntry->ulTotalOffset = ulTotalOffset;
+        }
+
+        pstEntry->ulLength = ulEnd - pstEntry->ulFileOffset;
+
+        g_stNvWbStat.ulCoalesced++;
+
+        return VOS_OK;
+    }
+
+    if (g_ulNvWbEntryNum >= NV_WB_CACHE_MAX_ENTRY)
+    {
+        return VOS_ERR;
+    }
+
+    pstEntry = &g_astNvWbEntry[g_ulNvWbEntryNum];
+
+    pstEntry->usFileId      = usFileId;
+    pstEntry->usRsv         = 0;
+    pstEntry->ulFileOffset  = ulFileOffset;
+    pstEntry->ulTotalOffset = ulTotalOffset;
+    pstEntry->ulLength      = ulLength;
+
+    g_ulNvWbEntryNum++;
+
+    return VOS_OK;
+}
+
+/*****************************************************************************
+Function   : NV_WbFlushLocked
+Description: Write every dirty range from the share memory to the NV files,
+             one open per file, then empty the journal.
+Input      : none
+Return     : Ok or Err.
+Other      : Caller holds g_ulNVWriteSem and IPC_SEM_NVIM.
+*****************************************************************************/
+VOS_UINT32 NV_WbFlushLocked(VOS_VOID)
+{
+    FILE                               *fp;
+    VOS_CHAR                            aucFilePath[NV_ABSLT_PATH_LEN] = {0};
+    VOS_UINT8                           aucVisited[NV_WB_CACHE_MAX_ENTRY] = {0};
+    NV_WB_ENTRY_STRU                   *pstEntry;
+    VOS_UINT32                          ulResult = NV_OK;
+    VOS_UINT32                          ulNum = 0;
+    VOS_UINT32                          i;
+    VOS_UINT32                          j;
+
+    for (i = 0; i < g_ulNvWbEntryNum; i++)
+    {
+        if (VOS_TRUE == aucVisited[i])
+        {
+            continue;
+        }
+
+        fp = VOS_NULL_PTR;
+
+        if (VOS_OK == NV_WbGetFilePath(g_astNvWbEntry[i].usFileId, aucFilePath))
+        {
+            fp = NV_File_Open(aucFilePath, NV_FILE_OPEN_MODE_RW);
+        }
+
+        for (j = i; j < g_ulNvWbEntryNum; j++)
+        {
+            pstEntry = &g_astNvWbEntry[j];
+
+            if (pstEntry->usFileId != g_astNvWbEntry[i].usFileId)
+            {
+                continue;
+            }
+
+            aucVisited[j] = VOS_TRUE;
+
+            /* дʧܵ䱣ڱУ´ˢд */
+            if ((VOS_NULL_PTR == fp)
+                || (NV_OK != NV_WriteDataToFile(fp, (VOS_CHAR *)g_pstNVDataBuf + pstEntry->ulTotalOffset,
+                                                pstEntry->ulLength, (VOS_INT32)pstEntry->ulFileOffset)))
+            {
+                ulResult = NV_WRITE_FLASH_FAIL;
+                continue;
+            }
+
+            pstEntry->ulLength = 0;
+
+            g_stNvWbStat.ulFlushWrite++;
+        }
+
+        if (VOS_NULL_PTR != fp)
+        {
+            NV_File_Close(fp);
+        }
+    }
+
+    /* ѹֻδдɹ */
+    for (i = 0; i < g_ulNvWbEntryNum; i++)
+    {
+        if (0 != g_astNvWbEntry[i].ulLength)
+        {
+            g_astNvWbEntry[ulNum++] = g_astNvWbEntry[i];
+        }
+    }
+
+    g_ulNvWbEntryNum = ulNum;
+
+    g_stNvWbStat.ulFlushCount++;
+
+    if (NV_OK != ulResult)
+    {
+        return ulResult;
+    }
+
+    if (VOS_OK != NV_JournalTruncate())
+    {
+        return NV_WRITE_FLASH_FAIL;
+    }
+
+    return NV_OK;
+}
+
+/*****************************************************************************
+Function   : NV_FlushWbCacheTimeout
+Description: Flush the NV write-back table to the flash.
+Input      : ulSemTime - wait for g_ulNVWriteSem in ms, 0 means forever
+             lIpcTime  - wait for IPC_SEM_NVIM in 10ms
+Return     : Ok or Err.
+Other      :
+*****************************************************************************/
+VOS_UINT32 NV_FlushWbCacheTimeout(VOS_UINT32 ulSemTime, VOS_INT32 lIpcTime)
+{
+    VOS_UINT32                          ulResult;
+
+    if (VOS_OK != VOS_SmP(g_ulNVWriteSem, ulSemTime))
+    {
+        return NV_SMP_ERR;
+    }
+
+    if (BSP_OK != DRV_IPC_SEMTAKE(IPC_SEM_NVIM, lIpcTime))
+    {
+        VOS_SmV(g_ulNVWriteSem);
+        return NV_SMP_ERR;
+    }
+
+    ulResult = NV_WbFlushLocked();
+
+    /* ˢдʧʱԺ */
+    if (0 != g_ulNvWbEntryNum)
+    {
+        queue_delayed_work(g_pstNvWbFlushWq, &g_stNvWbFlushWork, msecs_to_jiffies(NV_WB_FLUSH_DELAY_MS));
+    }
+
+    DRV_IPC_SEMGIVE(IPC_SEM_NVIM);
+
+    VOS_SmV(g_ulNVWriteSem);
+
+    return ulResult;
+}
+
+/*****************************************************************************
+Function   : NV_FlushWbCache
+Description: Flush the NV write-back table to the flash.
+Input      : none
+Return     : Ok or Err.
+Other      : Called by anyone who needs the NV files up to date.
+*****************************************************************************/
+VOS_UINT32 NV_FlushWbCache(VOS_VOID)
+{
+    return NV_FlushWbCacheTimeout(0, NV_IPC_TIME_FOREVER);
+}
+
+VOS_VOID NV_WbFlushWorkFunc(struct work_struct *pstWork)
+{
+    /* ʱȴòʱԺԣ־вᶪʧ */
+    if (NV_SMP_ERR == NV_FlushWbCacheTimeout(NV_WB_WORK_SEM_TIME, NV_WB_WORK_IPC_TIME))
+    {
+        queue_delayed_work(g_pstNvWbFlushWq, &g_stNvWbFlushWork, msecs_to_jiffies(NV_WB_FLUSH_DELAY_MS));
+    }
+}
+
+/*****************************************************************************
+Function   : NV_WbCacheWrite
+Description: Put a high priority NV write into the write-back cache instead of
+             writing the NV file in place: identical data is dropped, others
+             are appended to the journal and merged into the dirty table.
+Input      : pstNvIdReturnInfo - NV id info from NV_NvIdCheck
+             pItem             - NV data
+             ulLength          - NV data length
+Return     : VOS_OK if the write is taken by the cache, VOS_ERR if the caller
+             has to write the NV file directly.
+Other      : Caller holds g_ulNVWriteSem and IPC_SEM_NVIM, and updates the
+             share memory afterwards.
+*****************************************************************************/
+VOS_UINT32 NV_WbCacheWrite(NV_ID_RETUEN_INFO_STRU *pstNvIdReturnInfo,
+                           VOS_VOID *pItem, VOS_UINT32 ulLength)
+{
+    VOS_UINT32                          ulRecordLen;
+
+    if (VOS_TRUE != g_ulNvWbEnable)
+    {
+        return VOS_ERR;
+    }
+
+    g_stNvWbStat.ulWriteReq++;
+
+    /* 뻺ͬFlashǻ򼴽Ǹֵд */
+    if (0 == VOS_MemCmp((VOS_CHAR *)g_pstNVDataBuf + pstNvIdReturnInfo->ulTotalOffset, pItem, ulLength))
+    {
+        g_stNvWbStat.ulSkipSame++;
+        return VOS_OK;
+    }
+
+    ulRecordLen = sizeof(NV_JOURNAL_RECORD_STRU) + ulLength;
+
+    if (ulRecordLen > NV_JOURNAL_MAX_SIZE)
+    {
+        return VOS_ERR;
+    }
+
+    /* ־־вȱ¼ʱˢд־ */
+    if ((VOS_TRUE == g_ulNvJournalBad)
+        || (g_ulNvWbEntryNum >= NV_WB_CACHE_MAX_ENTRY)
+        || ((g_ulNvJournalSize + ulRecordLen) > NV_JOURNAL_MAX_SIZE))
+    {
+        if (NV_OK != NV_WbFlushLocked())
+        {
+            return VOS_ERR;
+        }
+    }
+
+    if (VOS_OK != NV_JournalAppend(pstNvIdReturnInfo->usFileId, pstNvIdReturnInfo->ulNvOffset,
+                                   pstNvIdReturnInfo->ulTotalOffset, pItem, ulLength))
+    {
+        g_ulNvJournalBad = VOS_TRUE;
+        return VOS_ERR;
+    }
+
+    (VOS_VOID)NV_WbCacheAdd(pstNvIdReturnInfo->usFileId, pstNvIdReturnInfo->ulNvOffset,
+                            pstNvIdReturnInfo->ulTotalOffset, ulLength);
+
+    queue_delayed_work(g_pstNvWbFlushWq, &g_stNvWbFlushWork, msecs_to_jiffies(NV_WB_FLUSH_DELAY_MS));
+
+    return VOS_OK;
+}
+
+/*****************************************************************************
+Function   : NV_JournalReplay
+Description: Apply the journal left by an unclean shutdown to the NV files and
+             the share memory, then empty it.
+Input      : none
+Return     : Ok or Err.
+Other      : Replay stops at the first torn or corrupt record. A record whose
+             range the C core already changed in the share memory is older
+             than that data and is dropped.
+*****************************************************************************/
+VOS_UINT32 NV_JournalReplay(VOS_VOID)
+{
+    FILE                               *fp;
+    FILE                               *fpNv;
+    VOS_CHAR                            aucFilePath[NV_ABSLT_PATH_LEN] = {0};
+    NV_JOURNAL_RECORD_STRU              stRecord;
+    VOS_UINT8                          *pucData;
+    VOS_UINT8                          *pucOld;
+    VOS_INT32                           lRemain;
+
+    fp = NV_File_Open(g_acNvAcpuJournalPath, NV_FILE_OPEN_MODE_R);
+
+    if (VOS_NULL_PTR == fp)
+    {
+        return NV_OK;
+    }
+
+    NV_File_Seek(fp, 0, NV_FILE_SEEK_END);
+
+    lRemain = NV_File_Tell(fp);
+
+    NV_File_Seek(fp, 0, NV_FILE_SEEK_SET);
+
+    while ((lRemain >= (VOS_INT32)sizeof(stRecord))
+        && (1 == NV_File_Read(&stRecord, sizeof(stRecord), 1, fp)))
+    {
+        lRemain -= sizeof(stRecord);
+
+        if ((NV_JOURNAL_MAGIC_NUM != stRecord.ulMagicNum)
+            || (0 == stRecord.ulLength)
+            || (stRecord.ulLength > (VOS_UINT32)lRemain)
+            || ((sizeof(stRecord) + stRecord.ulLength) > NV_JOURNAL_MAX_SIZE)
+            || ((stRecord.ulTotalOffset + stRecord.ulLength) > NV_BUFFER_SIZE)
+            || (VOS_OK != NV_WbGetFilePath(stRecord.usFileId, aucFilePath)))
+        {
+            break;
+        }
+
+        pucData = kmalloc(stRecord.ulLength * 2, GFP_KERNEL);
+
+        if (VOS_NULL_PTR == pucData)
+        {
+            break;
+        }
+
+        pucOld = pucData + stRecord.ulLength;
+
+        if ((1 != NV_File_Read(pucData, stRecord.ulLength, 1, fp))
+            || (stRecord.ulCheckSum != NV_WbCheckSum(&stRecord, pucData)))
+        {
+            kfree(pucData);
+            break;
+        }
+
+        lRemain -= stRecord.ulLength;
+
+        fpNv = NV_File_Open(aucFilePath, NV_FILE_OPEN_MODE_RW);
+
+        if (VOS_NULL_PTR == fpNv)
+        {
+            kfree(pucData);
+            continue;
+        }
+
+        /* CѸдʱеֵ־£ü¼
+           ļֵһʱŰ־дļͻ */
+        if ((VOS_OK == NV_File_Seek(fpNv, (VOS_INT32)stRecord.ulFileOffset, NV_FILE_SEEK_SET))
+            && (1 == NV_File_Read(pucOld, stRecord.ulLength, 1, fpNv))
+            && (0 == VOS_MemCmp((VOS_CHAR *)g_pstNVDataBuf + stRecord.ulTotalOffset, pucOld, stRecord.ulLength))
+            && (NV_OK == NV_WriteDataToFile(fpNv, pucData, stRecord.ulLength, (VOS_INT32)stRecord.ulFileOffset)))
+        {
+            NV_SetAreaAccessable(NV_AREA_WRITABLE);
+            NVIM_MemCpy((VOS_CHAR *)g_pstNVDataBuf + stRecord.ulTotalOffset, pucData, stRecord.ulLength);
+            NV_SetAreaAccessable(NV_AREA_NO_WRITABLE);
+
+            g_stNvWbStat.ulReplayCount++;
+        }
+
+        NV_File_Close(fpNv);
+
+        kfree(pucData);
+    }
+
+    NV_File_Close(fp);
+
+    if (VOS_OK != NV_JournalTruncate())
+    {
+        return NV_WRITE_FLASH_FAIL;
+    }
+
+    return NV_OK;
+}
+
+int NV_WbRebootNotify(struct notifier_block *pstNb, unsigned long ulEvent, void *pData)
+{
+    /* C˿ֹͣҳIPCʱȴػδˢд־ */
+    (VOS_VOID)NV_FlushWbCacheTimeout(NV_WB_REBOOT_SEM_TIME, NV_WB_REBOOT_IPC_TIME);
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block g_stNvWbRebootNb =
+{
+    .notifier_call = NV_WbRebootNotify,
+};
+
+int NV_WbStatProcRead(char *pcPage, char **ppcStart, off_t lOff,
+                      int lCount, int *plEof, void *pData)
+{
+    *plEof = 1;
+
+    return snprintf(pcPage, lCount,
+                    "write_req:     %lu\n"
+                    "skip_same:     %lu\n"
+                    "coalesced:     %lu\n"
+                    "journal_write: %lu\n"
+                    "flush_write:   %lu\n"
+                    "direct_write:  %lu\n"
+                    "flush_count:   %lu\n"
+                    "replay_count:  %lu\n"
+                    "dirty_entry:   %lu\n",
+                    g_stNvWbStat.ulWriteReq, g_stNvWbStat.ulSkipSame,
+                    g_stNvWbStat.ulCoalesced, g_stNvWbStat.ulJournalWrite,
+                    g_stNvWbStat.ulFlushWrite, g_stNvWbStat.ulDirectWrite,
+                    g_stNvWbStat.ulFlushCount, g_stNvWbStat.ulReplayCount,
+                    g_ulNvWbEntryNum);
+}
+
+/*****************************************************************************
+Function   : NV_WbCacheInit
+Description: Replay the journal and set up the NV write-back cache.
+Input      : none
+Return     : Ok or Err.
+Other      : Called by NV_Init once the C core NV is ready.
+*****************************************************************************/
+VOS_UINT32 NV_WbCacheInit(VOS_VOID)
+{
+    VOS_UINT32                          ulResult;
+
+    if (BSP_OK != DRV_IPC_SEMTAKE(IPC_SEM_NVIM, NV_IPC_TIME_FOREVER))
+    {
+        return NV_SMP_ERR;
+    }
+
+    ulResult = NV_JournalReplay();
+
+    DRV_IPC_SEMGIVE(IPC_SEM_NVIM);
+
+    /* ־ʱû棬д */
+    if (NV_OK != ulResult)
+    {
+        return ulResult;
+    }
+
+    g_pstNvWbFlushWq = create_singlethread_workqueue("nv_wb_flush");
+
+    if (VOS_NULL_PTR == g_pstNvWbFlushWq)
+    {
+        return NV_ALLOC_BUFFER_FAIL;
+    }
+
+    register_reboot_notifier(&g_stNvWbRebootNb);
+
+    create_proc_read_entry("nvim_wb_stat", S_IRUGO, VOS_NULL_PTR, NV_WbStatProcRead, VOS_NULL_PTR);
+
+    g_ulNvWbEnable = VOS_TRUE;
+
+    return NV_OK;
+}
+#endif
+
 /*****************************************************************************
 Function   : NV_ReadPart
 Description: Read Part of NV from the file without Auth.
@@ -643,7 +1309,8 @@ VOS_UINT32 NV_WritePartEx(MODEM_ID_ENUM_UINT16      enModemID,
         /* Use absolute path to operate */
         NV_GetFileAbsltPath(g_aucNvFolderPath,(VOS_CHAR*)(stNvIdReturnInfo.aucFileName),aucFilePath, NV_ABSLT_PATH_LEN);
 
-        ulTempOffset = stNvIdReturnInfo.ulNvOffset + ulOffset;
+        /* ulNvOffset Ѱ ulOffset */
+        ulTempOffset = stNvIdReturnInfo.ulNvOffset;
     }
     else
     {
@@ -654,6 +1321,16 @@ VOS_UINT32 NV_WritePartEx(MODEM_ID_ENUM_UINT16      enModemID,
         ulTempOffset = stNvIdReturnInfo.ulTotalOffset;
     }
 
+#if (VOS_LINUX == VOS_OS_VER)
+    /* ȼ дʱȼ־дػˢд */
+    if ((NV_PRIORITY_HIGH == usNVProperty)
+        && (BSP_MODULE_SUPPORT == DRV_GET_LOCAL_FLASH_SUPPORT())
+        && (VOS_OK == NV_WbCacheWrite(&stNvIdReturnInfo, pItem, ulLength)))
+    {
+        ulResult = NV_OK;
+    }
+    else
+#endif
     if (NV_PRIORITY_HIGH == usNVProperty)
     {
         /* ȼ д */
@@ -672,6 +1349,10 @@ VOS_UINT32 NV_WritePartEx(MODEM_ID_ENUM_UINT16      enModemID,
         ulResult = NV_WriteDataToFile(fp, pItem, ulLength, (VOS_INT32)ulTempOffset);
 
         NV_File_Close(fp);
+
+#if (VOS_LINUX == VOS_OS_VER)
+        g_stNvWbStat.ulDirectWrite++;
+#endif
     }
     else  if (NV_PRIORITY_LOW == usNVProperty)
     {
@@ -771,6 +1452,8 @@ VOS_VOID NV_BuildGlobalVar(VOS_VOID)
         ulOffset += pstFileListInfo[i-1].ulFileSize;
     }
 
+    NV_BuildIdIndex();
+
     return;
 }
 
@@ -240,7 +240,6 @@ VOS_INT32 NV_File_Tell(FILE *Fp)
     return lFileSize;
 }
 
-#if ((VOS_WIN32 == VOS_OS_VER)||(VOS_VXWORKS == VOS_OS_VER)||(VOS_RTOSCK == VOS_OS_VER))
 /*****************************************************************************
 Function   : NV_File_Read
 Description: Read data into an array
@@ -265,6 +264,7 @@ VOS_INT32 NV_File_Read(VOS_VOID *pBuf,VOS_UINT32 ulSize,VOS_UINT32 ulCount,FILE
     return lRslt;
 }
 
+#if ((VOS_WIN32 == VOS_OS_VER)||(VOS_VXWORKS == VOS_OS_VER)||(VOS_RTOSCK == VOS_OS_VER))
 /*****************************************************************************
 Function   : NV_File_Remove
 Description: remove a file
@@ -0,0 +1,371 @@
+/* Copyright (c) 2008-2011, Hisilicon Tech. Co., Ltd. All rights reserved.
+ *
+ *  om_logring.c  hisi modem OM log ring, shared memory mapped to the logging daemon
+ *
+ * The modem writes OM log records straight into a ring in core share
+ * memory (see linux/hisi_om_logring.h). This driver maps the ring
+ * read-only into the logging daemon, forwards the modem doorbell IPC to an
+ * eventfd and writes the consumer position back for the daemon, so no log
+ * byte is copied by the a core on the way to userspace.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+#include <linux/module.h>			/* For module specific items */
+#include <linux/types.h>			/* For standard types (like size_t) */
+#include <linux/errno.h>			/* For the -ENODEV/... values */
+#include <linux/kernel.h>			/* For printk/... */
+#include <linux/init.h>				/* For __init/__exit/... */
+#include <linux/fs.h>				/* For file operations */
+#include <linux/mm.h>				/* For remap_pfn_range */
+#include <linux/io.h>				/* For readl/writel */
+#include <linux/miscdevice.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/eventfd.h>
+#include <linux/uaccess.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/hisi_om_logring.h>
+#include <mach/hardware.h>
+#include <mach/util.h>
+#include <mach/reset.h>
+#include <mach/common/mem/bsp_mem.h>
+#include <DrvInterface.h>
+#include "MemoryLayout.h"
+
+#define OM_LOGRING_PHY_ADDR	(MEMORY_RAM_CORESHARE_OM_LOG_ADDR)
+#define OM_LOGRING_SIZE		(MEMORY_RAM_CORESHARE_OM_LOG_SIZE)
+
+static struct om_logring_ctrl __iomem *om_logring_ctrl;
+
+/*protects om_logring_evctx, taken from the doorbell irq*/
+static DEFINE_SPINLOCK(om_logring_lock);
+static struct eventfd_ctx *om_logring_evctx;
+
+/*serializes consumer updates*/
+static DEFINE_MUTEX(om_logring_mutex);
+
+static atomic_t om_logring_opened = ATOMIC_INIT(0);
+static atomic_t om_logring_doorbells = ATOMIC_INIT(0);
+static atomic_t om_logring_resets = ATOMIC_INIT(0);
+
+#define om_logring_rd(field)		readl(&om_logring_ctrl->field)
+#define om_logring_wr(val, field)	writel((val), &om_logring_ctrl->field)
+
+/*
+ * The region used to be the head of the ICC DDR pool. A modem built with
+ * the old MemoryLayout.h, or one that set the pool up before we booted,
+ * still hands out ICC buffers there, so never touch it in that case.
+ */
+static int om_logring_layout_ok(void)
+{
+	u32 size = 0;
+	u32 base = BSP_MEM_GetIccPoolBase(&size);
+
+	return base && (base >= OM_LOGRING_PHY_ADDR + OM_LOGRING_SIZE
+			|| base + size <= OM_LOGRING_PHY_ADDR);
+}
+
+/*the modem sets the control page up after every boot, magic goes last*/
+static int om_logring_ready(void)
+{
+	u32 size;
+
+	if (!om_logring_layout_ok())
+		return 0;
+
+	if (OM_LOGRING_MAGIC != om_logring_rd(magic)
+		|| OM_LOGRING_VERSION != om_logring_rd(version))
+		return 0;
+
+	size = om_logring_rd(data_size);
+	if (!size || (size & (size - 1))
+		|| size > OM_LOGRING_SIZE - OM_LOGRING_DATA_OFFSET)
+		return 0;
+
+	return 1;
+}
+
+static void om_logring_kick(void)
+{
+	unsigned long flags = 0;
+
+	spin_lock_irqsave(&om_logring_lock, flags);
+	if (om_logring_evctx)
+		eventfd_signal(om_logring_evctx, 1);
+	spin_unlock_irqrestore(&om_logring_lock, flags);
+}
+
+/*****************************************************************************
+ Description : doorbell from the modem, the ring reached the armed fill level
+*****************************************************************************/
+static void om_logring_doorbell_irq(unsigned int param)
+{
+	atomic_inc(&om_logring_doorbells);
+	om_logring_kick();
+}
+
+/*****************************************************************************
+ Description : modem reset callback. Wake the daemon before the reset so it
+               drains what is left, and after it so it sees the ring restart.
+*****************************************************************************/
+static int om_logring_ccore_reset_cb(DRV_RESET_CALLCBFUN_MOMENT eparam, int userdata)
+{
+	if (DRV_RESET_CALLCBFUN_RESET_AFTER == eparam)
+		atomic_inc(&om_logring_resets);
+
+	om_logring_kick();
+
+	return 0;
+}
+
+static int om_logring_set_eventfd(int fd)
+{
+	struct eventfd_ctx *ctx = NULL;
+	struct eventfd_ctx *old;
+	unsigned long flags = 0;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	spin_lock_irqsave(&om_logring_lock, flags);
+	old = om_logring_evctx;
+	om_logring_evctx = ctx;
+	spin_unlock_irqrestore(&om_logring_lock, flags);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+/*****************************************************************************
+ Description : give consumed space back to the modem and arm the doorbell
+*****************************************************************************/
+static int om_logring_consume(struct om_logring_consume *c)
+{
+	u32 head;
+	u32 tail;
+	int ret = 0;
+
+	mutex_lock(&om_logring_mutex);
+
+	if (!om_logring_ready()) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	head = om_logring_rd(head);
+	tail = om_logring_rd(tail);
+	if ((c->tail & (OM_LOGRING_REC_ALIGN - 1))
+		|| (u32)(c->tail - tail) > (u32)(head - tail)
+		|| c->wake_mark > om_logring_rd(data_size)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	om_logring_wr(c->tail, tail);
+
+	if (!c->wake_mark) {
+		om_logring_wr(0, wake_armed);
+		goto out;
+	}
+
+	om_logring_wr(c->wake_mark, wake_mark);
+	om_logring_wr(1, wake_armed);
+
+	/*
+	 * The modem may have published past the mark before it saw the
+	 * doorbell armed. Check again and ring it ourselves, a spare wakeup
+	 * only costs the daemon one empty pass.
+	 */
+	mb();
+	head = om_logring_rd(head);
+	if ((u32)(head - c->tail) >= c->wake_mark) {
+		om_logring_wr(0, wake_armed);
+		om_logring_kick();
+	}
+
+out:
+	mutex_unlock(&om_logring_mutex);
+	return ret;
+}
+
+static void om_logring_get_stat(struct om_logring_stat *st)
+{
+	memset(st, 0, sizeof(*st));
+
+	if (om_logring_ready()) {
+		st->head = om_logring_rd(head);
+		st->tail = om_logring_rd(tail);
+		st->seq = om_logring_rd(seq);
+		st->dropped = om_logring_rd(dropped);
+	}
+	st->doorbells = atomic_read(&om_logring_doorbells);
+	st->resets = atomic_read(&om_logring_resets);
+}
+
+/*one consumer only, the ring has a single tail*/
+static int om_logring_open(struct inode *inode, struct file *file)
+{
+	if (atomic_cmpxchg(&om_logring_opened, 0, 1))
+		return -EBUSY;
+
+	return nonseekable_open(inode, file);
+}
+
+static int om_logring_release(struct inode *inode, struct file *file)
+{
+	mutex_lock(&om_logring_mutex);
+	if (om_logring_ready())
+		om_logring_wr(0, wake_armed);
+	mutex_unlock(&om_logring_mutex);
+
+	om_logring_set_eventfd(-1);
+	atomic_set(&om_logring_opened, 0);
+
+	return 0;
+}
+
+static long om_logring_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	void __user *argp = (void __user *)arg;
+	struct om_logring_consume c;
+	struct om_logring_stat st;
+	int fd;
+
+	switch (cmd) {
+	case OM_LOGRING_IOC_SET_EVENTFD:
+		if (get_user(fd, (int __user *)argp))
+			return -EFAULT;
+		return om_logring_set_eventfd(fd);
+
+	case OM_LOGRING_IOC_CONSUME:
+		if (copy_from_user(&c, argp, sizeof(c)))
+			return -EFAULT;
+		return om_logring_consume(&c);
+
+	case OM_LOGRING_IOC_GET_STAT:
+		om_logring_get_stat(&st);
+		if (copy_to_user(argp, &st, sizeof(st)))
+			return -EFAULT;
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+/*****************************************************************************
+ Description : map the whole region, control page first, read-only. The
+               kernel maps share memory uncached too, so the daemon reads
+               what the modem wrote without any cache maintenance.
+*****************************************************************************/
+static int om_logring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (vma->vm_pgoff || size > OM_LOGRING_SIZE)
+		return -EINVAL;
+
+	/*until the modem owns the ring it may hold ICC buffers of other users*/
+	if (!om_logring_ready())
+		return -ENODEV;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start,
+			OM_LOGRING_PHY_ADDR >> PAGE_SHIFT, size, vma->vm_page_prot);
+}
+
+static const struct file_operations om_logring_fops = {
+	.owner = THIS_MODULE,
+	.open = om_logring_open,
+	.release = om_logring_release,
+	.unlocked_ioctl = om_logring_ioctl,
+	.mmap = om_logring_mmap,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice om_logring_miscdev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "om_logring",
+	.fops = &om_logring_fops,
+};
+
+/*om log ring debug info show*/
+static int om_logring_proc_show(struct seq_file *m, void *v)
+{
+	struct om_logring_stat st;
+
+	om_logring_get_stat(&st);
+
+	seq_printf(m, "om logring : %s\n", om_logring_ready() ? "ready" : "not ready");
+	seq_printf(m, "share memory layout : %s\n", om_logring_layout_ok() ? "ok" : "old modem layout");
+	seq_printf(m, "head %u tail %u used %u\n", st.head, st.tail, st.head - st.tail);
+	seq_printf(m, "seq %u dropped %u\n", st.seq, st.dropped);
+	seq_printf(m, "doorbells %u resets %u\n", st.doorbells, st.resets);
+
+	return 0;
+}
+
+static int om_logring_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, om_logring_proc_show, NULL);
+}
+
+static const struct file_operations om_logring_proc_fops = {
+	.open = om_logring_proc_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init om_logring_init(void)
+{
+	int ret;
+
+	om_logring_ctrl = (struct om_logring_ctrl __iomem *)IO_ADDRESS(OM_LOGRING_PHY_ADDR);
+
+	ret = misc_register(&om_logring_miscdev);
+	if (ret) {
+		printk(KERN_ERR "om_logring: failed to register misc device (%d)\n", ret);
+		return ret;
+	}
+
+	balong_create_debug_proc_entry("omlogring", S_IRUGO, &om_logring_proc_fops, NULL);
+
+	ret = BSP_IPC_IntConnect(IPC_ACPU_INT_SRC_CCPU_OM_LOG, om_logring_doorbell_irq, 0);
+	if (BSP_OK != ret) {
+		printk(KERN_ERR "om_logring: failed to connect IPC irq handle (%d)\n", IPC_ACPU_INT_SRC_CCPU_OM_LOG);
+	}
+	BSP_IPC_IntEnable(IPC_ACPU_INT_SRC_CCPU_OM_LOG);
+
+	ccorereset_regcbfunc("OMLOG", om_logring_ccore_reset_cb, 0, BSP_DRV_CBFUN_PRIOLEVEL);
+
+	return 0;
+}
+module_init(om_logring_init);
+
+MODULE_DESCRIPTION("Hisilicon OM Log Ring Driver");
+MODULE_LICENSE("GPL");
@@ -14,12 +14,16 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_MAX_BATCH_MS	100
+#define EVDEV_MAX_RING_EVENTS	4096U
 
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/hrtimer.h>
+#include <linux/vmalloc.h>
 #include <linux/input/mt.h>
 #include <linux/major.h>
 #include <linux/device.h>
@@ -31,7 +35,6 @@ struct evdev {
 	int open;
 	int minor;
 	struct input_handle handle;
-	wait_queue_head_t wait;
 	struct evdev_client __rcu *grab;
 	struct list_head client_list;
 	spinlock_t client_lock; /* protects client_list */
@@ -47,6 +50,7 @@ struct evdev_client {
 	unsigned int tail;
 	unsigned int packet_head; /* [future] position of the first element of next packet */
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
+	wait_queue_head_t wait;
 	struct wake_lock wake_lock;
 	bool use_wake_lock;
 	char name[28];
@@ -54,6 +58,20 @@ struct evdev_client {
 	struct evdev *evdev;
 	struct list_head node;
 	int clkid;
+	/* wakeup batching, see EVIOCSBATCH; under buffer_lock */
+	ktime_t batch;
+	ktime_t last_wake;
+	bool batch_pending;
+	struct hrtimer batch_timer;
+	/*
+	 * mapped ring, see evdev_mmap(). The header is writable by the
+	 * reader, so size and the published head are kept here as well.
+	 */
+	struct input_ring *ring;
+	unsigned int ring_size;
+	unsigned int ring_head;
+	unsigned int ring_published;
+	bool ring_dropping;
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
@@ -61,6 +79,94 @@ struct evdev_client {
 static struct evdev *evdev_table[EVDEV_MINORS];
 static DEFINE_MUTEX(evdev_table_mutex);
 
+static inline struct input_event *evdev_ring_events(struct input_ring *ring)
+{
+	return (struct input_event *)((char *)ring + PAGE_SIZE);
+}
+
+/*
+ * Wake the reader on the first packet after a quiet period, then at most
+ * once per batch interval while packets keep coming.
+ * Called with buffer_lock held.
+ */
+static void evdev_wakeup_client(struct evdev_client *client)
+{
+	ktime_t now;
+
+	if (!client->batch.tv64) {
+		wake_up_interruptible(&client->wait);
+		return;
+	}
+
+	if (client->batch_pending)
+		return;
+
+	now = ktime_get();
+	if (ktime_us_delta(now, client->last_wake) >=
+			ktime_to_us(client->batch)) {
+		client->last_wake = now;
+		wake_up_interruptible(&client->wait);
+	} else {
+		client->batch_pending = true;
+		hrtimer_start(&client->batch_timer,
+			      ktime_add(client->last_wake, client->batch),
+			      HRTIMER_MODE_ABS);
+	}
+}
+
+static enum hrtimer_restart evdev_batch_timer(struct hrtimer *timer)
+{
+	struct evdev_client *client =
+		container_of(timer, struct evdev_client, batch_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&client->buffer_lock, flags);
+	client->batch_pending = false;
+	client->last_wake = ktime_get();
+	wake_up_interruptible(&client->wait);
+	spin_unlock_irqrestore(&client->buffer_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * The reader owns the tail of a mapped ring, so a full ring drops the
+ * packet being written instead of the oldest events. A partial packet is
+ * never published.
+ */
+static void evdev_ring_pass_event(struct evdev_client *client,
+				  struct input_event *event)
+{
+	struct input_ring *ring = client->ring;
+	unsigned int tail = ACCESS_ONCE(ring->tail);
+
+	if (!client->ring_dropping) {
+		if (client->ring_head - tail >= client->ring_size) {
+			client->ring_head = client->ring_published;
+			client->ring_dropping = true;
+			ring->dropped++;
+		} else {
+			evdev_ring_events(ring)[client->ring_head++ &
+						(client->ring_size - 1)] = *event;
+		}
+	}
+
+	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		if (!client->ring_dropping) {
+			/* events must be visible before the new head */
+			smp_wmb();
+			client->ring_published = client->ring_head;
+			ring->head = client->ring_head;
+		}
+		client->ring_dropping = false;
+
+		if (client->use_wake_lock)
+			wake_lock(&client->wake_lock);
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		evdev_wakeup_client(client);
+	}
+}
+
 static void evdev_pass_event(struct evdev_client *client,
 			     struct input_event *event,
 			     ktime_t mono, ktime_t real)
@@ -71,6 +177,12 @@ static void evdev_pass_event(struct evdev_client *client,
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
+	if (client->ring) {
+		evdev_ring_pass_event(client, event);
+		spin_unlock(&client->buffer_lock);
+		return;
+	}
+
 	client->buffer[client->head++] = *event;
 	client->head &= client->bufsize - 1;
 
@@ -96,6 +208,7 @@ static void evdev_pass_event(struct evdev_client *client,
 		if (client->use_wake_lock)
 			wake_lock(&client->wake_lock);
 		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		evdev_wakeup_client(client);
 	}
 
 	spin_unlock(&client->buffer_lock);
@@ -146,7 +259,6 @@ static void evdev_event(struct input_handle *handle,
 	if (type == EV_SYN && code == SYN_REPORT) {
 		evdev->hw_ts_sec = -1;
 		evdev->hw_ts_nsec = -1;
-		wake_up_interruptible(&evdev->wait);
 	}
 }
 
@@ -272,11 +384,11 @@ static void evdev_hangup(struct evdev *evdev)
 	struct evdev_client *client;
 
 	spin_lock(&evdev->client_lock);
-	list_for_each_entry(client, &evdev->client_list, node)
+	list_for_each_entry(client, &evdev->client_list, node) {
 		kill_fasync(&client->fasync, SIGIO, POLL_HUP);
+		wake_up_interruptible(&client->wait);
+	}
 	spin_unlock(&evdev->client_lock);
-
-	wake_up_interruptible(&evdev->wait);
 }
 
 static int evdev_release(struct inode *inode, struct file *file)
@@ -290,8 +402,10 @@ static int evdev_release(struct inode *inode, struct file *file)
 	mutex_unlock(&evdev->mutex);
 
 	evdev_detach_client(evdev, client);
+	hrtimer_cancel(&client->batch_timer);
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
+	vfree(client->ring);
 	kfree(client);
 
 	evdev_close_device(evdev);
@@ -343,6 +457,9 @@ static int evdev_open(struct inode *inode, struct file *file)
 
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	init_waitqueue_head(&client->wait);
+	hrtimer_init(&client->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	client->batch_timer.function = evdev_batch_timer;
 	snprintf(client->name, sizeof(client->name), "%s-%d",
 			dev_name(&evdev->dev), task_tgid_vnr(current));
 	client->evdev = evdev;
@@ -433,8 +550,12 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count < input_event_size())
 		return -EINVAL;
 
+	/* a mapped client reads its events from the ring */
+	if (client->ring)
+		return -EBUSY;
+
 	if (!(file->f_flags & O_NONBLOCK)) {
-		retval = wait_event_interruptible(evdev->wait,
+		retval = wait_event_interruptible(client->wait,
 			 client->packet_head != client->tail || !evdev->exist);
 		if (retval)
 			return retval;
@@ -464,15 +585,95 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	struct evdev *evdev = client->evdev;
 	unsigned int mask;
 
-	poll_wait(file, &evdev->wait, wait);
+	poll_wait(file, &client->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (client->ring) {
+		/*
+		 * The reader moves the tail behind our back, polling on an
+		 * empty ring is the point where it has caught up.
+		 */
+		spin_lock_irq(&client->buffer_lock);
+		if (client->ring_published != ACCESS_ONCE(client->ring->tail))
+			mask |= POLLIN | POLLRDNORM;
+		else if (client->use_wake_lock)
+			wake_unlock(&client->wake_lock);
+		spin_unlock_irq(&client->buffer_lock);
+	} else if (client->packet_head != client->tail)
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
 }
 
+/*
+ * Map a ring of events for this client: one header page (struct
+ * input_ring) followed by a power of two number of events. From then on
+ * events go to the ring only and the reader consumes them without a
+ * copy, read() returns -EBUSY.
+ */
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long n_events;
+	struct input_ring *ring;
+	int retval;
+
+	/* the ring is laid out with the native struct input_event */
+	if (input_event_size() != sizeof(struct input_event))
+		return -EINVAL;
+
+	if (vma->vm_pgoff || size <= PAGE_SIZE)
+		return -EINVAL;
+
+	n_events = (size - PAGE_SIZE) / sizeof(struct input_event);
+	if (!is_power_of_2(n_events) || n_events > EVDEV_MAX_RING_EVENTS ||
+	    n_events * sizeof(struct input_event) != size - PAGE_SIZE)
+		return -EINVAL;
+
+	/*
+	 * mmap_sem is held here and ioctls fault user memory under
+	 * evdev->mutex, so do not take the mutex; buffer_lock decides
+	 * which mapping wins.
+	 */
+	if (!evdev->exist)
+		return -ENODEV;
+
+	ring = vmalloc_user(size);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->size = n_events;
+
+	/* whatever is still queued for read() is dropped */
+	spin_lock_irq(&client->buffer_lock);
+	if (client->ring) {
+		spin_unlock_irq(&client->buffer_lock);
+		vfree(ring);
+		return -EBUSY;
+	}
+	client->tail = client->packet_head = client->head;
+	client->ring_size = n_events;
+	client->ring_head = 0;
+	client->ring_published = 0;
+	client->ring_dropping = false;
+	client->ring = ring;
+	if (client->use_wake_lock)
+		wake_unlock(&client->wake_lock);
+	spin_unlock_irq(&client->buffer_lock);
+
+	retval = remap_vmalloc_range(vma, ring, 0);
+	if (retval) {
+		spin_lock_irq(&client->buffer_lock);
+		client->ring = NULL;
+		spin_unlock_irq(&client->buffer_lock);
+		vfree(ring);
+	}
+
+	return retval;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -700,6 +901,27 @@ static int evdev_enable_suspend_block(struct evdev *evdev,
 	return 0;
 }
 
+static int evdev_set_batch(struct evdev_client *client, unsigned int ms)
+{
+	if (ms > EVDEV_MAX_BATCH_MS)
+		return -EINVAL;
+
+	spin_lock_irq(&client->buffer_lock);
+	client->batch = ktime_set(0, ms * NSEC_PER_MSEC);
+	spin_unlock_irq(&client->buffer_lock);
+
+	if (!ms) {
+		/* do not leave a batched packet waiting for the timer */
+		hrtimer_cancel(&client->batch_timer);
+		spin_lock_irq(&client->buffer_lock);
+		client->batch_pending = false;
+		wake_up_interruptible(&client->wait);
+		spin_unlock_irq(&client->buffer_lock);
+	}
+
+	return 0;
+}
+
 static int evdev_disable_suspend_block(struct evdev *evdev,
 				       struct evdev_client *client)
 {
@@ -784,6 +1006,11 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 		client->clkid = i;
 		return 0;
 
+	case EVIOCSBATCH:
+		if (copy_from_user(&i, p, sizeof(unsigned int)))
+			return -EFAULT;
+		return evdev_set_batch(client, i);
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -956,6 +1183,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
@@ -1041,7 +1269,6 @@ static int evdev_connect(struct input_handler *handler, struct input_dev *dev,
 	INIT_LIST_HEAD(&evdev->client_list);
 	spin_lock_init(&evdev->client_lock);
 	mutex_init(&evdev->mutex);
-	init_waitqueue_head(&evdev->wait);
 
 	dev_set_name(&evdev->dev, "event%d", minor);
 	evdev->exist = true;
@@ -368,6 +368,17 @@ static int synaptics_rmi4_work_func(struct work_struct *work)
 		return 0;
 	}
 
+	/*
+	 * Stamp the packet with the hard irq time rather than the time the
+	 * i2c read finished, evdev uses it for every event up to the sync.
+	 */
+	if (ts->use_irq) {
+		struct timespec irq_ts = ktime_to_timespec(ts->irq_time);
+
+		input_event(ts->input_dev, EV_SYN, SYN_TIME_SEC, irq_ts.tv_sec);
+		input_event(ts->input_dev, EV_SYN, SYN_TIME_NSEC, irq_ts.tv_nsec);
+	}
+
 	interrupt = &ts->data[ts->f01.data_offset + 1];
 
 	if (ts->hasF11 && (interrupt[ts->f11.interrupt_offset] & ts->f11.interrupt_mask)) {
@@ -520,6 +531,7 @@ static enum hrtimer_restart synaptics_rmi4_timer_func(struct hrtimer *timer)
 irqreturn_t synaptics_rmi4_irq_handler(int irq, void *dev_id)
 {
 	struct synaptics_rmi4 *ts = (struct synaptics_rmi4 *)dev_id;
+	ts->irq_time = ktime_get();
 	disable_irq_nosync(ts->client->irq);
 	queue_work(ts->synaptics_wq, &ts->work);
 	return IRQ_HANDLED;
@@ -543,6 +543,29 @@ BSP_S32 BSP_MEM_SetMostUsedSize(BSP_U32 u32Size, BSP_U32 u32PoolType)
     return OK;
 }
 
+/*****************************************************************************
+*     : BSP_MEM_GetIccPoolBase
+*
+*   : ȡICC DDRڴصַСڴĺ˳ʼ,
+*             ˿ɾݴж϶ԶʹõĹڴ沼
+*
+*   : 
+*   : pu32Size: ڴشС(byte),ΪNULL
+*   ֵ  : ڴַ,δʼʱΪ0
+*****************************************************************************/
+BSP_U32 BSP_MEM_GetIccPoolBase(BSP_U32 *pu32Size)
+{
+    MEM_ALLOC_INFO* pAllocInfo = MEM_GET_ALLOC_INFO(MEM_ICC_DDR_POOL);
+
+    if (NULL != pu32Size)
+    {
+        *pu32Size = pAllocInfo->memPoolInfo.u32Size;
+    }
+
+    return pAllocInfo->memPoolInfo.u32BaseAddr;
+}
+EXPORT_SYMBOL(BSP_MEM_GetIccPoolBase);
+
 /*****************************************************************************
 *     : BSP_Malloc
 *
@@ -13,6 +13,12 @@
  * drops below 4096 pages and kill processes with a oom_score_adj value of 0 or
  * higher when the free memory drops below 1024 pages.
  *
+ * Processes whose oom_score_adj falls between the same two adj values are
+ * killed at the same memory level.  Within that band, one whose memory
+ * cgroup is further above its soft limit is killed first; after that the
+ * highest oom_score_adj and then the largest process, as without memory
+ * cgroups.
+ *
  * The driver considers memory used for caches to be free, but if a large
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
@@ -42,6 +48,7 @@
 #include <linux/rcupdate.h>
 #include <linux/hw_kstate.h>
 #include <linux/swap.h>
+#include <linux/memcontrol.h>
 #ifdef CONFIG_HIGHMEM
 #define _ZONE ZONE_HIGHMEM
 #else
@@ -74,6 +81,21 @@ static unsigned long lowmem_deathpending_timeout;
 			pr_info(x);			\
 	} while (0)
 
+/*
+ * Index of the highest lowmem_adj[] value at or below @oom_score_adj.
+ * Exact oom_score_adj ties are rare, so the memory cgroup soft limit
+ * excess is compared between processes of the same band instead.
+ */
+static int lowmem_adj_band(short oom_score_adj, int array_size)
+{
+	int i;
+
+	for (i = array_size - 1; i > 0; i--)
+		if (oom_score_adj >= lowmem_adj[i])
+			break;
+	return i;
+}
+
 static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
 	struct task_struct *tsk;
@@ -84,6 +106,8 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
 	int minfree = 0;
 	int selected_tasksize = 0;
+	unsigned long selected_excess = 0;
+	int selected_band = 0;
 	short selected_oom_score_adj;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free = global_page_state(NR_FREE_PAGES) - totalreserve_pages;
@@ -120,6 +144,8 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	for_each_process(tsk) {
 		struct task_struct *p;
 		short oom_score_adj;
+		unsigned long excess;
+		int band;
 
 		if (tsk->flags & PF_KTHREAD)
 			continue;
@@ -140,21 +166,35 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 			continue;
 		}
 		tasksize = get_mm_rss(p->mm);
+		excess = mem_cgroup_mm_soft_limit_excess(p->mm);
 		task_unlock(p);
 		if (tasksize <= 0)
 			continue;
+		band = lowmem_adj_band(oom_score_adj, array_size);
 		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
+			if (band < selected_band)
 				continue;
+			if (band == selected_band) {
+				if (excess < selected_excess)
+					continue;
+				if (excess == selected_excess) {
+					if (oom_score_adj <
+					    selected_oom_score_adj)
+						continue;
+					if (oom_score_adj ==
+					    selected_oom_score_adj &&
+					    tasksize <= selected_tasksize)
+						continue;
+				}
+			}
 		}
 		selected = p;
 		selected_tasksize = tasksize;
+		selected_excess = excess;
+		selected_band = band;
 		selected_oom_score_adj = oom_score_adj;
-		lowmem_print(2, "select '%s' (%d), adj %hd, size %d, to kill\n",
-			     p->comm, p->pid, oom_score_adj, tasksize);
+		lowmem_print(2, "select '%s' (%d), adj %hd, size %d, memcg excess %lu, to kill\n",
+			     p->comm, p->pid, oom_score_adj, tasksize, excess);
 	}
 	if (selected) {
 		task_lock(selected);
@@ -279,6 +279,23 @@
  <td> Read</td>
  </tr>
 
+ <tr>
+ <td> hcd_ep_stats </td>
+ <td> Shows, for every endpoint in the host schedules, the number of host
+ channel interrupts, the number of retired transfers and the channel
+ interrupt rate. Useful to check that Descriptor DMA is batching periodic
+ transfers.</td>
+ <td> Read</td>
+ </tr>
+
+ <tr>
+ <td> pcd_ep_stats </td>
+ <td> Shows, for every enabled device endpoint, the completed requests and
+ bytes, the Transfer Complete interrupts, the number of request chains and
+ the average throughput since the endpoint was enabled.</td>
+ <td> Read</td>
+ </tr>
+
  <tr>
  <td> rd_reg_test </td>
  <td> Displays the time required to read the GNPTXFSIZ register many times
@@ -954,6 +971,28 @@ static ssize_t disconnect_us(struct device *_dev,
 
 DEVICE_ATTR(disconnect_us, S_IWUSR, 0, disconnect_us);
 
+/**
+ * Show per-endpoint throughput counters of the PCD.
+ */
+static ssize_t pcd_ep_stats_show(struct device *_dev,
+				 struct device_attribute *attr, char *buf)
+{
+#ifndef DWC_HOST_ONLY
+#ifdef LM_INTERFACE
+	struct lm_device *lm_dev = container_of(_dev, struct lm_device, dev);
+	dwc_otg_device_t *otg_dev = lm_get_drvdata(lm_dev);
+#elif defined(PCI_INTERFACE)
+	dwc_otg_device_t *otg_dev = dev_get_drvdata(_dev);
+#endif
+
+	if (otg_dev->pcd)
+		return dwc_otg_pcd_dump_ep_stats(otg_dev->pcd, buf, PAGE_SIZE);
+#endif /* DWC_HOST_ONLY */
+	return sprintf(buf, "No PCD\n");
+}
+
+DEVICE_ATTR(pcd_ep_stats, S_IRUGO, pcd_ep_stats_show, 0);
+
 static ssize_t connect_us(struct device *_dev,
 			     struct device_attribute *attr,
 			     const char *buf, size_t count)
@@ -1067,6 +1106,28 @@ static ssize_t hcd_frrem_show(struct device *_dev,
 
 DEVICE_ATTR(hcd_frrem, S_IRUGO | S_IWUSR, hcd_frrem_show, 0);
 
+/**
+ * Show per-endpoint channel interrupt and transfer counts.
+ */
+static ssize_t hcd_ep_stats_show(struct device *_dev,
+				 struct device_attribute *attr, char *buf)
+{
+#ifndef DWC_DEVICE_ONLY
+#ifdef LM_INTERFACE
+	struct lm_device *lm_dev = container_of(_dev, struct lm_device, dev);
+	dwc_otg_device_t *otg_dev = lm_get_drvdata(lm_dev);
+#elif defined(PCI_INTERFACE)
+	dwc_otg_device_t *otg_dev = dev_get_drvdata(_dev);
+#endif
+
+	if (otg_dev->hcd)
+		return dwc_otg_hcd_dump_ep_stats(otg_dev->hcd, buf, PAGE_SIZE);
+#endif /* DWC_DEVICE_ONLY */
+	return sprintf(buf, "No HCD\n");
+}
+
+DEVICE_ATTR(hcd_ep_stats, S_IRUGO, hcd_ep_stats_show, 0);
+
 /**
  * Displays the time required to read the GNPTXFSIZ register many times (the
  * output shows the number of times the register is read).
@@ -1290,6 +1351,8 @@ void dwc_otg_attr_create(
 	error = device_create_file(&dev->dev, &dev_attr_spramdump);
 	error = device_create_file(&dev->dev, &dev_attr_hcddump);
 	error = device_create_file(&dev->dev, &dev_attr_hcd_frrem);
+	error = device_create_file(&dev->dev, &dev_attr_hcd_ep_stats);
+	error = device_create_file(&dev->dev, &dev_attr_pcd_ep_stats);
 	error = device_create_file(&dev->dev, &dev_attr_rd_reg_test);
 	error = device_create_file(&dev->dev, &dev_attr_wr_reg_test);
 #ifdef CONFIG_USB_DWC_OTG_LPM
@@ -1343,6 +1406,8 @@ void dwc_otg_attr_remove(
 	device_remove_file(&dev->dev, &dev_attr_spramdump);
 	device_remove_file(&dev->dev, &dev_attr_hcddump);
 	device_remove_file(&dev->dev, &dev_attr_hcd_frrem);
+	device_remove_file(&dev->dev, &dev_attr_hcd_ep_stats);
+	device_remove_file(&dev->dev, &dev_attr_pcd_ep_stats);
 	device_remove_file(&dev->dev, &dev_attr_rd_reg_test);
 	device_remove_file(&dev->dev, &dev_attr_wr_reg_test);
 #ifdef CONFIG_USB_DWC_OTG_LPM
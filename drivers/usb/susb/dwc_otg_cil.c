@@ -2284,7 +2284,7 @@ void dwc_otg_core_host_init(dwc_otg_core_if_t * core_if)
 		DWC_WRITE_REG32(&host_if->host_global_regs->hfir, hfir.d32);
 	}
 
-	if (core_if->core_params->dma_desc_enable) {
+	if (core_if->dma_desc_enable) {
 		uint8_t op_mode = core_if->hwcfg2.b.op_mode;
 		if (!
 		    (core_if->hwcfg4.b.desc_dma
@@ -2296,16 +2296,25 @@ void dwc_otg_core_host_init(dwc_otg_core_if_t * core_if)
 			 || (op_mode == DWC_HWCFG2_OP_MODE_SRP_CAPABLE_HOST)
 			 || (op_mode ==
 			     DWC_HWCFG2_OP_MODE_NO_SRP_CAPABLE_HOST)))) {
-			DWC_ERROR("Host can't operate in Descriptor DMA mode.\n"
-				  "Either core version is below 2.90a or "
-				  "GHWCFG2, GHWCFG4 registers' values do not allow Descriptor DMA in host mode.\n"
-				  "To run the driver in Buffer DMA host mode set dma_desc_enable "
-				  "module parameter to 0.\n");
-			return;
+			/*
+			 * Fall back to Buffer DMA rather than leaving the host
+			 * half initialized. Clear the parameter as well, or the
+			 * next core_init() would turn Descriptor DMA back on
+			 * for the HCD while HCFG.DescDMA stays clear.
+			 */
+			DWC_WARN("Host can't operate in Descriptor DMA mode.\n"
+				 "Either core version is below 2.90a or "
+				 "GHWCFG2, GHWCFG4 registers' values do not allow Descriptor DMA in host mode.\n"
+				 "Falling back to Buffer DMA host mode.\n");
+			core_if->core_params->dma_desc_enable = 0;
+			core_if->dma_desc_enable = 0;
+		} else {
+			hcfg.d32 =
+			    DWC_READ_REG32(&host_if->host_global_regs->hcfg);
+			hcfg.b.descdma = 1;
+			DWC_WRITE_REG32(&host_if->host_global_regs->hcfg,
+					hcfg.d32);
 		}
-		hcfg.d32 = DWC_READ_REG32(&host_if->host_global_regs->hcfg);
-		hcfg.b.descdma = 1;
-		DWC_WRITE_REG32(&host_if->host_global_regs->hcfg, hcfg.d32);
 	}
 
 	/* Configure data FIFO sizes */
@@ -2341,7 +2350,7 @@ void dwc_otg_core_host_init(dwc_otg_core_if_t * core_if)
 	gotgctl.b.hstsethnpen = 1;
 	DWC_MODIFY_REG32(&global_regs->gotgctl, gotgctl.d32, 0);
 
-	if (!core_if->core_params->dma_desc_enable) {
+	if (!core_if->dma_desc_enable) {
 		/* Flush out any leftover queued requests. */
 		num_channels = core_if->core_params->host_channels;
 
@@ -2673,7 +2682,7 @@ void dwc_otg_hc_halt(dwc_otg_core_if_t * core_if,
 
 	/* No need to set the bit in DDMA for disabling the channel */
 	//TODO check it everywhere channel is disabled          
-	if (!core_if->core_params->dma_desc_enable)
+	if (!core_if->dma_desc_enable)
 		hcchar.b.chen = 1;
 	hcchar.b.chdis = 1;
 
@@ -3673,7 +3682,8 @@ void dwc_otg_ep_start_transfer(dwc_otg_core_if_t * core_if, dwc_ep_t * ep)
 							ep->descs_dma_addr);
 				} else {
 #endif
-					init_dma_desc_chain(core_if, ep);
+					if (!ep->desc_chained)
+						init_dma_desc_chain(core_if, ep);
 				/** DIEPDMAn Register write */
 					DWC_WRITE_REG32(&in_regs->diepdma,
 							ep->dma_desc_addr);
@@ -147,6 +147,9 @@ typedef struct dwc_ep {
 	/** stall clear flag */
 	unsigned stall_clear_flag:1;
 
+	/** Descriptor chain was built by the PCD from several requests */
+	unsigned desc_chained:1;
+
 #ifdef DWC_UTE_CFI
 	/* The buffer mode */
 	data_buffer_mode_e buff_mode;
@@ -1266,8 +1266,11 @@ int dwc_otg_setup_params(dwc_otg_core_if_t * core_if)
 	dwc_otg_set_param_dma_enable(core_if, dwc_param_dma_enable_default);
 	//dwc_otg_set_param_dma_enable(core_if, DWC_PARAM_DMA_DISABLE);
 
-	//dwc_otg_set_param_dma_desc_enable(core_if, dwc_param_dma_desc_enable_default);
+#ifdef CONFIG_USB_SUSB_DESC_DMA
+	dwc_otg_set_param_dma_desc_enable(core_if, dwc_param_dma_desc_enable_default);
+#else
 	dwc_otg_set_param_dma_desc_enable(core_if, DWC_PARAM_DMA_DESC_DISABLE);
+#endif
 
 	dwc_otg_set_param_opt(core_if, dwc_param_opt_default);
 
@@ -3346,6 +3346,52 @@ void dwc_print_setup_data(uint8_t * setup)
 }
 #endif
 
+int dwc_otg_hcd_dump_ep_stats(dwc_otg_hcd_t * hcd, char *buf, int size)
+{
+	static char *ep_types[] = { "ctrl", "isoc", "bulk", "intr" };
+	dwc_list_link_t *sched[] = {
+		&hcd->non_periodic_sched_inactive,
+		&hcd->non_periodic_sched_active,
+		&hcd->periodic_sched_inactive,
+		&hcd->periodic_sched_ready,
+		&hcd->periodic_sched_assigned,
+		&hcd->periodic_sched_queued,
+	};
+	dwc_list_link_t *item;
+	dwc_otg_qh_t *qh;
+	dwc_irqflags_t flags;
+	uint32_t now, elapsed;
+	int i, len;
+
+	len = DWC_SNPRINTF(buf, size, "%s Descriptor DMA\n",
+			   hcd->core_if->dma_desc_enable ? "Using" : "Not using");
+
+	DWC_SPINLOCK_IRQSAVE(hcd->lock, &flags);
+	now = DWC_TIME();
+	for (i = 0; i < sizeof(sched) / sizeof(sched[0]) && len < size; i++) {
+		DWC_LIST_FOREACH(item, sched[i]) {
+			qh = DWC_LIST_ENTRY(item, dwc_otg_qh_t, qh_list_entry);
+			/* Whole seconds, to stay clear of 64-bit division */
+			elapsed = (now - qh->start_time) / 1000;
+			len += DWC_SNPRINTF(buf + len, size - len,
+					    "dev %3d ep %2d%s %s interval %u "
+					    "intr %u qtd %u intr/s %u\n",
+					    qh->dev_addr, qh->ep_num,
+					    qh->ep_is_in ? "in " : "out",
+					    ep_types[qh->ep_type & 3],
+					    qh->interval, qh->hc_intr_count,
+					    qh->qtd_done_count,
+					    elapsed ? qh->hc_intr_count / elapsed :
+					    qh->hc_intr_count);
+			if (len >= size)
+				break;
+		}
+	}
+	DWC_SPINUNLOCK_IRQRESTORE(hcd->lock, flags);
+
+	return len < size ? len : size - 1;
+}
+
 void dwc_otg_hcd_dump_frrem(dwc_otg_hcd_t * hcd)
 {
 #if 0
@@ -363,6 +363,24 @@ typedef struct dwc_otg_qh {
 
 	/** @} */
 
+	/** @name Endpoint statistics (hcd_ep_stats attribute) */
+	/** @{ */
+
+	/** Device address and endpoint number, for reporting only. */
+	uint8_t dev_addr;
+	uint8_t ep_num;
+
+	/** Host channel interrupts handled for this QH. */
+	uint32_t hc_intr_count;
+
+	/** QTDs retired from this QH (completed or dequeued). */
+	uint32_t qtd_done_count;
+
+	/** DWC_TIME() when the QH was created. */
+	uint32_t start_time;
+
+	/** @} */
+
 } dwc_otg_qh_t;
 
 DWC_CIRCLEQ_HEAD(hc_list, dwc_hc);
@@ -680,6 +698,7 @@ static inline void dwc_otg_hcd_qtd_remove_and_free(dwc_otg_hcd_t * hcd,
 {
 	dwc_otg_hcd_qtd_remove(hcd, qtd, qh);
 	dwc_otg_hcd_qtd_free(qtd);
+	qh->qtd_done_count++;
 }
 
 /** @} */
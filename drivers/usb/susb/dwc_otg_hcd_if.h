@@ -215,6 +215,20 @@ extern void dwc_otg_hcd_dump_state(dwc_otg_hcd_t * hcd);
  */
 extern void dwc_otg_hcd_dump_frrem(dwc_otg_hcd_t * hcd);
 
+/**
+ * Prints per-endpoint transfer statistics into a buffer: host channel
+ * interrupts and retired QTDs for every QH in the schedules, plus the
+ * channel interrupt rate.
+ *
+ * @param hcd The HCD
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ *
+ * @return Number of characters written, excluding the trailing NUL
+ */
+extern int dwc_otg_hcd_dump_ep_stats(dwc_otg_hcd_t * hcd, char *buf,
+				     int size);
+
 /**
  * Sends LPM transaction to the local device.
  *
@@ -171,6 +171,10 @@ void qh_init(dwc_otg_hcd_t * hcd, dwc_otg_qh_t * qh, dwc_otg_hcd_urb_t * urb)
 	DWC_LIST_INIT(&qh->qh_list_entry);
 	qh->channel = NULL;
 
+	qh->dev_addr = dwc_otg_hcd_get_dev_addr(&urb->pipe_info);
+	qh->ep_num = dwc_otg_hcd_get_ep_num(&urb->pipe_info);
+	qh->start_time = DWC_TIME();
+
 	/* FS/LS Enpoint on HS Hub 
 	 * NOT virtual root hub */
 	dev_speed = hcd->fops->speed(hcd, urb->priv);
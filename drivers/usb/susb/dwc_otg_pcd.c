@@ -87,6 +87,11 @@ void dwc_otg_request_done(dwc_otg_pcd_ep_t * ep, dwc_otg_pcd_request_t * req,
 	DWC_DEBUGPL(DBG_PCDV, "%s(%p)\n", __func__, ep);
 	DWC_CIRCLEQ_REMOVE_INIT(&ep->queue, req, queue_entry);
 
+	if (status == 0) {
+		ep->stats.bytes += req->actual;
+		ep->stats.reqs++;
+	}
+
 	/* don't modify queue heads during completion callback */
 	ep->stopped = 1;
 	/* spin_unlock/spin_lock now done in fops->complete() */
@@ -109,6 +114,7 @@ void dwc_otg_request_nuke(dwc_otg_pcd_ep_t * ep)
 	dwc_otg_pcd_request_t *req;
 
 	ep->stopped = 1;
+	ep->dwc_ep.desc_chained = 0;
 
 	/* called with irqs blocked?? */
 	while (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
@@ -117,6 +123,200 @@ void dwc_otg_request_nuke(dwc_otg_pcd_ep_t * ep)
 	}
 }
 
+/**
+ * Returns true if queued requests of the EP may be chained into one
+ * descriptor list. Only bulk IN endpoints in Descriptor DMA mode are
+ * chained. OUT requests are not: the host decides where an OUT transfer
+ * ends, so a request must complete on its short packet instead of when
+ * the whole chain has been filled, and a short packet in the middle of
+ * a multi-descriptor request would let the following data run into the
+ * rest of that request's buffer.
+ *
+ * This leaves the device-bound bulk traffic (adb push, MTP copies to the
+ * device) on the one-request-per-transfer path. Chaining those would
+ * need one descriptor per request with IOC on each and a completion
+ * path that retires requests while the chain keeps running.
+ */
+int dwc_otg_pcd_ep_can_chain(dwc_otg_pcd_ep_t * ep)
+{
+	if (!GET_CORE_IF(ep->pcd)->dma_desc_enable || !ep->dwc_ep.desc_addr)
+		return 0;
+#ifdef DWC_UTE_CFI
+	if (ep->dwc_ep.buff_mode != BM_STANDARD)
+		return 0;
+#endif
+	return ep->dwc_ep.num != 0 && ep->dwc_ep.is_in &&
+	    ep->dwc_ep.type == DWC_OTG_EP_TYPE_BULK;
+}
+
+/**
+ * Builds one descriptor chain from as many queued requests as fit in
+ * the EP descriptor list and starts it. Only the last descriptor has
+ * IOC set, so the whole chain completes with a single interrupt.
+ * complete_ep() retires the chained requests and starts the next chain
+ * from whatever was queued in the meantime. A request resumes at
+ * req->actual, which is non-zero only after dwc_otg_pcd_ep_stop_chain().
+ */
+void dwc_otg_pcd_ep_start_chain(dwc_otg_pcd_ep_t * ep)
+{
+	dwc_otg_core_if_t *core_if = GET_CORE_IF(ep->pcd);
+	dwc_ep_t *dwc_ep = &ep->dwc_ep;
+	dwc_otg_dev_dma_desc_t *dma_desc = dwc_ep->desc_addr;
+	dwc_otg_pcd_request_t *req;
+	uint32_t maxxfer, bytes, offset, len;
+	int cnt = 0, reqs = 0, need;
+
+	maxxfer = core_if->core_params->max_transfer_size;
+	if (maxxfer > DDMA_MAX_TRANSFER_SIZE)
+		maxxfer = DDMA_MAX_TRANSFER_SIZE;
+	maxxfer -= maxxfer % dwc_ep->maxpacket;
+
+	DWC_CIRCLEQ_FOREACH(req, &ep->queue, queue_entry) {
+		len = req->length - req->actual;
+		need = len ? (len + maxxfer - 1) / maxxfer : 1;
+		if (cnt && cnt + need > MAX_DMA_DESC_CNT)
+			break;
+
+		req->desc_first = cnt;
+		req->desc_cnt = need;
+		offset = req->actual;
+		do {
+			bytes = (len > maxxfer) ? maxxfer : len;
+			dma_desc->status.b.bs = BS_HOST_BUSY;
+			dma_desc->status.b.l = 0;
+			dma_desc->status.b.ioc = 0;
+			dma_desc->status.b.bytes = bytes;
+			/* Close the request with a short packet or a ZLP */
+			dma_desc->status.b.sp = (len == bytes) &&
+			    ((req->length % dwc_ep->maxpacket) ||
+			     req->sent_zlp || !req->length);
+			dma_desc->buf = req->dma + offset;
+			dma_desc->status.b.bs = BS_HOST_READY;
+
+			len -= bytes;
+			offset += bytes;
+			dma_desc++;
+		} while (len);
+
+		cnt += need;
+		reqs++;
+	}
+
+	if (!reqs)
+		return;
+
+	dma_desc--;
+	dma_desc->status.b.l = 1;
+	dma_desc->status.b.ioc = 1;
+
+	req = DWC_CIRCLEQ_FIRST(&ep->queue);
+	dwc_ep->dma_addr = req->dma;
+	dwc_ep->start_xfer_buff = req->buf;
+	dwc_ep->xfer_buff = req->buf;
+	dwc_ep->xfer_len = 0;
+	dwc_ep->xfer_count = 0;
+	dwc_ep->total_len = 0;
+	dwc_ep->sent_zlp = 0;
+	dwc_ep->maxxfer = maxxfer;
+	dwc_ep->desc_cnt = cnt;
+	dwc_ep->desc_chained = 1;
+
+	ep->stats.chains++;
+	if (reqs > ep->stats.max_chain)
+		ep->stats.max_chain = reqs;
+
+	dwc_otg_ep_start_transfer(core_if, dwc_ep);
+}
+
+/**
+ * Stops the chain in flight so that a request can be taken out of it.
+ * The EP is NAKed and disabled and its Tx FIFO flushed. Requests the
+ * core has fetched completely are completed, the first partly fetched
+ * one keeps its progress in req->actual, and the caller rebuilds the
+ * chain from what is left with dwc_otg_pcd_ep_start_chain(). Data that
+ * was fetched but still sat in the FIFO is lost with the flush, as on
+ * any bulk IN cancel.
+ */
+static void dwc_otg_pcd_ep_stop_chain(dwc_otg_pcd_ep_t * ep)
+{
+	dwc_otg_core_if_t *core_if = GET_CORE_IF(ep->pcd);
+	dwc_otg_dev_in_ep_regs_t *in_regs =
+	    core_if->dev_if->in_ep_regs[ep->dwc_ep.num];
+	dwc_otg_dev_dma_desc_t *dma_desc;
+	dwc_otg_pcd_request_t *req;
+	depctl_data_t depctl = {.d32 = 0 };
+	diepint_data_t diepint = {.d32 = 0 };
+	uint32_t residue, done;
+	int timeout;
+
+	depctl.d32 = DWC_READ_REG32(&in_regs->diepctl);
+	if (depctl.b.epena) {
+		depctl.d32 = 0;
+		depctl.b.snak = 1;
+		DWC_MODIFY_REG32(&in_regs->diepctl, depctl.d32, depctl.d32);
+		for (timeout = 1000; timeout; timeout--) {
+			diepint.d32 = DWC_READ_REG32(&in_regs->diepint);
+			if (diepint.b.inepnakeff)
+				break;
+			dwc_udelay(1);
+		}
+
+		depctl.b.epdis = 1;
+		DWC_MODIFY_REG32(&in_regs->diepctl, depctl.d32, depctl.d32);
+		for (timeout = 1000; timeout; timeout--) {
+			diepint.d32 = DWC_READ_REG32(&in_regs->diepint);
+			if (diepint.b.epdisabled)
+				break;
+			dwc_udelay(1);
+		}
+		if (!timeout)
+			DWC_WARN("EP%d IN disable timeout\n", ep->dwc_ep.num);
+	}
+
+	/*
+	 * Handled here, keep the interrupt handler out of it. A chain that
+	 * finished before we got the lock has XferCompl pending; its
+	 * requests are retired below, and complete_ep() must not retire
+	 * the rebuilt chain for it.
+	 */
+	diepint.d32 = 0;
+	diepint.b.xfercompl = 1;
+	diepint.b.inepnakeff = 1;
+	diepint.b.epdisabled = 1;
+	DWC_WRITE_REG32(&in_regs->diepint, diepint.d32);
+
+	dwc_otg_flush_tx_fifo(core_if, ep->dwc_ep.tx_fifo_num);
+	ep->dwc_ep.desc_chained = 0;
+
+	while (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
+		req = DWC_CIRCLEQ_FIRST(&ep->queue);
+		if (!req->desc_cnt)
+			break;
+
+		dma_desc = ep->dwc_ep.desc_addr + req->desc_first;
+		residue = 0;
+		for (done = 0; done < req->desc_cnt; ++done, ++dma_desc) {
+			if (dma_desc->status.b.bs != BS_DMA_DONE)
+				break;
+			residue += dma_desc->status.b.bytes;
+		}
+
+		if (done < req->desc_cnt) {
+			/* Every descriptor but a request's last is maxxfer long */
+			req->actual += done * ep->dwc_ep.maxxfer;
+			break;
+		}
+
+		req->desc_cnt = 0;
+		req->actual = req->length - residue;
+		dwc_otg_request_done(ep, req, 0);
+	}
+
+	/* Nothing left belongs to a chain until it is rebuilt */
+	DWC_CIRCLEQ_FOREACH(req, &ep->queue, queue_entry)
+	    req->desc_cnt = 0;
+}
+
 void dwc_otg_pcd_start(dwc_otg_pcd_t * pcd,
 		       const struct dwc_otg_pcd_function_ops *fops)
 {
@@ -1365,6 +1565,46 @@ uint32_t dwc_otg_pcd_is_otg(dwc_otg_pcd_t * pcd)
 	return 1;
 }
 
+static int dwc_otg_pcd_dump_one_ep(dwc_otg_pcd_ep_t * ep, char *buf, int size)
+{
+	dwc_otg_pcd_ep_stats_t *st = &ep->stats;
+	uint32_t secs;
+
+	if (!ep->desc)
+		return 0;
+
+	/* Whole seconds and KiB, to stay clear of 64-bit division */
+	secs = (DWC_TIME() - st->start_time) / 1000;
+	return DWC_SNPRINTF(buf, size,
+			    "ep%d%s reqs %u bytes %llu xfer_intr %u chains %u "
+			    "max_chain %u KiB/s %u\n",
+			    ep->dwc_ep.num, ep->dwc_ep.is_in ? "in " : "out",
+			    st->reqs, st->bytes, st->xfer_intr, st->chains,
+			    st->max_chain,
+			    (uint32_t) (st->bytes >> 10) / (secs ? secs : 1));
+}
+
+/**
+ * Prints the throughput counters of all enabled endpoints.
+ */
+int dwc_otg_pcd_dump_ep_stats(dwc_otg_pcd_t * pcd, char *buf, int size)
+{
+	dwc_otg_dev_if_t *dev_if = GET_CORE_IF(pcd)->dev_if;
+	dwc_irqflags_t flags;
+	int i, len = 0;
+
+	DWC_SPINLOCK_IRQSAVE(pcd->lock, &flags);
+	for (i = 0; i < dev_if->num_in_eps && len < size; i++)
+		len += dwc_otg_pcd_dump_one_ep(&pcd->in_ep[i], buf + len,
+					       size - len);
+	for (i = 0; i < dev_if->num_out_eps && len < size; i++)
+		len += dwc_otg_pcd_dump_one_ep(&pcd->out_ep[i], buf + len,
+					       size - len);
+	DWC_SPINUNLOCK_IRQRESTORE(pcd->lock, flags);
+
+	return len < size ? len : size - 1;
+}
+
 /**
  * This function assigns periodic Tx FIFO to an periodic EP
  * in shared Tx FIFO mode
@@ -1487,10 +1727,14 @@ int dwc_otg_pcd_ep_enable(dwc_otg_pcd_t * pcd,
 	ep->desc = desc;
 	ep->priv = usb_ep;
 
+	dwc_memset(&ep->stats, 0, sizeof(ep->stats));
+	ep->stats.start_time = DWC_TIME();
+
 	/*
 	 * Activate the EP
 	 */
 	ep->stopped = 0;
+	ep->dwc_ep.desc_chained = 0;
 
 	ep->dwc_ep.is_in = (dir == UE_DIR_IN);
 	ep->dwc_ep.maxpacket = UGETW(desc->wMaxPacketSize);
@@ -2074,6 +2318,8 @@ int dwc_otg_pcd_ep_queue(dwc_otg_pcd_t * pcd, void *ep_handle,
 	req->length = buflen;
 	req->sent_zlp = zero;
 	req->priv = req_handle;
+	req->actual = 0;
+	req->desc_cnt = 0;
 
 	DWC_SPINLOCK_IRQSAVE(pcd->lock, &flags);
 
@@ -2141,7 +2387,12 @@ int dwc_otg_pcd_ep_queue(dwc_otg_pcd_t * pcd, void *ep_handle,
 			dwc_otg_ep0_start_transfer(GET_CORE_IF(pcd),
 						   &ep->dwc_ep);
 		}		// non-ep0 endpoints
-		else {
+		else if (dwc_otg_pcd_ep_can_chain(ep)) {
+			++pcd->request_pending;
+			DWC_CIRCLEQ_INSERT_TAIL(&ep->queue, req, queue_entry);
+			req = 0;
+			dwc_otg_pcd_ep_start_chain(ep);
+		} else {
 #ifdef DWC_UTE_CFI
 			if (ep->dwc_ep.buff_mode != BM_STANDARD) {
 				/* store the request length */
@@ -2256,7 +2507,26 @@ int dwc_otg_pcd_ep_dequeue(dwc_otg_pcd_t * pcd, void *ep_handle,
 		return -DWC_E_INVALID;
 	}
 
-	if (!DWC_CIRCLEQ_EMPTY_ENTRY(req, queue_entry)) {
+	/*
+	 * The core may still be fetching this request's descriptors. Stop
+	 * the chain before giving it back, then rebuild it from the rest.
+	 */
+	if (ep->dwc_ep.desc_chained && req->desc_cnt) {
+		dwc_otg_pcd_ep_stop_chain(ep);
+
+		/* Completed by the stop if the core had fetched all of it */
+		DWC_CIRCLEQ_FOREACH(req, &ep->queue, queue_entry) {
+			if (req->priv == (void *)req_handle)
+				break;
+		}
+		if (req->priv == (void *)req_handle)
+			dwc_otg_request_done(ep, req, -DWC_E_RESTART);
+		else
+			req = NULL;
+
+		if (!ep->stopped && !DWC_CIRCLEQ_EMPTY(&ep->queue))
+			dwc_otg_pcd_ep_start_chain(ep);
+	} else if (!DWC_CIRCLEQ_EMPTY_ENTRY(req, queue_entry)) {
 		dwc_otg_request_done(ep, req, -DWC_E_RESTART);
 	} else {
 		req = NULL;
@@ -137,6 +137,11 @@ typedef struct dwc_otg_pcd_request {
 	uint32_t actual;
 	unsigned sent_zlp:1;
 
+	/** First descriptor and descriptor count of this request in the
+	 * endpoint descriptor chain, desc_cnt is 0 when not chained. */
+	uint16_t desc_first;
+	uint16_t desc_cnt;
+
 	 DWC_CIRCLEQ_ENTRY(dwc_otg_pcd_request) queue_entry;
 #ifdef DWC_UTE_PER_IO
 	struct dwc_iso_xreq_port ext_req;
@@ -146,6 +151,20 @@ typedef struct dwc_otg_pcd_request {
 
 DWC_CIRCLEQ_HEAD(req_list, dwc_otg_pcd_request);
 
+/** Per endpoint throughput counters, reset when the EP is enabled. */
+typedef struct dwc_otg_pcd_ep_stats {
+	/** Bytes and requests completed successfully */
+	uint64_t bytes;
+	uint32_t reqs;
+	/** Transfer Complete interrupts handled */
+	uint32_t xfer_intr;
+	/** Descriptor chains started and the most requests in one chain */
+	uint32_t chains;
+	uint32_t max_chain;
+	/** DWC_TIME() when the EP was enabled */
+	uint32_t start_time;
+} dwc_otg_pcd_ep_stats_t;
+
 /**	  PCD EP structure.
  * This structure describes an EP, there is an array of EPs in the PCD
  * structure.
@@ -173,6 +192,9 @@ typedef struct dwc_otg_pcd_ep {
 	struct dwc_otg_pcd *pcd;
 
 	void *priv;
+
+	/** Throughput counters */
+	dwc_otg_pcd_ep_stats_t stats;
 } dwc_otg_pcd_ep_t;
 
 /** DWC_otg PCD Structure.
@@ -250,6 +272,8 @@ struct dwc_otg_pcd {
 extern void dwc_otg_request_nuke(dwc_otg_pcd_ep_t * ep);
 extern void dwc_otg_request_done(dwc_otg_pcd_ep_t * ep,
 				 dwc_otg_pcd_request_t * req, int32_t status);
+extern int dwc_otg_pcd_ep_can_chain(dwc_otg_pcd_ep_t * ep);
+extern void dwc_otg_pcd_ep_start_chain(dwc_otg_pcd_ep_t * ep);
 
 void dwc_otg_iso_buffer_done(dwc_otg_pcd_t * pcd, dwc_otg_pcd_ep_t * ep,
 			     void *req_handle);
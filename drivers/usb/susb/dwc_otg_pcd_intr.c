@@ -201,6 +201,10 @@ void start_next_request(dwc_otg_pcd_ep_t * ep)
 	if (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
 		req = DWC_CIRCLEQ_FIRST(&ep->queue);
 
+		if (dwc_otg_pcd_ep_can_chain(ep)) {
+			dwc_otg_pcd_ep_start_chain(ep);
+			return;
+		}
 #ifdef DWC_UTE_CFI
 		if (ep->dwc_ep.buff_mode != BM_STANDARD) {
 			ep->dwc_ep.cfi_req_len = req->length;
@@ -1945,6 +1949,44 @@ static inline int cfi_calc_desc_residue(dwc_otg_pcd_ep_t * ep)
 }
 #endif
 
+/**
+ * Completes every request of a chain started by
+ * dwc_otg_pcd_ep_start_chain() and starts the next chain. Requests
+ * dequeued while the chain was in flight are simply no longer found.
+ */
+static void complete_ep_chain(dwc_otg_pcd_ep_t * ep)
+{
+	dwc_otg_pcd_request_t *req;
+	dwc_otg_dev_dma_desc_t *dma_desc;
+	uint32_t residue;
+	int i;
+
+	ep->dwc_ep.desc_chained = 0;
+
+	while (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
+		req = DWC_CIRCLEQ_FIRST(&ep->queue);
+		if (!req->desc_cnt)
+			break;
+
+		dma_desc = ep->dwc_ep.desc_addr + req->desc_first;
+		residue = 0;
+		for (i = 0; i < req->desc_cnt; ++i, ++dma_desc)
+			residue += dma_desc->status.b.bytes;
+		if (residue)
+			DWC_WARN("Incomplete transfer (%d-IN residue=%d)\n",
+				 ep->dwc_ep.num, residue);
+
+		req->actual = req->length - residue;
+		dwc_otg_request_done(ep, req, 0);
+	}
+
+	ep->dwc_ep.start_xfer_buff = 0;
+	ep->dwc_ep.xfer_buff = 0;
+	ep->dwc_ep.xfer_len = 0;
+
+	start_next_request(ep);
+}
+
 /**
  * This function completes the request for the EP. If there are
  * additional requests for the EP in the queue they will be started.
@@ -1968,6 +2010,12 @@ static void complete_ep(dwc_otg_pcd_ep_t * ep)
 
 	//printk("%s() %d-%s\n", __func__, ep->dwc_ep.num, (ep->dwc_ep.is_in ? "IN" : "OUT"));
 
+	ep->stats.xfer_intr++;
+	if (ep->dwc_ep.desc_chained) {
+		complete_ep_chain(ep);
+		return;
+	}
+
 	/* Get any pending requests */
 	if (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
 		req = DWC_CIRCLEQ_FIRST(&ep->queue);
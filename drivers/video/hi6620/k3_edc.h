@@ -50,6 +50,11 @@
 #define K3FB_SBL_SET_VALUE	_IOW(K3FB_IOCTL_MAGIC, 141, int)
 
 #define K3FB_G2D_LOCK_FREQ	_IOW(K3FB_IOCTL_MAGIC, 143, int)
+/*
+ * fb1: 1 = every play returns a release fence the caller has to close,
+ * 0 (default, old ABI) = only video layers get one.
+ */
+#define K3FB_EDC1_FENCE_SET	_IOW(K3FB_IOCTL_MAGIC, 144, int)
 /* v9r1 bbit test macro  start */
 #define FB_BBIT_TEST_ENABLE    1
 
@@ -346,13 +346,43 @@ done:
 	return ret;
 }
 
+/* signal every fence of the fb, used when it stops scanning out */
+STATIC void k3fb_fence_flush(struct k3_fb_data_type *k3fd)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&k3fd->refresh_lock,flags);
+	if (k3fd->index == 1) {
+		/*
+		** the timeline is one frame behind timeline_max, and plays not
+		** latched yet wait on timeline_max + 1: signal up to there and
+		** keep the one frame lead
+		*/
+		sw_sync_timeline_inc(k3fd->timeline, k3fd->refresh_latched + 2);
+		k3fd->timeline_max += 2;
+	} else {
+		sw_sync_timeline_inc(k3fd->timeline, 1 + k3fd->refresh);
+		k3fd->timeline_max++;
+	}
+	k3fd->refresh = 0;
+	k3fd->refresh_latched = 0;
+	spin_unlock_irqrestore(&k3fd->refresh_lock,flags);
+}
+
 void k3fb_set_hdmi_state(bool is_connected)
 {
+	struct fb_info *info = fbi_list[1];
+
 	if (hdmi_is_connected == is_connected) {
 		return;
 	}
 	k3fb_logi("hdmi_is_connected: %d is_connected: %d\n", hdmi_is_connected , is_connected);
 	hdmi_is_connected = is_connected;
+
+	/* fb1 frames stop when the sink goes away, do not leave its fences pending */
+	if (!is_connected && info && info->par) {
+		k3fb_fence_flush((struct k3_fb_data_type *)info->par);
+	}
 #if K3_FB_OVERLAY_USE_BUF
 	if (video_buf.is_init) {
 		mutex_lock(&video_buf.overlay_mutex);
@@ -1616,6 +1646,28 @@ static int k3fb_fence_inc_thread(void *data)
 	return 0;
 
 }
+
+/*
+** fb1 may post several layers per frame. All plays between two frame
+** starts share one fence value, and a frame start that latches new plays
+** releases the frame they replace, see edc_isr_video_mode.
+*/
+static int k3fb_edc1_fence_inc_thread(void *data)
+{
+	unsigned long  flag;
+	struct k3_fb_data_type *k3fd = (struct k3_fb_data_type *)data;
+
+	while (!kthread_should_stop()) {
+		int ret = wait_event_interruptible(k3fd->fence_inc_wait,(k3fd->refresh_latched > 0));
+		if (ret == 0) {
+			spin_lock_irqsave(&k3fd->refresh_lock, flag);
+			sw_sync_timeline_inc(k3fd->timeline, k3fd->refresh_latched);
+			k3fd->refresh_latched = 0;
+			spin_unlock_irqrestore(&k3fd->refresh_lock, flag);
+		}
+	}
+	return 0;
+}
 /******************************************************************************/
 STATIC void k3fb_te_inc(struct k3_fb_data_type *k3fd, bool te_should_enable,bool in_isr)
 {
@@ -2232,7 +2284,7 @@ static irqreturn_t edc_isr_video_mode(struct k3_fb_data_type *k3fd, u32 ints)
 	** 0x40 for bas_end_int
 	*/
 	if((ints & 0x40) == 0x40){
-	    if(k3fd->refresh && k3fd->fence_inc_thread){
+	    if(k3fd->index == 0 && k3fd->refresh && k3fd->fence_inc_thread){
 		  wake_up_interruptible(&k3fd->fence_inc_wait);
 	    }
 	}
@@ -2244,12 +2296,30 @@ static irqreturn_t edc_isr_video_mode(struct k3_fb_data_type *k3fd, u32 ints)
 		k3fd->update_frame = 1;
 		wake_up_interruptible(&k3fd->frame_wq);
 
-		if (k3fd->index == 0) {
-			if (k3fd->vsync_info.active && k3fd->vsync_info.thread) {
-				k3fd->vsync_info.timestamp = ktime_get();
-				wake_up_interruptible_all(&k3fd->vsync_info.wait);
+		/* each edc reports its own vsync, fb1 is paced by the hdmi timing */
+		if (k3fd->vsync_info.active && k3fd->vsync_info.thread) {
+			k3fd->vsync_info.timestamp = ktime_get();
+			wake_up_interruptible_all(&k3fd->vsync_info.wait);
+		}
+
+		if (k3fd->index == 1) {
+			/*
+			** new plays are latched: they become the frame on screen
+			** (timeline_max) and the previous frame can be released
+			*/
+			spin_lock(&k3fd->refresh_lock);
+			if (k3fd->refresh) {
+				k3fd->refresh_latched++;
+				k3fd->timeline_max++;
+				k3fd->refresh = 0;
 			}
+			spin_unlock(&k3fd->refresh_lock);
 
+			if (k3fd->refresh_latched && k3fd->fence_inc_thread)
+				wake_up_interruptible(&k3fd->fence_inc_wait);
+		}
+
+		if (k3fd->index == 0) {
 			if (k3fd->panel_info.sbl_enable && k3fd->sbl_wq)
 				queue_work(k3fd->sbl_wq, &k3fd->sbl_work);
 
@@ -2539,18 +2609,35 @@ int k3fb_wifi_disp_clear_fbstatus(void __user *p)
 
 /******************************************************************************/
 
+/* fb0 drives the edc0 channels, fb1 (hdmi) owns the two edc1 channels */
+STATIC bool k3fb_overlay_pipe_owned(struct k3_fb_data_type *k3fd, int ndx)
+{
+	if (k3fd->index == 1)
+		return (ndx == OVERLAY_PIPE_EDC1_CH1) || (ndx == OVERLAY_PIPE_EDC1_CH2);
+
+	return (ndx >= 0) && (ndx < OVERLAY_PIPE_EDC1_CH1);
+}
+
 STATIC int k3fb_overlay_get(struct fb_info *info, void __user *p)
 {
 	int ret = 0;
 	struct overlay_info req;
+	struct k3_fb_data_type *k3fd = NULL;
 
 	BUG_ON(info == NULL);
+	k3fd = (struct k3_fb_data_type *)info->par;
+	BUG_ON(k3fd == NULL);
 
 	if (copy_from_user(&req, p, sizeof(req))) {
 		k3fb_loge("copy from user failed!\n");
 		return -EFAULT;
 	}
 
+	if (!k3fb_overlay_pipe_owned(k3fd, req.id)) {
+		k3fb_loge("fb%d does not own pipe %d!\n", k3fd->index, req.id);
+		return -EINVAL;
+	}
+
 	ret = edc_overlay_get(info, &req);
 	if (ret) {
 		k3fb_loge("edc_overlay_get ioctl failed!\n");
@@ -2569,14 +2656,22 @@ STATIC int k3fb_overlay_set(struct fb_info *info, void __user *p)
 {
 	int ret = 0;
 	struct overlay_info req;
+	struct k3_fb_data_type *k3fd = NULL;
 
 	BUG_ON(info == NULL);
+	k3fd = (struct k3_fb_data_type *)info->par;
+	BUG_ON(k3fd == NULL);
 
 	if (copy_from_user(&req, p, sizeof(req))) {
 		k3fb_loge("copy from user failed!\n");
 		return -EFAULT;
 	}
 
+	if (!k3fb_overlay_pipe_owned(k3fd, req.id)) {
+		k3fb_loge("fb%d does not own pipe %d!\n", k3fd->index, req.id);
+		return -EINVAL;
+	}
+
 	ret = edc_overlay_set(info, &req);
 	if (ret) {
 		k3fb_loge("k3fb_overlay_set ioctl failed, error=%d!\n", ret);
@@ -2603,6 +2698,11 @@ STATIC int k3fb_overlay_unset(struct fb_info *info, unsigned long *argp)
 		return ret;
 	}
 
+	if (!k3fb_overlay_pipe_owned(k3fd, ndx)) {
+		k3fb_loge("fb%d does not own pipe %d!\n", k3fd->index, ndx);
+		return -EINVAL;
+	}
+
 #if K3_FB_OVERLAY_USE_BUF
 	if ((k3fd->index == 1) && video_buf.is_init && video_buf.is_video) {
 		video_buf.is_video = false;
@@ -2622,8 +2722,8 @@ STATIC int k3fb_overlay_play(struct fb_info *info, unsigned long *argp)
 	struct overlay_data req;
 	struct k3_fb_data_type *k3fd = NULL;
     int fenceId = 0;
+    int fence_value = 0;
     unsigned long flags;
-    static int edc1videoplayed = 0;
 #if K3_FB_OVERLAY_USE_BUF
 	static int count = 0;
 	overlay_video_data *video_data = NULL;
@@ -2674,38 +2774,10 @@ STATIC int k3fb_overlay_play(struct fb_info *info, unsigned long *argp)
 	/* wifi display end */
 
 
-if((k3fd->index == 1) && hdmi_is_connected){
-    if (req.src.is_video == 1){
-
-        fenceId = k3_fb_overlay_fence_create(k3fd->timeline, "edc1", ++k3fd->timeline_max);
-
-        if(fenceId < 0)
-        {
-            k3fb_loge("edc1 failed to create fence!\n");
-        }
-
-         spin_lock_irqsave(&k3fd->refresh_lock,flags);
-         k3fd->refresh ++;
-         spin_unlock_irqrestore(&k3fd->refresh_lock,flags);
-        req.src.release_fence = fenceId;
-        if((fenceId>=0)&&copy_to_user((struct overlay_data __user*)argp, &req, sizeof(struct overlay_data)))
-        {
-            fenceId = -EFAULT;
-            k3fb_loge("edc1 failed to copy fence to user!\n");
-            put_unused_fd(req.src.release_fence);
-            return fenceId;
-        }
-        edc1videoplayed = 1;
-    }
-    if ((req.src.is_video == 0)&&edc1videoplayed){
-        spin_lock_irqsave(&k3fd->refresh_lock,flags);
-        sw_sync_timeline_inc(k3fd->timeline, 1 + k3fd->refresh);
-        k3fd->refresh = 0;
-        k3fd->timeline_max++;
-        edc1videoplayed = 0;
-        spin_unlock_irqrestore(&k3fd->refresh_lock,flags);
-       }
-}
+	if (!k3fb_overlay_pipe_owned(k3fd, req.id)) {
+		k3fb_loge("fb%d does not own pipe %d!\n", k3fd->index, req.id);
+		return -EINVAL;
+	}
 
 #if K3_FB_OVERLAY_USE_BUF
 	if ((k3fd->index == 1) && hdmi_is_connected && (req.src.is_video == 1) && should_use_videobuf(info)) {
@@ -2764,17 +2836,37 @@ if((k3fd->index == 1) && hdmi_is_connected){
 	}
 #endif //CONFIG_OVERLAY_COMPOSE
 
-	if (k3fd->index == 1 && hdmi_is_connected && (!req.src.is_video || !should_use_videobuf(info))) {
-		if (wait_event_interruptible_timeout(k3fd->frame_wq, k3fd->update_frame, HZ / 10) <= 0) {
-			k3fb_logw("wait_event_interruptible_timeout !\n");
-			k3fd->update_frame = 0;
-			return -ETIME;
+    ret =  edc_overlay_play(info, &req);
+
+	/*
+	** fb1 does not block for its frame here, the caller is paced by the
+	** edc1 vsync and the release fences. Every play before the next frame
+	** start belongs to the next frame and gets its fence value, which is
+	** signaled once a later frame has replaced it on screen. Only video
+	** layers get a fence unless the caller opted in with
+	** K3FB_EDC1_FENCE_SET, an older composer would leak the fds.
+	*/
+	if ((k3fd->index == 1) && hdmi_is_connected && (ret == 0)) {
+		spin_lock_irqsave(&k3fd->refresh_lock,flags);
+		fence_value = k3fd->timeline_max + 1;
+		k3fd->refresh ++;
+		spin_unlock_irqrestore(&k3fd->refresh_lock,flags);
+
+		if (req.src.is_video || k3fd->fence_all_layers) {
+			fenceId = k3_fb_overlay_fence_create(k3fd->timeline, "edc1", fence_value);
+			if (fenceId < 0) {
+				k3fb_loge("edc1 failed to create fence!\n");
+			}
+
+			req.src.release_fence = fenceId;
+			if ((fenceId >= 0) && copy_to_user((struct overlay_data __user*)argp, &req, sizeof(struct overlay_data))) {
+				k3fb_loge("edc1 failed to copy fence to user!\n");
+				put_unused_fd(req.src.release_fence);
+				return -EFAULT;
+			}
 		}
-		k3fd->update_frame = 0;
 	}
 
-    ret =  edc_overlay_play(info, &req);
-
     if (k3fd->panel_info.type == PANEL_MIPI_CMD) {
         set_LDI_CTRL_ldi_en(k3fd->edc_base, K3_ENABLE);
         set_EDC_DSI_TE_CTRL(0x4001);
@@ -2803,6 +2895,29 @@ if((k3fd->index == 1) && hdmi_is_connected){
 	return ret;
 }
 
+STATIC int k3fb_edc1_fence_set(struct fb_info *info, unsigned long *argp)
+{
+	int enable = 0;
+	struct k3_fb_data_type *k3fd = NULL;
+
+	BUG_ON(info == NULL);
+	k3fd = (struct k3_fb_data_type *)info->par;
+	BUG_ON(k3fd == NULL);
+
+	if (k3fd->index != 1) {
+		k3fb_loge("fb%d has no edc1 fences!\n", k3fd->index);
+		return -EINVAL;
+	}
+
+	if (copy_from_user(&enable, argp, sizeof(enable))) {
+		k3fb_loge("copy from user failed!\n");
+		return -EFAULT;
+	}
+
+	k3fd->fence_all_layers = (enable == 1) ? true : false;
+	return 0;
+}
+
 STATIC int k3fb_vsync_int_set(struct fb_info *info, unsigned long *argp)
 {
 	int ret = 0;
@@ -3034,7 +3149,6 @@ int k3_fb_blank_sub(int blank_mode, struct fb_info *info,bool sem)
 	*/
 
 	int ret = 0;
-	unsigned long flags;
 	struct k3_fb_data_type *k3fd = NULL;
 	struct k3_fb_panel_data *pdata = NULL;
        bool curr_pwr_state = false;
@@ -3169,11 +3283,7 @@ int k3_fb_blank_sub(int blank_mode, struct fb_info *info,bool sem)
 #ifdef CONFIG_TOUCHSCREEN_DOUBLETAP2WAKE
 skip:
 #endif
-			spin_lock_irqsave(&k3fd->refresh_lock,flags);
-			sw_sync_timeline_inc(k3fd->timeline, 1 + k3fd->refresh);
-			k3fd->refresh = 0;
-	    	  	spin_unlock_irqrestore(&k3fd->refresh_lock,flags);
-			k3fd->timeline_max++;
+			k3fb_fence_flush(k3fd);
 
 		}
 		break;
@@ -3634,6 +3744,7 @@ STATIC int k3_fb_pan_display_cmd_mode(struct fb_var_screeninfo *var,
 {
 	int ret = 0;
 	unsigned long flags;
+	bool wait_frame = true;
 	struct k3_fb_data_type *k3fd = NULL;
 
 	BUG_ON(info == NULL);
@@ -3666,10 +3777,10 @@ STATIC int k3_fb_pan_display_cmd_mode(struct fb_var_screeninfo *var,
     k3fb_logi_vsync_debugfs("k3fd->frc_state = %d \n", k3fd->frc_state);
 
 #if K3_FB_OVERLAY_USE_BUF
-	if (!hdmi_is_connected || video_buf.is_video) {
-#else
-	if (!hdmi_is_connected) {
+	wait_frame = (k3fd->index == 0) || !hdmi_is_connected || video_buf.is_video;
 #endif
+	/* each fb waits for its own edc, hdmi no longer holds back the panel */
+	if (wait_frame) {
 		ret = wait_event_interruptible_timeout(k3fd->frame_wq, k3fd->update_frame, HZ / 10);
 		if (ret <= 0 || (k3fd->esd_recover == true)) {
 			if (k3fd->esd_recover == true) {
@@ -3717,6 +3828,7 @@ STATIC int k3_fb_pan_display_video_mode(struct fb_var_screeninfo *var,
 {
 	int ret = 0;
 	unsigned long flags;
+	bool wait_frame = true;
 	struct k3_fb_data_type *k3fd = NULL;
 
 	BUG_ON(info == NULL);
@@ -3724,10 +3836,10 @@ STATIC int k3_fb_pan_display_video_mode(struct fb_var_screeninfo *var,
 	BUG_ON(k3fd == NULL);
 
 #if K3_FB_OVERLAY_USE_BUF
-	if (!hdmi_is_connected || video_buf.is_video) {
-#else
-	if (!hdmi_is_connected) {
+	wait_frame = (k3fd->index == 0) || !hdmi_is_connected || video_buf.is_video;
 #endif
+	/* each fb waits for its own edc, hdmi no longer holds back the panel */
+	if (wait_frame) {
 		ret = wait_event_interruptible_timeout(k3fd->frame_wq, k3fd->update_frame, HZ / 10);
 		if (ret <= 0) {
 			k3fb_logw("wait_event_interruptible_timeout !edcfence_refresh=%d\n",k3fd->refresh);
@@ -4220,6 +4332,9 @@ STATIC int k3_fb_ioctl(struct fb_info *info, unsigned int cmd, unsigned long arg
 	case K3FB_G2D_LOCK_FREQ:
 		ret = k3fb_g2d_lock_freq(info, argp);
 		break;
+	case K3FB_EDC1_FENCE_SET:
+		ret = k3fb_edc1_fence_set(info, argp);
+		break;
 #ifdef CONFIG_FOLLOWABILITY
         case K3FB_FOLLOW_START:
             k3fb_follow_start();
@@ -4793,13 +4908,25 @@ int k3_fb_register(struct k3_fb_data_type *k3fd)
 		}
 
 	} else if (k3fd->index == 1) {
+		memset(&(k3fd->vsync_info), 0, sizeof(k3fd->vsync_info));
+		spin_lock_init(&k3fd->vsync_info.irq_lock);
 
-    init_waitqueue_head(&k3fd->fence_inc_wait);
-    k3fd->fence_inc_thread = kthread_run(k3fb_fence_inc_thread, k3fd, "k3fb-fenceinc-edc1");
-    if (IS_ERR(k3fd->fence_inc_thread)) {
-        k3fb_loge("failed to run fenceinc-edc1 thread\n");
-        k3fd->fence_inc_thread = NULL;
-    }
+		/* Vsync */
+		init_waitqueue_head(&k3fd->vsync_info.wait);
+
+		/* Create vsync thread */
+		k3fd->vsync_info.thread = kthread_run(k3fb_wait_for_vsync_thread, k3fd, "k3fb-vsync-edc1");
+		if (IS_ERR(k3fd->vsync_info.thread)) {
+			k3fb_loge("failed to run vsync-edc1 thread\n");
+			k3fd->vsync_info.thread = NULL;
+		}
+
+		init_waitqueue_head(&k3fd->fence_inc_wait);
+		k3fd->fence_inc_thread = kthread_run(k3fb_edc1_fence_inc_thread, k3fd, "k3fb-fenceinc-edc1");
+		if (IS_ERR(k3fd->fence_inc_thread)) {
+			k3fb_loge("failed to run fenceinc-edc1 thread\n");
+			k3fd->fence_inc_thread = NULL;
+		}
 	#if K3_FB_OVERLAY_USE_BUF
 		overlay_play_work(k3fd);
 	#endif
@@ -5062,6 +5189,8 @@ STATIC int k3_fb_probe(struct platform_device *pdev)
         k3fd->timeline = sw_sync_timeline_create("k3-fb-edc1");
         k3fd->timeline_max = 1;
         k3fd->refresh = 0;
+        k3fd->refresh_latched = 0;
+        k3fd->fence_all_layers = false;
         spin_lock_init(&k3fd->refresh_lock);
 
 		/* edc1 vcc */
@@ -5234,6 +5363,12 @@ STATIC int k3_fb_remove(struct platform_device *pdev)
 			regulator_put(k3fd->edc_vcc);
 		}
 
+		if (k3fd->vsync_info.thread)
+			kthread_stop(k3fd->vsync_info.thread);
+
+		if (k3fd->fence_inc_thread)
+			kthread_stop(k3fd->fence_inc_thread);
+
 	#if K3_FB_OVERLAY_USE_BUF
 		if (video_buf.play_wq) {
 			video_buf.exit_work = 1;
@@ -371,6 +371,10 @@ struct k3_fb_data_type {
     struct sw_sync_timeline *timeline;
     int timeline_max;
     int refresh;
+    /* fb1: frames replaced on screen, not yet signaled */
+    int refresh_latched;
+    /* fb1: K3FB_EDC1_FENCE_SET, release fence for every play */
+    bool fence_all_layers;
     struct task_struct      *fence_inc_thread;
     wait_queue_head_t       fence_inc_wait;
     spinlock_t refresh_lock;
@@ -229,6 +229,7 @@ static unsigned len_args(unsigned numargs, struct fuse_arg *args)
 	return nbytes;
 }
 
+/* Called with fc->iq_lock held */
 static u64 fuse_get_unique(struct fuse_conn *fc)
 {
 	fc->reqctr++;
@@ -239,18 +240,27 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
-static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
+/*
+ * A zero @unique allocates a new request ID.
+ *
+ * Called with fc->lock held, takes fc->iq_lock.
+ */
+static void queue_request(struct fuse_conn *fc, struct fuse_req *req,
+			  u64 unique)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
-	req->state = FUSE_REQ_PENDING;
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
+	spin_lock(&fc->iq_lock);
+	req->in.h.unique = unique ? unique : fuse_get_unique(fc);
+	list_add_tail(&req->list, &fc->pending);
+	req->state = FUSE_REQ_PENDING;
 	wake_up(&fc->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	spin_unlock(&fc->iq_lock);
 }
 
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
@@ -259,7 +269,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	forget->forget_one.nodeid = nodeid;
 	forget->forget_one.nlookup = nlookup;
 
-	spin_lock(&fc->lock);
+	spin_lock(&fc->iq_lock);
 	if (fc->connected) {
 		fc->forget_list_tail->next = forget;
 		fc->forget_list_tail = forget;
@@ -268,7 +278,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	} else {
 		kfree(forget);
 	}
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 }
 
 static void flush_bg_queue(struct fuse_conn *fc)
@@ -280,8 +290,7 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		req->in.h.unique = fuse_get_unique(fc);
-		queue_request(fc, req);
+		queue_request(fc, req, 0);
 	}
 }
 
@@ -301,7 +310,12 @@ __releases(fc->lock)
 	void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
 	req->end = NULL;
 	list_del(&req->list);
-	list_del(&req->intr_entry);
+	if (req->interrupted) {
+		/* a reader may be handing out the interrupt right now */
+		spin_lock(&fc->iq_lock);
+		list_del(&req->intr_entry);
+		spin_unlock(&fc->iq_lock);
+	}
 	req->state = FUSE_REQ_FINISHED;
 	if (req->background) {
 		if (fc->num_background == fc->max_background) {
@@ -337,11 +351,14 @@ __acquires(fc->lock)
 	spin_lock(&fc->lock);
 }
 
+/* Called with fc->lock held, takes fc->iq_lock */
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
+	spin_lock(&fc->iq_lock);
 	list_add_tail(&req->intr_entry, &fc->interrupts);
 	wake_up(&fc->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	spin_unlock(&fc->iq_lock);
 }
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
@@ -376,12 +393,15 @@ __acquires(fc->lock)
 			return;
 
 		/* Request is not yet in userspace, bail out */
+		spin_lock(&fc->iq_lock);
 		if (req->state == FUSE_REQ_PENDING) {
 			list_del(&req->list);
+			spin_unlock(&fc->iq_lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
+		spin_unlock(&fc->iq_lock);
 	}
 
 	/*
@@ -421,8 +441,7 @@ void fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 	else if (fc->conn_error)
 		req->out.h.error = -ECONNREFUSED;
 	else {
-		req->in.h.unique = fuse_get_unique(fc);
-		queue_request(fc, req);
+		queue_request(fc, req, 0);
 		/* acquire extra reference, since request is still needed
 		   after request_end() */
 		__fuse_get_request(req);
@@ -474,10 +493,9 @@ static int fuse_request_send_notify_reply(struct fuse_conn *fc,
 	int err = -ENODEV;
 
 	req->isreply = 0;
-	req->in.h.unique = unique;
 	spin_lock(&fc->lock);
 	if (fc->connected) {
-		queue_request(fc, req);
+		queue_request(fc, req, unique);
 		err = 0;
 	}
 	spin_unlock(&fc->lock);
@@ -501,17 +519,21 @@ void fuse_request_send_background_locked(struct fuse_conn *fc,
  * Lock the request.  Up to the next unlock_request() there mustn't be
  * anything that could cause a page-fault.  If the request was already
  * aborted bail out.
+ *
+ * This happens for every page copied to or from the daemon, so it is
+ * serialized against fuse_abort_conn() by the request's own waitq lock
+ * rather than by fc->lock.
  */
 static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
 {
 	int err = 0;
 	if (req) {
-		spin_lock(&fc->lock);
+		spin_lock(&req->waitq.lock);
 		if (req->aborted)
 			err = -ENOENT;
 		else
 			req->locked = 1;
-		spin_unlock(&fc->lock);
+		spin_unlock(&req->waitq.lock);
 	}
 	return err;
 }
@@ -524,11 +546,11 @@ static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
 static void unlock_request(struct fuse_conn *fc, struct fuse_req *req)
 {
 	if (req) {
-		spin_lock(&fc->lock);
+		spin_lock(&req->waitq.lock);
 		req->locked = 0;
 		if (req->aborted)
-			wake_up(&req->waitq);
-		spin_unlock(&fc->lock);
+			wake_up_locked(&req->waitq);
+		spin_unlock(&req->waitq.lock);
 	}
 }
 
@@ -758,12 +780,12 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 		lru_cache_add_file(newpage);
 
 	err = 0;
-	spin_lock(&cs->fc->lock);
+	spin_lock(&cs->req->waitq.lock);
 	if (cs->req->aborted)
 		err = -ENOENT;
 	else
 		*pagep = newpage;
-	spin_unlock(&cs->fc->lock);
+	spin_unlock(&cs->req->waitq.lock);
 
 	if (err) {
 		unlock_page(newpage);
@@ -924,8 +946,8 @@ static int request_pending(struct fuse_conn *fc)
 
 /* Wait until a request is available on the pending list */
 static void request_wait(struct fuse_conn *fc)
-__releases(fc->lock)
-__acquires(fc->lock)
+__releases(fc->iq_lock)
+__acquires(fc->iq_lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
 
@@ -935,9 +957,9 @@ __acquires(fc->lock)
 		if (signal_pending(current))
 			break;
 
-		spin_unlock(&fc->lock);
+		spin_unlock(&fc->iq_lock);
 		schedule();
-		spin_lock(&fc->lock);
+		spin_lock(&fc->iq_lock);
 	}
 	set_current_state(TASK_RUNNING);
 	remove_wait_queue(&fc->waitq, &wait);
@@ -949,11 +971,11 @@ __acquires(fc->lock)
  * Unlike other requests this is assembled on demand, without a need
  * to allocate a separate fuse_req structure.
  *
- * Called with fc->lock held, releases it
+ * Called with fc->iq_lock held, releases it
  */
 static int fuse_read_interrupt(struct fuse_conn *fc, struct fuse_copy_state *cs,
 			       size_t nbytes, struct fuse_req *req)
-__releases(fc->lock)
+__releases(fc->iq_lock)
 {
 	struct fuse_in_header ih;
 	struct fuse_interrupt_in arg;
@@ -969,7 +991,7 @@ __releases(fc->lock)
 	ih.unique = req->intr_unique;
 	arg.unique = req->in.h.unique;
 
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 	if (nbytes < reqsize)
 		return -EINVAL;
 
@@ -1006,7 +1028,7 @@ static struct fuse_forget_link *dequeue_forget(struct fuse_conn *fc,
 static int fuse_read_single_forget(struct fuse_conn *fc,
 				   struct fuse_copy_state *cs,
 				   size_t nbytes)
-__releases(fc->lock)
+__releases(fc->iq_lock)
 {
 	int err;
 	struct fuse_forget_link *forget = dequeue_forget(fc, 1, NULL);
@@ -1020,7 +1042,7 @@ __releases(fc->lock)
 		.len = sizeof(ih) + sizeof(arg),
 	};
 
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 	kfree(forget);
 	if (nbytes < ih.len)
 		return -EINVAL;
@@ -1038,7 +1060,7 @@ __releases(fc->lock)
 
 static int fuse_read_batch_forget(struct fuse_conn *fc,
 				   struct fuse_copy_state *cs, size_t nbytes)
-__releases(fc->lock)
+__releases(fc->iq_lock)
 {
 	int err;
 	unsigned max_forgets;
@@ -1052,13 +1074,13 @@ __releases(fc->lock)
 	};
 
 	if (nbytes < ih.len) {
-		spin_unlock(&fc->lock);
+		spin_unlock(&fc->iq_lock);
 		return -EINVAL;
 	}
 
 	max_forgets = (nbytes - ih.len) / sizeof(struct fuse_forget_one);
 	head = dequeue_forget(fc, max_forgets, &count);
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 
 	arg.count = count;
 	ih.len += count * sizeof(struct fuse_forget_one);
@@ -1087,7 +1109,7 @@ __releases(fc->lock)
 
 static int fuse_read_forget(struct fuse_conn *fc, struct fuse_copy_state *cs,
 			    size_t nbytes)
-__releases(fc->lock)
+__releases(fc->iq_lock)
 {
 	if (fc->minor < 16 || fc->forget_list_head.next->next == NULL)
 		return fuse_read_single_forget(fc, cs, nbytes);
@@ -1103,6 +1125,10 @@ __releases(fc->lock)
  * was an error during the copying then it's finished by calling
  * request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
+ *
+ * Waiting and taking the request off the pending list only needs
+ * fc->iq_lock; fc->lock is taken to put it on the io list, where
+ * fuse_abort_conn() can find it.
  */
 static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 				struct fuse_copy_state *cs, size_t nbytes)
@@ -1113,7 +1139,7 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	unsigned reqsize;
 
  restart:
-	spin_lock(&fc->lock);
+	spin_lock(&fc->iq_lock);
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
 	    !request_pending(fc))
@@ -1143,7 +1169,17 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 
 	req = list_entry(fc->pending.next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
-	list_move(&req->list, &fc->io);
+	list_del_init(&req->list);
+	spin_unlock(&fc->iq_lock);
+
+	spin_lock(&fc->lock);
+	if (!fc->connected) {
+		/* aborted while it was on neither list */
+		req->out.h.error = -ECONNABORTED;
+		request_end(fc, req);
+		return -ENODEV;
+	}
+	list_add(&req->list, &fc->io);
 
 	in = &req->in;
 	reqsize = in->h.len;
@@ -1163,8 +1199,8 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		err = fuse_copy_args(cs, in->numargs, in->argpages,
 				     (struct fuse_arg *) in->args, 0);
 	fuse_copy_finish(cs);
+	unlock_request(fc, req);
 	spin_lock(&fc->lock);
-	req->locked = 0;
 	if (req->aborted) {
 		request_end(fc, req);
 		return -ENODEV;
@@ -1178,7 +1214,8 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		request_end(fc, req);
 	else {
 		req->state = FUSE_REQ_SENT;
-		list_move_tail(&req->list, &fc->processing);
+		list_move_tail(&req->list, &fc->processing[
+			req->in.h.unique & (FUSE_PQ_HASH_SIZE - 1)]);
 		if (req->interrupted)
 			queue_interrupt(fc, req);
 		spin_unlock(&fc->lock);
@@ -1186,7 +1223,7 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	return reqsize;
 
  err_unlock:
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 	return err;
 }
 
@@ -1609,17 +1646,28 @@ static int fuse_notify(struct fuse_conn *fc, enum fuse_notify_code code,
 	}
 }
 
-/* Look up request on processing list by unique ID */
+/*
+ * Look up request on processing list by unique ID.  Requests are hashed
+ * by their own ID; replies to interrupts carry the interrupt's ID, so
+ * those fall back to searching every bucket.
+ */
 static struct fuse_req *request_find(struct fuse_conn *fc, u64 unique)
 {
-	struct list_head *entry;
+	struct fuse_req *req;
+	int i;
 
-	list_for_each(entry, &fc->processing) {
-		struct fuse_req *req;
-		req = list_entry(entry, struct fuse_req, list);
-		if (req->in.h.unique == unique || req->intr_unique == unique)
+	list_for_each_entry(req,
+			&fc->processing[unique & (FUSE_PQ_HASH_SIZE - 1)], list) {
+		if (req->in.h.unique == unique)
 			return req;
 	}
+
+	for (i = 0; i < FUSE_PQ_HASH_SIZE; i++) {
+		list_for_each_entry(req, &fc->processing[i], list) {
+			if (req->intr_unique == unique)
+				return req;
+		}
+	}
 	return NULL;
 }
 
@@ -1732,8 +1780,8 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	}
 	fuse_copy_finish(cs);
 
+	unlock_request(fc, req);
 	spin_lock(&fc->lock);
-	req->locked = 0;
 	if (!err) {
 		if (req->aborted)
 			err = -ENOENT;
@@ -1850,12 +1898,12 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &fc->waitq, wait);
 
-	spin_lock(&fc->lock);
+	spin_lock(&fc->iq_lock);
 	if (!fc->connected)
 		mask = POLLERR;
 	else if (request_pending(fc))
 		mask |= POLLIN | POLLRDNORM;
-	spin_unlock(&fc->lock);
+	spin_unlock(&fc->iq_lock);
 
 	return mask;
 }
@@ -1898,7 +1946,9 @@ __acquires(fc->lock)
 			list_entry(fc->io.next, struct fuse_req, list);
 		void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
 
+		spin_lock(&req->waitq.lock);
 		req->aborted = 1;
+		spin_unlock(&req->waitq.lock);
 		req->out.h.error = -ECONNABORTED;
 		req->state = FUSE_REQ_FINISHED;
 		list_del_init(&req->list);
@@ -1919,12 +1969,21 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	LIST_HEAD(pending);
+	int i;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
-	end_requests(fc, &fc->processing);
+
+	spin_lock(&fc->iq_lock);
+	list_splice_init(&fc->pending, &pending);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
+	spin_unlock(&fc->iq_lock);
+
+	end_requests(fc, &pending);
+	for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
+		end_requests(fc, &fc->processing[i]);
 }
 
 static void end_polls(struct fuse_conn *fc)
@@ -1970,7 +2029,10 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		end_io_requests(fc);
 		end_queued_requests(fc);
 		end_polls(fc);
+		/* under iq_lock, or request_wait() could miss it */
+		spin_lock(&fc->iq_lock);
 		wake_up_all(&fc->waitq);
+		spin_unlock(&fc->iq_lock);
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -186,6 +186,15 @@ void fuse_finish_open(struct inode *inode, struct file *file)
 		spin_unlock(&fc->lock);
 		fuse_invalidate_attr(inode);
 	}
+	if (fc->writeback_cache && (file->f_mode & FMODE_WRITE)) {
+		struct fuse_inode *fi = get_fuse_inode(inode);
+
+		/* dirty pages are written back through any writable file */
+		spin_lock(&fc->lock);
+		if (list_empty(&ff->write_entry))
+			list_add(&ff->write_entry, &fi->write_files);
+		spin_unlock(&fc->lock);
+	}
 }
 
 int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
@@ -322,7 +331,8 @@ static bool fuse_page_is_writeback(struct inode *inode, pgoff_t index)
 
 		BUG_ON(req->inode != inode);
 		curr_index = req->misc.write.in.offset >> PAGE_CACHE_SHIFT;
-		if (curr_index == index) {
+		if (curr_index <= index &&
+		    index < curr_index + req->num_pages) {
 			found = true;
 			break;
 		}
@@ -346,6 +356,8 @@ static int fuse_wait_on_page_writeback(struct inode *inode, pgoff_t index)
 	return 0;
 }
 
+static void fuse_sync_writes(struct inode *inode);
+
 static int fuse_flush(struct file *file, fl_owner_t id)
 {
 	struct inode *inode = file->f_path.dentry->d_inode;
@@ -358,6 +370,17 @@ static int fuse_flush(struct file *file, fl_owner_t id)
 	if (is_bad_inode(inode))
 		return -EIO;
 
+	if (fc->writeback_cache) {
+		/* the daemon has to see the data before the FLUSH */
+		err = filemap_write_and_wait(file->f_mapping);
+		if (err)
+			return err;
+
+		mutex_lock(&inode->i_mutex);
+		fuse_sync_writes(inode);
+		mutex_unlock(&inode->i_mutex);
+	}
+
 	if (fc->no_flush)
 		return 0;
 
@@ -507,6 +530,13 @@ static void fuse_read_update_size(struct inode *inode, loff_t size,
 	struct fuse_conn *fc = get_fuse_conn(inode);
 	struct fuse_inode *fi = get_fuse_inode(inode);
 
+	/*
+	 * With writeback caching the kernel's size is the one that counts,
+	 * the daemon may not have seen the dirty pages past its EOF yet.
+	 */
+	if (fc->writeback_cache)
+		return;
+
 	spin_lock(&fc->lock);
 	if (attr_ver == fi->attr_version && size < inode->i_size) {
 		fi->attr_version = ++fc->attr_version;
@@ -515,7 +545,7 @@ static void fuse_read_update_size(struct inode *inode, loff_t size,
 	spin_unlock(&fc->lock);
 }
 
-static int fuse_readpage(struct file *file, struct page *page)
+static int fuse_do_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct fuse_conn *fc = get_fuse_conn(inode);
@@ -526,10 +556,6 @@ static int fuse_readpage(struct file *file, struct page *page)
 	u64 attr_ver;
 	int err;
 
-	err = -EIO;
-	if (is_bad_inode(inode))
-		goto out;
-
 	/*
 	 * Page writeback can extend beyond the lifetime of the
 	 * page-cache page, so make sure we read a properly synced
@@ -538,9 +564,8 @@ static int fuse_readpage(struct file *file, struct page *page)
 	fuse_wait_on_page_writeback(inode, page->index);
 
 	req = fuse_get_req(fc);
-	err = PTR_ERR(req);
 	if (IS_ERR(req))
-		goto out;
+		return PTR_ERR(req);
 
 	attr_ver = fuse_get_attr_version(fc);
 
@@ -563,6 +588,19 @@ static int fuse_readpage(struct file *file, struct page *page)
 	}
 
 	fuse_invalidate_attr(inode); /* atime changed */
+	return err;
+}
+
+static int fuse_readpage(struct file *file, struct page *page)
+{
+	struct inode *inode = page->mapping->host;
+	int err;
+
+	err = -EIO;
+	if (is_bad_inode(inode))
+		goto out;
+
+	err = fuse_do_readpage(file, page);
  out:
 	unlock_page(page);
 	return err;
@@ -751,16 +789,49 @@ static size_t fuse_send_write(struct fuse_req *req, struct file *file,
 	return req->misc.write.out.size;
 }
 
+/*
+ * With writeback caching the page is written back later, so it has to
+ * be made uptodate here unless the write covers it or it lies past EOF.
+ */
 static int fuse_write_begin(struct file *file, struct address_space *mapping,
 			loff_t pos, unsigned len, unsigned flags,
 			struct page **pagep, void **fsdata)
 {
 	pgoff_t index = pos >> PAGE_CACHE_SHIFT;
+	struct fuse_conn *fc = get_fuse_conn(mapping->host);
+	struct page *page;
+	loff_t fsize;
+	int err;
 
-	*pagep = grab_cache_page_write_begin(mapping, index, flags);
-	if (!*pagep)
+	page = grab_cache_page_write_begin(mapping, index, flags);
+	if (!page)
 		return -ENOMEM;
-	return 0;
+	*pagep = page;
+
+	if (!fc->writeback_cache)
+		return 0;
+
+	fuse_wait_on_page_writeback(mapping->host, page->index);
+
+	if (PageUptodate(page) || len == PAGE_CACHE_SIZE)
+		return 0;
+
+	fsize = i_size_read(mapping->host);
+	if (fsize <= (pos & PAGE_CACHE_MASK)) {
+		size_t off = pos & ~PAGE_CACHE_MASK;
+
+		if (off)
+			zero_user_segment(page, 0, off);
+		return 0;
+	}
+
+	err = fuse_do_readpage(file, page);
+	if (err) {
+		unlock_page(page);
+		page_cache_release(page);
+		*pagep = NULL;
+	}
+	return err;
 }
 
 void fuse_write_update_size(struct inode *inode, loff_t pos)
@@ -823,7 +894,20 @@ static int fuse_write_end(struct file *file, struct address_space *mapping,
 	struct inode *inode = mapping->host;
 	int res = 0;
 
-	if (copied)
+	if (get_fuse_conn(inode)->writeback_cache) {
+		if (!PageUptodate(page)) {
+			/* zero whatever the copy didn't reach */
+			size_t endoff = (pos + copied) & ~PAGE_CACHE_MASK;
+
+			if (endoff)
+				zero_user_segment(page, endoff,
+						  PAGE_CACHE_SIZE);
+			SetPageUptodate(page);
+		}
+		fuse_write_update_size(inode, pos + copied);
+		set_page_dirty(page);
+		res = copied;
+	} else if (copied)
 		res = fuse_buffered_write(file, inode, pos, copied, page);
 
 	unlock_page(page);
@@ -995,6 +1079,16 @@ static ssize_t fuse_file_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	ssize_t written_buffered = 0;
 	loff_t endbyte = 0;
 
+	if (get_fuse_conn(inode)->writeback_cache &&
+	    !(file->f_flags & O_DIRECT)) {
+		/* O_APPEND needs an up to date size */
+		err = fuse_update_attributes(inode, NULL, file, NULL);
+		if (err)
+			return err;
+
+		return generic_file_aio_write(iocb, iov, nr_segs, pos);
+	}
+
 	WARN_ON(iocb->ki_pos != pos);
 
 	ocount = 0;
@@ -1230,7 +1324,10 @@ static ssize_t fuse_direct_write(struct file *file, const char __user *buf,
 
 static void fuse_writepage_free(struct fuse_conn *fc, struct fuse_req *req)
 {
-	__free_page(req->pages[0]);
+	int i;
+
+	for (i = 0; i < req->num_pages; i++)
+		__free_page(req->pages[i]);
 	fuse_file_put(req->ff, false);
 }
 
@@ -1290,11 +1387,14 @@ static void fuse_writepage_finish(struct fuse_conn *fc, struct fuse_req *req)
 	struct inode *inode = req->inode;
 	struct fuse_inode *fi = get_fuse_inode(inode);
 	struct backing_dev_info *bdi = inode->i_mapping->backing_dev_info;
+	int i;
 
 	list_del(&req->writepages_entry);
-	dec_bdi_stat(bdi, BDI_WRITEBACK);
-	dec_zone_page_state(req->pages[0], NR_WRITEBACK_TEMP);
-	bdi_writeout_inc(bdi);
+	for (i = 0; i < req->num_pages; i++) {
+		dec_bdi_stat(bdi, BDI_WRITEBACK);
+		dec_zone_page_state(req->pages[i], NR_WRITEBACK_TEMP);
+		bdi_writeout_inc(bdi);
+	}
 	wake_up(&fi->page_waitq);
 }
 
@@ -1306,14 +1406,15 @@ __acquires(fc->lock)
 	struct fuse_inode *fi = get_fuse_inode(req->inode);
 	loff_t size = i_size_read(req->inode);
 	struct fuse_write_in *inarg = &req->misc.write.in;
+	__u64 data_size = req->num_pages * PAGE_CACHE_SIZE;
 
 	if (!fc->connected)
 		goto out_free;
 
-	if (inarg->offset + PAGE_CACHE_SIZE <= size) {
-		inarg->size = PAGE_CACHE_SIZE;
+	if (inarg->offset + data_size <= size) {
+		inarg->size = data_size;
 	} else if (inarg->offset < size) {
-		inarg->size = size & (PAGE_CACHE_SIZE - 1);
+		inarg->size = size - inarg->offset;
 	} else {
 		/* Got truncated off completely */
 		goto out_free;
@@ -1433,6 +1534,132 @@ static int fuse_writepage(struct page *page, struct writeback_control *wbc)
 	return err;
 }
 
+struct fuse_fill_wb_data {
+	struct fuse_req *req;
+	struct fuse_file *ff;
+	struct inode *inode;
+	struct page *orig_pages[FUSE_MAX_PAGES_PER_REQ];
+};
+
+/*
+ * Queue a batched writepage request.  The original pages stay under
+ * writeback until the request is on fi->writepages, where
+ * fuse_page_is_writeback() can see it.
+ */
+static void fuse_writepages_send(struct fuse_fill_wb_data *data)
+{
+	struct fuse_req *req = data->req;
+	struct inode *inode = data->inode;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	int i, num_pages = req->num_pages;
+
+	req->ff = fuse_file_get(data->ff);
+	spin_lock(&fc->lock);
+	list_add(&req->writepages_entry, &fi->writepages);
+	list_add_tail(&req->list, &fi->queued_writes);
+	fuse_flush_writepages(inode);
+	spin_unlock(&fc->lock);
+
+	for (i = 0; i < num_pages; i++)
+		end_page_writeback(data->orig_pages[i]);
+	data->req = NULL;
+}
+
+static int fuse_writepages_fill(struct page *page,
+		struct writeback_control *wbc, void *_data)
+{
+	struct fuse_fill_wb_data *data = _data;
+	struct fuse_req *req = data->req;
+	struct inode *inode = data->inode;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct page *tmp_page;
+
+	if (req && (req->num_pages == FUSE_MAX_PAGES_PER_REQ ||
+		    (req->num_pages + 1) * PAGE_CACHE_SIZE > fc->max_write ||
+		    data->orig_pages[req->num_pages - 1]->index + 1 !=
+		    page->index)) {
+		fuse_writepages_send(data);
+		req = NULL;
+	}
+
+	tmp_page = alloc_page(GFP_NOFS | __GFP_HIGHMEM);
+	if (!tmp_page)
+		goto err;
+
+	if (!req) {
+		req = fuse_request_alloc_nofs();
+		if (!req) {
+			__free_page(tmp_page);
+			goto err;
+		}
+
+		fuse_write_fill(req, data->ff, page_offset(page), 0);
+		req->misc.write.in.write_flags |= FUSE_WRITE_CACHE;
+		req->in.argpages = 1;
+		req->page_offset = 0;
+		req->end = fuse_writepage_end;
+		req->inode = inode;
+		data->req = req;
+	}
+
+	set_page_writeback(page);
+	copy_highpage(tmp_page, page);
+	data->orig_pages[req->num_pages] = page;
+	req->pages[req->num_pages++] = tmp_page;
+
+	inc_bdi_stat(page->mapping->backing_dev_info, BDI_WRITEBACK);
+	inc_zone_page_state(tmp_page, NR_WRITEBACK_TEMP);
+
+	unlock_page(page);
+	return 0;
+
+err:
+	redirty_page_for_writepage(wbc, page);
+	unlock_page(page);
+	return -ENOMEM;
+}
+
+/*
+ * With writeback caching, write back runs of contiguous dirty pages as
+ * one WRITE of up to max_write bytes, instead of one request per page.
+ * Shared writable mmaps without it keep going through ->writepage.
+ */
+static int fuse_writepages(struct address_space *mapping,
+			   struct writeback_control *wbc)
+{
+	struct inode *inode = mapping->host;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_fill_wb_data data;
+	int err;
+
+	if (is_bad_inode(inode))
+		return -EIO;
+
+	if (!fc->writeback_cache)
+		return generic_writepages(mapping, wbc);
+
+	data.inode = inode;
+	data.req = NULL;
+	data.ff = NULL;
+
+	spin_lock(&fc->lock);
+	if (!list_empty(&fi->write_files))
+		data.ff = fuse_file_get(list_entry(fi->write_files.next,
+					struct fuse_file, write_entry));
+	spin_unlock(&fc->lock);
+	if (!data.ff)
+		return generic_writepages(mapping, wbc);
+
+	err = write_cache_pages(mapping, wbc, fuse_writepages_fill, &data);
+	if (data.req)
+		fuse_writepages_send(&data);
+
+	fuse_file_put(data.ff, false);
+	return err;
+}
+
 static int fuse_launder_page(struct page *page)
 {
 	int err = 0;
@@ -1478,6 +1705,9 @@ static int fuse_page_mkwrite(struct vm_area_struct *vma, struct vm_fault *vmf)
 	 */
 	struct inode *inode = vma->vm_file->f_mapping->host;
 
+	/* pages of a writepages batch not yet queued are under writeback */
+	if (get_fuse_conn(inode)->writeback_cache)
+		wait_on_page_writeback(page);
 	fuse_wait_on_page_writeback(inode, page->index);
 	return 0;
 }
@@ -2296,6 +2526,7 @@ static const struct file_operations fuse_direct_io_file_operations = {
 static const struct address_space_operations fuse_file_aops  = {
 	.readpage	= fuse_readpage,
 	.writepage	= fuse_writepage,
+	.writepages	= fuse_writepages,
 	.launder_page	= fuse_launder_page,
 	.write_begin	= fuse_write_begin,
 	.write_end	= fuse_write_end,
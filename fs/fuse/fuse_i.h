@@ -197,6 +197,10 @@ struct fuse_out {
 	struct fuse_arg args[3];
 };
 
+/** Number of hash buckets for requests being processed */
+#define FUSE_PQ_HASH_BITS 8
+#define FUSE_PQ_HASH_SIZE (1 << FUSE_PQ_HASH_BITS)
+
 /** The request state */
 enum fuse_req_state {
 	FUSE_REQ_INIT = 0,
@@ -236,21 +240,28 @@ struct fuse_req {
 	/** Force sending of the request even if interrupted */
 	unsigned force:1;
 
-	/** The request was aborted */
-	unsigned aborted:1;
-
 	/** Request is sent in the background */
 	unsigned background:1;
 
 	/** The request has been interrupted */
 	unsigned interrupted:1;
 
-	/** Data is being copied to/from the request */
-	unsigned locked:1;
-
 	/** Request is counted as "waiting" */
 	unsigned waiting:1;
 
+	/*
+	 * The following two are handed between the thread copying the
+	 * request and fuse_abort_conn() under waitq.lock, so they must not
+	 * share a word with the bitfields above.  aborted is set with
+	 * fuse_conn->lock held as well.
+	 */
+
+	/** The request was aborted */
+	bool aborted;
+
+	/** Data is being copied to/from the request */
+	bool locked;
+
 	/** State of the request */
 	enum fuse_req_state state;
 
@@ -326,6 +337,11 @@ struct fuse_conn {
 	/** Lock protecting accessess to  members of this structure */
 	spinlock_t lock;
 
+	/** Lock protecting the input queue: the pending list,
+	    interrupts, forgets and the request ID counter.  Nests
+	    inside lock, never the other way round */
+	spinlock_t iq_lock;
+
 	/** Mutex protecting against directory alias creation */
 	struct mutex inst_mutex;
 
@@ -353,8 +369,8 @@ struct fuse_conn {
 	/** The list of pending requests */
 	struct list_head pending;
 
-	/** The list of requests being processed */
-	struct list_head processing;
+	/** Requests being processed, hashed by unique ID */
+	struct list_head processing[FUSE_PQ_HASH_SIZE];
 
 	/** The list of requests under I/O */
 	struct list_head io;
@@ -478,6 +494,9 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Kernel owns i_size and buffers writes in the page cache */
+	unsigned writeback_cache:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -1856,7 +1856,7 @@ out:
 	return ~0U;
 }
 
-#define PROC_FDINFO_MAX 64
+#define PROC_FDINFO_MAX 192
 
 static int proc_fd_info(struct inode *inode, struct path *path, char *info)
 {
@@ -1892,9 +1892,17 @@ static int proc_fd_info(struct inode *inode, struct path *path, char *info)
 			if (info)
 				snprintf(info, PROC_FDINFO_MAX,
 					 "pos:\t%lli\n"
-					 "flags:\t0%o\n",
+					 "flags:\t0%o\n"
+					 "ra_pattern:\t%d\n"
+					 "ra_window:\t%u\n"
+					 "ra_read:\t%lu\n"
+					 "ra_used:\t%lu\n",
 					 (long long) file->f_pos,
-					 f_flags);
+					 f_flags,
+					 file->f_ra.pattern,
+					 file->f_ra.size,
+					 file->f_ra.ra_read,
+					 file->f_ra.ra_used);
 			spin_unlock(&files->file_lock);
 			put_files_struct(files);
 			return 0;
@@ -0,0 +1,61 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * decompressor_single.c
+ */
+
+#include <linux/types.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/buffer_head.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "decompressor.h"
+#include "squashfs.h"
+
+/*
+ * This file implements single-threaded decompression in the
+ * decompressor framework: one stream per filesystem, serialised by
+ * read_data_mutex.
+ */
+
+void *squashfs_decompressor_create(struct squashfs_sb_info *msblk,
+	void *buff, int len)
+{
+	return msblk->decompressor->init(msblk, buff, len);
+}
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	if (msblk->decompressor && msblk->stream)
+		msblk->decompressor->free(msblk->stream);
+}
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	int res;
+
+	mutex_lock(&msblk->read_data_mutex);
+	res = msblk->decompressor->decompress(msblk, msblk->stream, buffer, bh,
+		b, offset, length, srclength, pages);
+	mutex_unlock(&msblk->read_data_mutex);
+
+	return res;
+}
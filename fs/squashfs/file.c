@@ -409,6 +409,14 @@ static int squashfs_readpage(struct file *file, struct page *page)
 				 msblk->block_size;
 			sparse = 1;
 		} else {
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+			int res = squashfs_readpage_block(page, block, bsize);
+
+			if (res == 0)
+				return 0;
+			if (res != -EAGAIN)
+				goto error_out;
+#endif
 			/*
 			 * Read and decompress datablock.
 			 */
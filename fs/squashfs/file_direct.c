@@ -0,0 +1,121 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * file_direct.c
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/mm.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Read a datablock by decompressing it straight into the page cache
+ * pages it covers, rather than into the read_page cache and copying.
+ * This drops the copy and, more importantly, the single read_page
+ * entry every datablock read otherwise queues on.
+ *
+ * Returns 0 with target_page uptodate and unlocked, -EAGAIN if the
+ * caller should go through the cache instead (some other page of the
+ * block is locked or highmem), or another error with target_page still
+ * locked.
+ */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, bytes, res = -ENOMEM;
+	struct page **page;
+	void **pageaddr;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+
+	page = kcalloc(pages, sizeof(*page), GFP_KERNEL);
+	pageaddr = kmalloc(pages * sizeof(*pageaddr), GFP_KERNEL);
+	if (page == NULL || pageaddr == NULL)
+		goto out;
+
+	/*
+	 * Grab the other pages of the block.  The decompressors write
+	 * through plain kernel addresses, so highmem pages can't be used.
+	 */
+	for (i = 0, n = start_index; n <= end_index; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+		if (page[i] == NULL || PageHighMem(page[i])) {
+			res = -EAGAIN;
+			goto release_pages;
+		}
+		pageaddr[i] = page_address(page[i]);
+	}
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		msblk->block_size, pages);
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		goto release_pages;
+	}
+
+	/* zero whatever the block didn't fill */
+	for (i = res >> PAGE_CACHE_SHIFT; i < pages; i++) {
+		bytes = (i == res >> PAGE_CACHE_SHIFT) ?
+			res & (PAGE_CACHE_SIZE - 1) : 0;
+		memset(pageaddr[i] + bytes, 0, PAGE_CACHE_SIZE - bytes);
+	}
+
+	for (i = 0; i < pages; i++) {
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(pageaddr);
+	kfree(page);
+	return 0;
+
+release_pages:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			break;
+		if (page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+out:
+	kfree(pageaddr);
+	kfree(page);
+	return res;
+}
@@ -13,6 +13,9 @@ struct firmware {
 	size_t size;
 	const u8 *data;
 	struct page **pages;
+
+	/* firmware loader private: cache entry holding the image */
+	void *priv;
 };
 
 struct device;
@@ -989,8 +989,38 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	pgoff_t prev_fault;		/* Last mmap miss, for stride detection */
+	long stride;			/* Distance between the last two mmap misses */
+	int pattern;			/* Access history, see RA_PATTERN_MAX */
+	unsigned long ra_read;		/* Pages submitted by readahead */
+	unsigned long ra_used;		/* ... in windows the reader got to */
 };
 
+/*
+ * ->pattern is a saturating score of recent accesses, between
+ * -RA_PATTERN_MAX and RA_PATTERN_MAX: sequential and constant-stride ones
+ * pull it down, random ones push it up.  Readahead grows its first window
+ * for files at or below RA_PATTERN_SEQ and only reads what was asked for
+ * at or above RA_PATTERN_RANDOM.  Zero is neutral, so a file_ra_state
+ * that was only zeroed, not set up by file_ra_state_init(), has no bias.
+ */
+#define RA_PATTERN_MAX		4
+#define RA_PATTERN_SEQ		(-2)
+#define RA_PATTERN_RANDOM	2
+
+static inline void ra_pattern_sequential(struct file_ra_state *ra)
+{
+	if (ra->pattern > -RA_PATTERN_MAX)
+		ra->pattern--;
+}
+
+static inline void ra_pattern_random(struct file_ra_state *ra)
+{
+	if (ra->pattern < RA_PATTERN_MAX)
+		ra->pattern++;
+}
+
 /*
  * Check if @index falls in the readahead windows.
  */
@@ -0,0 +1,101 @@
+/*
+ * include/linux/hisi_om_logring.h
+ *
+ * Copyright (c) 2008-2011, Hisilicon Tech. Co., Ltd. All rights reserved.
+ *
+ * Layout of the modem OM log ring in core share memory and the ioctl
+ * interface of /dev/om_logring. The modem writes records into the ring,
+ * the logging daemon maps it read-only and returns consumed space with
+ * OM_LOGRING_IOC_CONSUME. The modem keeps its own copy of the layout,
+ * keep both in step.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_HISI_OM_LOGRING_H
+#define _LINUX_HISI_OM_LOGRING_H
+
+#include <linux/types.h>
+#include <asm/ioctl.h>
+
+#define OM_LOGRING_MAGIC		0x474c4d4f	/* "OMLG" */
+#define OM_LOGRING_VERSION		1
+
+/* the data area starts one page into the region */
+#define OM_LOGRING_DATA_OFFSET		0x1000
+
+#define OM_LOGRING_REC_ALIGN		4
+#define OM_LOGRING_REC_PAD		0xffff	/* skip to the start of the data area */
+
+/*
+ * Control page at the start of the region. head, tail and the sequence
+ * numbers are free running byte and record counts, the position in the
+ * data area is (count & (data_size - 1)).
+ *
+ * Producer (modem) side:
+ *  - a record never wraps, if it does not fit before the end of the data
+ *    area a PAD record fills the rest and the record starts over at 0;
+ *  - when there is no room between head and tail the record is dropped,
+ *    dropped is bumped and seq still advances, so readers see the gap;
+ *  - after head is published, if wake_armed is set and head - tail has
+ *    reached wake_mark, clear wake_armed and raise
+ *    IPC_ACPU_INT_SRC_CCPU_OM_LOG. A flush timer on the modem does the
+ *    same for a partly filled ring so slow traffic is not held back.
+ *
+ * The consumer fields are written by the kernel only, on behalf of the
+ * daemon (OM_LOGRING_IOC_CONSUME).
+ */
+struct om_logring_ctrl {
+	__u32 magic;		/* written last by the modem once set up */
+	__u32 version;
+	__u32 data_size;	/* power of two */
+	__u32 rsv0;
+
+	/* producer, modem */
+	__u32 head;
+	__u32 seq;		/* seq of the next record */
+	__u32 dropped;		/* records dropped on a full ring */
+	__u32 rsv1;
+
+	/* consumer, a core */
+	__u32 tail;
+	__u32 wake_mark;
+	__u32 wake_armed;
+	__u32 rsv2;
+};
+
+struct om_logring_rec {
+	__u32 seq;
+	__u16 len;		/* payload bytes, not counting this header */
+	__u16 type;
+	__u32 slice;		/* modem timestamp */
+	/* payload, padded to OM_LOGRING_REC_ALIGN */
+};
+
+struct om_logring_consume {
+	__u32 tail;		/* new tail, between the old tail and head */
+	__u32 wake_mark;	/* ring the doorbell at this fill, 0: do not arm */
+};
+
+struct om_logring_stat {
+	__u32 head;
+	__u32 tail;
+	__u32 seq;
+	__u32 dropped;
+	__u32 doorbells;
+	__u32 resets;		/* modem resets since boot, ring restarted */
+};
+
+#define OM_LOGRING_IOC_MAGIC		'O'
+#define OM_LOGRING_IOC_SET_EVENTFD	_IOW(OM_LOGRING_IOC_MAGIC, 1, int)
+#define OM_LOGRING_IOC_CONSUME		_IOW(OM_LOGRING_IOC_MAGIC, 2, struct om_logring_consume)
+#define OM_LOGRING_IOC_GET_STAT		_IOR(OM_LOGRING_IOC_MAGIC, 3, struct om_logring_stat)
+
+#endif /* _LINUX_HISI_OM_LOGRING_H */
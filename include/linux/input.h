@@ -99,6 +99,27 @@ struct input_keymap_entry {
 	__u8  scancode[32];
 };
 
+/**
+ * struct input_ring - header of an evdev client ring mapped with mmap()
+ * @head: free running count of events written, updated by the kernel
+ *	at the end of every packet (SYN_REPORT)
+ * @tail: free running count of events consumed, updated by the reader
+ * @size: number of events in the ring, a power of two
+ * @dropped: packets dropped because the ring was full
+ *
+ * The header sits at the start of the mapping and the events start one
+ * page in, event n is at (n & (size - 1)). Once a client has mapped its
+ * ring, events are no longer queued for read(); a dropped packet is only
+ * reported through @dropped, the reader should then resync device state
+ * as it would after SYN_DROPPED.
+ */
+struct input_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 dropped;
+};
+
 #define EVIOCGVERSION		_IOR('E', 0x01, int)			/* get driver version */
 #define EVIOCGID		_IOR('E', 0x02, struct input_id)	/* get device ID */
 #define EVIOCGREP		_IOR('E', 0x03, unsigned int[2])	/* get repeat settings */
@@ -158,6 +179,7 @@ struct input_keymap_entry {
 #define EVIOCSSUSPENDBLOCK	_IOW('E', 0x91, int)			/* set suspend block enable */
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
+#define EVIOCSBATCH		_IOW('E', 0xa1, int)			/* Set wakeup batching interval in ms */
 
 /*
  * Device properties and quirks
@@ -153,6 +153,7 @@ static inline void mem_cgroup_dec_page_stat(struct page *page,
 unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 						gfp_t gfp_mask,
 						unsigned long *total_scanned);
+unsigned long mem_cgroup_mm_soft_limit_excess(struct mm_struct *mm);
 u64 mem_cgroup_get_limit(struct mem_cgroup *mem);
 
 void mem_cgroup_count_vm_event(struct mm_struct *mm, enum vm_event_item idx);
@@ -358,6 +359,12 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 	return 0;
 }
 
+static inline
+unsigned long mem_cgroup_mm_soft_limit_excess(struct mm_struct *mm)
+{
+	return 0;
+}
+
 static inline
 u64 mem_cgroup_get_limit(struct mem_cgroup *mem)
 {
@@ -215,6 +215,9 @@ struct per_cpu_pages {
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
 	int batch;		/* chunk size for buddy add/remove */
+	int base_high;		/* high and batch as configured, */
+	int base_batch;		/* before adapting to the load */
+	unsigned long adapt_stamp;	/* jiffies of the last refill */
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
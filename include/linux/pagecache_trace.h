@@ -0,0 +1,33 @@
+#ifndef _LINUX_PAGECACHE_TRACE_H
+#define _LINUX_PAGECACHE_TRACE_H
+
+#include <linux/fs.h>
+
+#ifdef CONFIG_PAGECACHE_TRACE
+
+extern int pagecache_trace_active;
+
+extern void __pagecache_trace_miss(struct file *filp, pgoff_t index,
+				   unsigned long span, unsigned long nr);
+
+/*
+ * Called when @nr pages within [@index, @index + @span) of @filp had to be
+ * read from disk.  A single flag test unless a trace window is open.
+ */
+static inline void pagecache_trace_miss(struct file *filp, pgoff_t index,
+					unsigned long span, unsigned long nr)
+{
+	if (unlikely(pagecache_trace_active) && filp)
+		__pagecache_trace_miss(filp, index, span, nr);
+}
+
+#else
+
+static inline void pagecache_trace_miss(struct file *filp, pgoff_t index,
+					unsigned long span, unsigned long nr)
+{
+}
+
+#endif /* CONFIG_PAGECACHE_TRACE */
+
+#endif /* _LINUX_PAGECACHE_TRACE_H */
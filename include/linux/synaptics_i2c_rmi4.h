@@ -84,6 +84,7 @@ struct synaptics_rmi4 {
 	struct block_config *gpio_block_config;
 
 	bool use_irq;
+	ktime_t irq_time;	/* hard irq timestamp, passed on to evdev */
 
 	unsigned char data_reg;
 	unsigned char data_length;
@@ -154,7 +154,8 @@ struct sync_pt {
  * @status:		1: signaled, 0:active, <0: error
  *
  * @wq:			wait queue for fence signaling
- * @sync_fence_list:	membership in global fence list
+ * @timestamp:		time the fence was created, for lifetime statistics
+ * @sync_fence_list:	membership in one of the hashed global fence lists
  */
 struct sync_fence {
 	struct file		*file;
@@ -170,7 +171,9 @@ struct sync_fence {
 
 	wait_queue_head_t	wq;
 
-	struct list_head	sync_fence_list;
+	ktime_t			timestamp;
+
+	struct hlist_node	sync_fence_list;
 };
 
 struct sync_fence_waiter;
@@ -271,8 +274,9 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt);
  * @a:		fence a
  * @b:		fence b
  *
- * Creates a new fence which contains copies of all the sync_pts in both
- * @a and @b.  @a and @b remain valid, independent fences.
+ * Creates a new fence which contains copies of the unsignaled sync_pts in
+ * both @a and @b.  Only the last sync_pt of each sync_timeline is kept.
+ * @a and @b remain valid, independent fences.
  */
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b);
@@ -21,6 +21,8 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 enum freezer_state {
 	CGROUP_THAWED = 0,
@@ -28,10 +30,31 @@ enum freezer_state {
 	CGROUP_FROZEN,
 };
 
+/* freeze/thaw latency accounting, protected by freezer->lock */
+struct freezer_stats {
+	unsigned int nr_freeze;
+	unsigned int nr_thaw;
+	u64 last_freeze_ns;
+	u64 max_freeze_ns;
+	u64 total_freeze_ns;
+	u64 last_thaw_ns;
+	u64 max_thaw_ns;
+};
+
 struct freezer {
 	struct cgroup_subsys_state css;
 	enum freezer_state state;
 	spinlock_t lock; /* protects _writes_ to state */
+
+	/*
+	 * Tasks that entered the refrigerator since the last freeze
+	 * request; reset on thaw.  Lets the FREEZING -> FROZEN
+	 * transition happen without walking the cgroup's tasks.
+	 */
+	unsigned int nr_frozen;
+
+	ktime_t freeze_start;
+	struct freezer_stats stats;
 };
 
 static inline struct freezer *cgroup_freezer(
@@ -61,6 +84,52 @@ bool cgroup_freezing(struct task_struct *task)
 	return ret;
 }
 
+/*
+ * caller must hold freezer->lock
+ */
+static void freezer_mark_frozen(struct freezer *freezer)
+{
+	u64 delta = ktime_to_ns(ktime_sub(ktime_get(), freezer->freeze_start));
+
+	freezer->state = CGROUP_FROZEN;
+	freezer->stats.nr_freeze++;
+	freezer->stats.last_freeze_ns = delta;
+	freezer->stats.total_freeze_ns += delta;
+	if (delta > freezer->stats.max_freeze_ns)
+		freezer->stats.max_freeze_ns = delta;
+}
+
+/**
+ * cgroup_freezer_frozen - account a task entering the refrigerator
+ * @task: the task, which must be current
+ *
+ * Called once per refrigerator entry.  When the last task of a
+ * FREEZING cgroup arrives the cgroup is moved to FROZEN here, so the
+ * state is up to date without userspace having to poll freezer.state.
+ * Tasks that are merely stopped or traced are not seen here; those
+ * cgroups still go through update_if_frozen().
+ */
+void cgroup_freezer_frozen(struct task_struct *task)
+{
+	struct freezer *freezer;
+	unsigned long flags;
+
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	if (!freezer->css.cgroup->parent)
+		goto out;
+
+	spin_lock_irqsave(&freezer->lock, flags);
+	if (freezer->state == CGROUP_FREEZING) {
+		freezer->nr_frozen++;
+		if (freezer->nr_frozen >= cgroup_task_count(freezer->css.cgroup))
+			freezer_mark_frozen(freezer);
+	}
+	spin_unlock_irqrestore(&freezer->lock, flags);
+out:
+	rcu_read_unlock();
+}
+
 /*
  * cgroups_write_string() limits the size of freezer state strings to
  * CGROUP_LOCAL_BUFFER_SIZE
@@ -104,6 +173,10 @@ struct cgroup_subsys freezer_subsys;
  * freezer->lock
  *  sighand->siglock (if the cgroup is freezing)
  *
+ * cgroup_freezer_frozen() (from the refrigerator):
+ * freezer->lock
+ *  read_lock css_set_lock (cgroup_task_count)
+ *
  * freezer_read():
  * cgroup_mutex
  *  freezer->lock
@@ -228,6 +301,18 @@ static void update_if_frozen(struct cgroup *cgroup,
 	unsigned int nfrozen = 0, ntotal = 0;
 	enum freezer_state old_state = freezer->state;
 
+	/*
+	 * Only FREEZING needs a verdict, and the refrigerator count
+	 * settles it unless some tasks are stopped or traced rather
+	 * than frozen.
+	 */
+	if (old_state != CGROUP_FREEZING)
+		return;
+	if (freezer->nr_frozen >= cgroup_task_count(cgroup)) {
+		freezer_mark_frozen(freezer);
+		return;
+	}
+
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it))) {
 		ntotal++;
@@ -235,14 +320,8 @@ static void update_if_frozen(struct cgroup *cgroup,
 			nfrozen++;
 	}
 
-	if (old_state == CGROUP_THAWED) {
-		BUG_ON(nfrozen > 0);
-	} else if (old_state == CGROUP_FREEZING) {
-		if (nfrozen == ntotal)
-			freezer->state = CGROUP_FROZEN;
-	} else { /* old_state == CGROUP_FROZEN */
-		BUG_ON(nfrozen != ntotal);
-	}
+	if (nfrozen == ntotal)
+		freezer_mark_frozen(freezer);
 
 	cgroup_iter_end(cgroup, &it);
 }
@@ -297,11 +376,24 @@ static void unfreeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 {
 	struct cgroup_iter it;
 	struct task_struct *task;
+	ktime_t start = ktime_get();
+	u64 delta;
 
+	/*
+	 * __thaw_task() only queues a wakeup, so every task becomes
+	 * runnable in this single pass and they leave the refrigerator
+	 * in parallel on whatever CPUs the scheduler picks.
+	 */
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it)))
 		__thaw_task(task);
 	cgroup_iter_end(cgroup, &it);
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	freezer->stats.nr_thaw++;
+	freezer->stats.last_thaw_ns = delta;
+	if (delta > freezer->stats.max_thaw_ns)
+		freezer->stats.max_thaw_ns = delta;
 }
 
 static int freezer_change_state(struct cgroup *cgroup,
@@ -318,16 +410,26 @@ static int freezer_change_state(struct cgroup *cgroup,
 
 	switch (goal_state) {
 	case CGROUP_THAWED:
-		if (freezer->state != CGROUP_THAWED)
-			atomic_dec(&system_freezing_cnt);
+		if (freezer->state == CGROUP_THAWED)
+			break;
+		atomic_dec(&system_freezing_cnt);
 		freezer->state = CGROUP_THAWED;
+		freezer->nr_frozen = 0;
 		unfreeze_cgroup(cgroup, freezer);
 		break;
 	case CGROUP_FROZEN:
-		if (freezer->state == CGROUP_THAWED)
-			atomic_inc(&system_freezing_cnt);
+		if (freezer->state != CGROUP_THAWED) {
+			/* already FROZEN, or kick the stragglers again */
+			if (freezer->state == CGROUP_FREEZING)
+				retval = try_to_freeze_cgroup(cgroup, freezer);
+			break;
+		}
+		atomic_inc(&system_freezing_cnt);
+		freezer->freeze_start = ktime_get();
 		freezer->state = CGROUP_FREEZING;
 		retval = try_to_freeze_cgroup(cgroup, freezer);
+		if (!retval)
+			update_if_frozen(cgroup, freezer);
 		break;
 	default:
 		BUG();
@@ -359,12 +461,44 @@ static int freezer_write(struct cgroup *cgroup,
 	return retval;
 }
 
+static int freezer_stats_read(struct cgroup *cgroup, struct cftype *cft,
+			      struct seq_file *m)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_stats st;
+	unsigned int nr_frozen;
+
+	spin_lock_irq(&freezer->lock);
+	st = freezer->stats;
+	nr_frozen = freezer->nr_frozen;
+	spin_unlock_irq(&freezer->lock);
+
+	seq_printf(m, "freeze_count %u\n", st.nr_freeze);
+	seq_printf(m, "freeze_last_us %llu\n",
+		   (unsigned long long)div_u64(st.last_freeze_ns, 1000));
+	seq_printf(m, "freeze_max_us %llu\n",
+		   (unsigned long long)div_u64(st.max_freeze_ns, 1000));
+	seq_printf(m, "freeze_total_us %llu\n",
+		   (unsigned long long)div_u64(st.total_freeze_ns, 1000));
+	seq_printf(m, "thaw_count %u\n", st.nr_thaw);
+	seq_printf(m, "thaw_last_us %llu\n",
+		   (unsigned long long)div_u64(st.last_thaw_ns, 1000));
+	seq_printf(m, "thaw_max_us %llu\n",
+		   (unsigned long long)div_u64(st.max_thaw_ns, 1000));
+	seq_printf(m, "nr_frozen %u\n", nr_frozen);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
 	},
+	{
+		.name = "stats",
+		.read_seq_string = freezer_stats_read,
+	},
 };
 
 static int freezer_populate(struct cgroup_subsys *ss, struct cgroup *cgroup)
@@ -61,6 +61,9 @@
 #include <linux/nsproxy.h>
 #include <linux/ptrace.h>
 #include <linux/hugetlb.h>
+#include <linux/bootmem.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/futex.h>
 
@@ -68,7 +71,12 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
+/*
+ * The hash table is sized at boot: 256 buckets per possible CPU
+ * (16 with CONFIG_BASE_SMALL), capped by alloc_large_system_hash()
+ * to a sane fraction of memory.
+ */
+#define FUTEX_HASH_PER_CPU (CONFIG_BASE_SMALL ? 16 : 256)
 
 /*
  * Futex flags used to encode options to functions and preserve them across
@@ -147,19 +155,48 @@ static const struct futex_q futex_q_init = {
 struct futex_hash_bucket {
 	spinlock_t lock;
 	struct plist_head chain;
+} ____cacheline_aligned_in_smp;
+
+static struct futex_hash_bucket *futex_queues __read_mostly;
+static unsigned int futex_hashmask __read_mostly;
+
+/*
+ * Contention statistics, exported through debugfs.
+ */
+struct futex_stats {
+	unsigned long wait;		/* futex_wait() calls */
+	unsigned long wait_sleep;	/* ... that went to sleep */
+	unsigned long wake;		/* futex_wake() calls */
+	unsigned long requeue;		/* futex_requeue() calls */
+	unsigned long hb_lock;		/* hash bucket lock acquisitions */
+	unsigned long hb_contended;	/* ... that had to wait */
 };
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static DEFINE_PER_CPU(struct futex_stats, futex_stats);
+
+#define futex_stat_inc(field)	this_cpu_inc(futex_stats.field)
 
 /*
- * We hash on the keys returned from get_futex_key (see below).
+ * We hash on the keys returned from get_futex_key (see below).  Private
+ * keys include the mm, so different processes using the same address
+ * land in different buckets.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+	return &futex_queues[hash & futex_hashmask];
+}
+
+static inline void futex_hb_lock(struct futex_hash_bucket *hb)
+	__acquires(&hb->lock)
+{
+	futex_stat_inc(hb_lock);
+	if (unlikely(!spin_trylock(&hb->lock))) {
+		futex_stat_inc(hb_contended);
+		spin_lock(&hb->lock);
+	}
 }
 
 /*
@@ -993,8 +1030,9 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	if (unlikely(ret != 0))
 		goto out;
 
+	futex_stat_inc(wake);
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 	head = &hb->chain;
 
 	plist_for_each_entry_safe(this, next, head, list) {
@@ -1270,6 +1308,8 @@ static int futex_requeue(u32 __user *uaddr1, unsigned int flags,
 	struct futex_q *this, *next;
 	u32 curval2;
 
+	futex_stat_inc(requeue);
+
 	if (requeue_pi) {
 		/*
 		 * Requeue PI only works on two distinct uaddrs. This
@@ -1501,7 +1541,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	hb = hash_futex(&q->key);
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 	return hb;
 }
 
@@ -1927,6 +1967,8 @@ static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 					     current->timer_slack_ns);
 	}
 
+	futex_stat_inc(wait);
+
 retry:
 	/*
 	 * Prepare to wait on uaddr. On success, holds hb lock and increments
@@ -1937,6 +1979,7 @@ retry:
 		goto out;
 
 	/* queue_me and wait for wakeup, timeout, or a signal. */
+	futex_stat_inc(wait_sleep);
 	futex_wait_queue_me(hb, &q, to);
 
 	/* If we were woken (and unqueued), we succeeded, whatever. */
@@ -2144,7 +2187,7 @@ retry:
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	futex_hb_lock(hb);
 
 	/*
 	 * To avoid races, try to do the TID -> 0 atomic transition
@@ -2765,10 +2808,63 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 	return do_futex(uaddr, op, val, tp, uaddr2, val2, val3);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int futex_stats_show(struct seq_file *m, void *v)
+{
+	struct futex_stats sum = { 0 };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct futex_stats *st = &per_cpu(futex_stats, cpu);
+
+		sum.wait += st->wait;
+		sum.wait_sleep += st->wait_sleep;
+		sum.wake += st->wake;
+		sum.requeue += st->requeue;
+		sum.hb_lock += st->hb_lock;
+		sum.hb_contended += st->hb_contended;
+	}
+
+	seq_printf(m, "hash_buckets %u\n", futex_hashmask + 1);
+	seq_printf(m, "wait %lu\n", sum.wait);
+	seq_printf(m, "wait_sleep %lu\n", sum.wait_sleep);
+	seq_printf(m, "wake %lu\n", sum.wake);
+	seq_printf(m, "requeue %lu\n", sum.requeue);
+	seq_printf(m, "hb_lock %lu\n", sum.hb_lock);
+	seq_printf(m, "hb_contended %lu\n", sum.hb_contended);
+	return 0;
+}
+
+static int futex_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_stats_show, NULL);
+}
+
+static const struct file_operations futex_stats_fops = {
+	.open		= futex_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init futex_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("futex", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_file("stats", S_IRUGO, dir, NULL, &futex_stats_fops);
+	return 0;
+}
+late_initcall(futex_debugfs_init);
+#endif
+
 static int __init futex_init(void)
 {
+	unsigned int futex_shift;
+	unsigned long i;
 	u32 curval;
-	int i;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2783,7 +2879,14 @@ static int __init futex_init(void)
 	if (cmpxchg_futex_value_locked(&curval, NULL, 0, 0) == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	futex_queues = alloc_large_system_hash("futex",
+					sizeof(*futex_queues),
+					roundup_pow_of_two(FUTEX_HASH_PER_CPU *
+							   num_possible_cpus()),
+					0, 0, &futex_shift, &futex_hashmask,
+					0, 0);
+
+	for (i = 0; i <= futex_hashmask; i++) {
 		plist_head_init(&futex_queues[i].chain);
 		spin_lock_init(&futex_queues[i].lock);
 	}
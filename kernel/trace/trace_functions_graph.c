@@ -92,6 +92,14 @@ ftrace_push_return_trace(unsigned long ret, unsigned long func, int *depth,
 	 */
 	smp_rmb();
 
+	/*
+	 * With set_ftrace_pid in use, bail out before taking a timestamp
+	 * or touching the return stack, so that tasks which are not being
+	 * traced only pay for the mcount call itself.
+	 */
+	if (!ftrace_trace_task(current))
+		return -EBUSY;
+
 	/* The return trace stack is full */
 	if (current->curr_ret_stack == FTRACE_RETFUNC_DEPTH - 1) {
 		atomic_inc(&current->trace_overrun);
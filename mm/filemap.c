@@ -35,6 +35,7 @@
 #include <linux/memcontrol.h>
 #include <linux/mm_inline.h> /* for page_is_file_cache() */
 #include <linux/cleancache.h>
+#include <linux/pagecache_trace.h>
 #include "internal.h"
 
 /*
@@ -1271,6 +1272,7 @@ no_cached_page:
 			desc->error = error;
 			goto out;
 		}
+		pagecache_trace_miss(filp, index, 1, 1);
 		goto readpage;
 	}
 
@@ -1524,9 +1526,10 @@ static int page_cache_read(struct file *file, pgoff_t offset)
 			return -ENOMEM;
 
 		ret = add_to_page_cache_lru(page, mapping, offset, GFP_KERNEL);
-		if (ret == 0)
+		if (ret == 0) {
+			pagecache_trace_miss(file, offset, 1, 1);
 			ret = mapping->a_ops->readpage(file, page);
-		else if (ret == -EEXIST)
+		} else if (ret == -EEXIST)
 			ret = 0; /* losing race to add is OK */
 
 		page_cache_release(page);
@@ -1537,6 +1540,26 @@ static int page_cache_read(struct file *file, pgoff_t offset)
 }
 
 #define MMAP_LOTSAMISS  (100)
+#define MMAP_RANDOM_AROUND	(4)
+
+/*
+ * Classify an mmap miss against the previous one.  Misses one page apart
+ * or at the same forward stride as last time (a sequential scan whose
+ * read-around windows are being used up) count as sequential.
+ */
+static void mmap_note_fault(struct file_ra_state *ra, pgoff_t offset)
+{
+	long delta = (long)(offset - ra->prev_fault);
+
+	if (delta > 0 && delta <= ra->ra_pages &&
+	    (delta == 1 || delta == ra->stride))
+		ra_pattern_sequential(ra);
+	else
+		ra_pattern_random(ra);
+
+	ra->stride = delta;
+	ra->prev_fault = offset;
+}
 
 /*
  * Synchronous readahead happens when we don't even find
@@ -1562,6 +1585,17 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 		return;
 	}
 
+	/*
+	 * A mapping being scanned front to back does better with
+	 * ramping sequential readahead than with read-around.
+	 */
+	mmap_note_fault(ra, offset);
+	if (ra->pattern <= RA_PATTERN_SEQ) {
+		page_cache_sync_readahead(mapping, ra, file, offset,
+					  ra->ra_pages);
+		return;
+	}
+
 	/* Avoid banging the cache line if not needed */
 	if (ra->mmap_miss < MMAP_LOTSAMISS * 10)
 		ra->mmap_miss++;
@@ -1574,9 +1608,12 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 		return;
 
 	/*
-	 * mmap read-around
+	 * mmap read-around, kept small for files with a random history so
+	 * that scattered lookups do not each pull in a full window
 	 */
 	ra_pages = max_sane_readahead(ra->ra_pages);
+	if (ra->pattern >= RA_PATTERN_RANDOM)
+		ra_pages = min_t(unsigned long, ra_pages, MMAP_RANDOM_AROUND);
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
@@ -1600,6 +1637,11 @@ static void do_async_mmap_readahead(struct vm_area_struct *vma,
 		return;
 	if (ra->mmap_miss > 0)
 		ra->mmap_miss--;
+	/*
+	 * Any cached page gets here, not only read-ahead ones.  A hit on the
+	 * PG_readahead marker is what shows a window was used, and
+	 * ondemand_readahead() accounts the window in ra_used then.
+	 */
 	if (PageReadahead(page))
 		page_cache_async_readahead(mapping, ra, file,
 					   page, offset, ra->ra_pages);
@@ -250,6 +250,11 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	unsigned int	swappiness;
+	/*
+	 * Order in which groups over their soft limit are reclaimed:
+	 * higher values go first, ties are broken by the excess.
+	 */
+	unsigned int	soft_limit_priority;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -330,6 +335,9 @@ static bool move_file(void)
 #define	MEM_CGROUP_MAX_RECLAIM_LOOPS		(100)
 #define	MEM_CGROUP_MAX_SOFT_LIMIT_RECLAIM_LOOPS	(2)
 
+/* upper bound of memory.soft_limit_priority */
+#define	MEM_CGROUP_SOFT_LIMIT_PRIORITY_MAX	(100)
+
 enum charge_type {
 	MEM_CGROUP_CHARGE_TYPE_CACHE = 0,
 	MEM_CGROUP_CHARGE_TYPE_MAPPED,
@@ -420,7 +428,18 @@ __mem_cgroup_insert_exceeded(struct mem_cgroup *mem,
 		parent = *p;
 		mz_node = rb_entry(parent, struct mem_cgroup_per_zone,
 					tree_node);
-		if (mz->usage_in_excess < mz_node->usage_in_excess)
+		/*
+		 * The rightmost node is reclaimed first, so sort by
+		 * soft_limit_priority and then by the excess.
+		 */
+		if (mem->soft_limit_priority !=
+		    mz_node->mem->soft_limit_priority) {
+			if (mem->soft_limit_priority <
+			    mz_node->mem->soft_limit_priority)
+				p = &(*p)->rb_left;
+			else
+				p = &(*p)->rb_right;
+		} else if (mz->usage_in_excess < mz_node->usage_in_excess)
 			p = &(*p)->rb_left;
 		/*
 		 * We can't avoid mem cgroups that are over their soft
@@ -506,6 +525,44 @@ static void mem_cgroup_remove_from_trees(struct mem_cgroup *mem)
 	}
 }
 
+static bool mem_cgroup_zone_has_pages(struct mem_cgroup_per_zone *mz)
+{
+	enum lru_list l;
+
+	for_each_lru(l)
+		if (MEM_CGROUP_ZSTAT(mz, l))
+			return true;
+	return false;
+}
+
+/*
+ * Re-sort @mem in the soft limit trees after its soft_limit_priority
+ * changed.  It is only put back into the trees of zones it has pages
+ * in: with priority sorted first, a high priority group would
+ * otherwise sit at the top of every zone's tree and soft limit reclaim
+ * would pick it for zones where it has nothing to give back.
+ */
+static void mem_cgroup_requeue_soft_limit(struct mem_cgroup *mem)
+{
+	unsigned long long excess = res_counter_soft_limit_excess(&mem->res);
+	struct mem_cgroup_per_zone *mz;
+	struct mem_cgroup_tree_per_zone *mctz;
+	int node, zone;
+
+	for_each_node_state(node, N_POSSIBLE) {
+		for (zone = 0; zone < MAX_NR_ZONES; zone++) {
+			mz = mem_cgroup_zoneinfo(mem, node, zone);
+			mctz = soft_limit_tree_node_zone(node, zone);
+			spin_lock(&mctz->lock);
+			__mem_cgroup_remove_exceeded(mem, mz, mctz);
+			if (mem_cgroup_zone_has_pages(mz))
+				__mem_cgroup_insert_exceeded(mem, mz, mctz,
+							     excess);
+			spin_unlock(&mctz->lock);
+		}
+	}
+}
+
 static struct mem_cgroup_per_zone *
 __mem_cgroup_largest_soft_limit_node(struct mem_cgroup_tree_per_zone *mctz)
 {
@@ -845,6 +902,31 @@ static inline bool mem_cgroup_is_root(struct mem_cgroup *mem)
 	return (mem == root_mem_cgroup);
 }
 
+/**
+ * mem_cgroup_mm_soft_limit_excess - memory pressure of an mm's group
+ * @mm: the mm to look up
+ *
+ * Returns the number of pages by which the memory cgroup owning @mm
+ * exceeds its soft limit, 0 for the root cgroup.  Lets the Android
+ * low memory killer prefer tasks in groups soft limit reclaim could
+ * not push back.  The caller keeps @mm alive.
+ */
+unsigned long mem_cgroup_mm_soft_limit_excess(struct mm_struct *mm)
+{
+	struct mem_cgroup *mem;
+	unsigned long excess = 0;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	rcu_read_lock();
+	mem = mem_cgroup_from_task(rcu_dereference(mm->owner));
+	if (mem && !mem_cgroup_is_root(mem))
+		excess = res_counter_soft_limit_excess(&mem->res) >> PAGE_SHIFT;
+	rcu_read_unlock();
+	return excess;
+}
+
 void mem_cgroup_count_vm_event(struct mm_struct *mm, enum vm_event_item idx)
 {
 	struct mem_cgroup *mem;
@@ -4309,6 +4391,28 @@ static int mem_cgroup_swappiness_write(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_soft_limit_priority_read(struct cgroup *cgrp,
+					       struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->soft_limit_priority;
+}
+
+static int mem_cgroup_soft_limit_priority_write(struct cgroup *cgrp,
+						struct cftype *cft, u64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+
+	if (val > MEM_CGROUP_SOFT_LIMIT_PRIORITY_MAX)
+		return -EINVAL;
+
+	if (cgrp->parent == NULL)
+		return -EINVAL;
+
+	memcg->soft_limit_priority = val;
+	mem_cgroup_requeue_soft_limit(memcg);
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -4721,6 +4825,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "soft_limit_priority",
+		.read_u64 = mem_cgroup_soft_limit_priority_read,
+		.write_u64 = mem_cgroup_soft_limit_priority_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4999,8 +5108,10 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&mem->oom_notify);
 
-	if (parent)
+	if (parent) {
 		mem->swappiness = get_swappiness(parent);
+		mem->soft_limit_priority = parent->soft_limit_priority;
+	}
 	atomic_set(&mem->refcnt, 1);
 	mem->move_charge_at_immigrate = 0;
 	mutex_init(&mem->thresholds_lock);
@@ -617,6 +617,19 @@ static inline int free_pages_check(struct page *page)
 	return 0;
 }
 
+/*
+ * Take zone->lock from the allocator paths, counting how often it was
+ * contended.  Interrupts must already be disabled.
+ */
+static inline void lock_zone(struct zone *zone)
+{
+	__count_vm_event(ZONE_LOCK);
+	if (unlikely(!spin_trylock(&zone->lock))) {
+		__count_vm_event(ZONE_LOCK_CONTENDED);
+		spin_lock(&zone->lock);
+	}
+}
+
 /*
  * Frees a number of pages from the PCP lists
  * Assumes all pages on list are in same zone, and of same order.
@@ -635,7 +648,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	int batch_free = 0;
 	int to_free = count;
 
-	spin_lock(&zone->lock);
+	lock_zone(zone);
 #ifndef CONFIG_CMA //added by qijiwen
 	zone->all_unreclaimable = 0;
 	zone->pages_scanned = 0;
@@ -705,7 +718,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
-	spin_lock(&zone->lock);
+	lock_zone(zone);
 
 	__free_one_page(page, zone, order, migratetype);
 #ifdef CONFIG_CMA //added by qijiwen
@@ -1222,7 +1235,7 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 		migratetype = MIGRATE_MOVABLE;
 	}
 #endif
-	spin_lock(&zone->lock);
+	lock_zone(zone);
 	for (i = 0; i < count; ++i) {
 #ifdef CONFIG_CMA
 		struct page *page = __rmqueue_cma(zone, order, migratetype, cma);
@@ -1272,6 +1285,39 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	return i;
 }
 
+/*
+ * Unless percpu_pagelist_fraction pins the sizes, a per-cpu list that
+ * runs dry again within PCP_ADAPT_WINDOW of its last refill grows its
+ * batch, and the high mark with it, up to PCP_ADAPT_MAX times the
+ * configured size.  Bursts of order-0 allocations then go to the zone
+ * lock less often.  A refill after a quieter spell starts over from the
+ * configured size, and every overflow on the free side shrinks the list
+ * by one step, so the pages are not kept once the burst is over.
+ */
+#define PCP_ADAPT_MAX		4
+#define PCP_ADAPT_WINDOW	(HZ / 10)
+
+static inline void pcp_adapt(struct per_cpu_pages *pcp, bool grow)
+{
+	int batch = pcp->batch;
+
+	if (percpu_pagelist_fraction)
+		return;
+
+	if (grow) {
+		if (time_after(jiffies, pcp->adapt_stamp + PCP_ADAPT_WINDOW))
+			batch = pcp->base_batch;
+		else
+			batch = min(batch + pcp->base_batch,
+				    pcp->base_batch * PCP_ADAPT_MAX);
+		pcp->adapt_stamp = jiffies;
+	} else
+		batch = max(batch - pcp->base_batch, pcp->base_batch);
+
+	pcp->batch = batch;
+	pcp->high = pcp->base_high * batch / pcp->base_batch;
+}
+
 #ifdef CONFIG_NUMA
 /*
  * Called from the vmstat counter updater to drain pagesets of this
@@ -1545,6 +1591,7 @@ void free_hot_cold_page(struct page *page, int cold)
 	if (pcp->count >= pcp->high) {
 		free_pcppages_bulk(zone, pcp->batch, pcp);
 		pcp->count -= pcp->batch;
+		pcp_adapt(pcp, false);
 	}
 
 out:
@@ -1671,6 +1718,7 @@ again:
 		pcp = &this_cpu_ptr(zone->pageset)->pcp;
 		list = &pcp->lists[migratetype];
 		if (list_empty(list)) {
+			pcp_adapt(pcp, true);
 			pcp->count += rmqueue_bulk(zone, 0,
 					pcp->batch, list,
 					migratetype, cold);
@@ -1700,7 +1748,8 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
+		local_irq_save(flags);
+		lock_zone(zone);
 #ifdef CONFIG_CMA
 		page = __rmqueue_cma(zone, order, migratetype, 0);
 #else
@@ -1749,6 +1798,7 @@ again:
 		pcp = &this_cpu_ptr(zone->pageset)->pcp;
 		list = &pcp->lists[migratetype];
 		if (list_empty(list)) {
+			pcp_adapt(pcp, true);
 			pcp->count += rmqueue_bulk(zone, 0,
 					pcp->batch, list,
 					migratetype, cold);
@@ -1777,7 +1827,8 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
+		local_irq_save(flags);
+		lock_zone(zone);
 		page = __rmqueue(zone, order, migratetype);
 		spin_unlock(&zone->lock);
 		if (!page)
@@ -2858,6 +2909,110 @@ out:
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/*
+ * Upper bound on the pages alloc_pages_bulk() pulls from the buddy lists
+ * under one hold of zone->lock, to bound the interrupts-off section.
+ */
+#define BULK_REFILL_MAX	256
+
+/**
+ * alloc_pages_bulk - allocate a number of order-0 pages
+ * @gfp_mask: GFP flags for the allocation
+ * @nr_pages: number of pages wanted
+ * @pages: array receiving the pages
+ *
+ * Serves the request from the local per-cpu list of the preferred
+ * zone.  When the list runs dry, it is refilled with everything still
+ * needed in one zone->lock round trip, instead of one batch per
+ * alloc_page() call.  If the zone is too close to its low watermark,
+ * or the fast path comes up short, the rest is allocated with
+ * alloc_page(), which can reclaim.
+ *
+ * Returns the number of pages stored in @pages.  On a short count the
+ * caller still owns, and must free, the pages it did get.
+ */
+unsigned long alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+			       struct page **pages)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int migratetype = allocflags_to_migratetype(gfp_mask);
+	int cold = !!(gfp_mask & __GFP_COLD);
+	struct zonelist *zonelist;
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	struct zone *zone;
+	unsigned long flags, nr = 0, i, got;
+
+	gfp_mask &= gfp_allowed_mask;
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	if (nr_pages < 2 || (gfp_mask & (__GFP_COMP | __GFP_WRITE)))
+		goto fallback;
+
+	zonelist = node_zonelist(numa_node_id(), gfp_mask);
+	first_zones_zonelist(zonelist, high_zoneidx,
+			     &cpuset_current_mems_allowed, &zone);
+	if (!zone || !zone_watermark_ok(zone, 0,
+					low_wmark_pages(zone) + nr_pages,
+					zone_idx(zone), ALLOC_WMARK_LOW))
+		goto fallback;
+
+#ifdef CONFIG_CMA
+	if (gfp_mask & __GFP_CMA)
+		migratetype = MIGRATE_CMA;
+#endif
+
+	local_irq_save(flags);
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list = &pcp->lists[migratetype];
+	while (nr < nr_pages) {
+		struct page *page;
+
+		if (list_empty(list)) {
+			got = max_t(unsigned long, pcp->batch, nr_pages - nr);
+			got = rmqueue_bulk(zone, 0, min_t(unsigned long, got,
+						BULK_REFILL_MAX),
+					   list, migratetype, cold);
+			pcp->count += got;
+			if (!got)
+				break;
+		}
+
+		if (cold)
+			page = list_entry(list->prev, struct page, lru);
+		else
+			page = list_entry(list->next, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+		pages[nr++] = page;
+		zone_statistics(zone, zone, gfp_mask);
+	}
+	__count_zone_vm_events(PGALLOC, zone, nr);
+	__count_vm_events(PGALLOC_BULK, nr);
+	local_irq_restore(flags);
+
+	/* bad pages are dropped, just like buffered_rmqueue() does */
+	for (i = 0, got = 0; i < nr; i++) {
+		VM_BUG_ON(bad_range(zone, pages[i]));
+		if (prep_new_page(pages[i], 0, gfp_mask))
+			continue;
+		trace_mm_page_alloc(pages[i], 0, gfp_mask, migratetype);
+		pages[got++] = pages[i];
+	}
+	nr = got;
+
+fallback:
+	while (nr < nr_pages) {
+		struct page *page = alloc_page(gfp_mask);
+
+		if (!page)
+			break;
+		pages[nr++] = page;
+	}
+	return nr;
+}
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -4159,6 +4314,9 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->count = 0;
 	pcp->high = 6 * batch;
 	pcp->batch = max(1UL, 1 * batch);
+	pcp->base_high = pcp->high;
+	pcp->base_batch = pcp->batch;
+	pcp->adapt_stamp = jiffies;
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
 }
@@ -4178,6 +4336,8 @@ static void setup_pagelist_highmark(struct per_cpu_pageset *p,
 	pcp->batch = max(1UL, high/4);
 	if ((high/4) > (PAGE_SHIFT * 8))
 		pcp->batch = PAGE_SHIFT * 8;
+	pcp->base_high = pcp->high;
+	pcp->base_batch = pcp->batch;
 }
 
 static void setup_zone_pageset(struct zone *zone)
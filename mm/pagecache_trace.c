@@ -0,0 +1,653 @@
+/*
+ * Page cache miss tracing and prefetch replay
+ *
+ * Boot and cold application launches read the same APK, dex and library
+ * pages every time, in the scattered order the demand faults happen to
+ * arrive in.  This records which file pages had to be read from disk
+ * during a window, hands the trace to userspace to persist, and replays a
+ * saved trace as large, sorted, asynchronous readahead requests before
+ * the faults that would have read those pages arrive.
+ *
+ * /proc/pagecache_trace/control	"start [seconds]" opens a recording
+ *					window, "stop" closes it
+ * /proc/pagecache_trace/trace	read: the last window, as a "/path" line
+ *				followed by "index nr" page extents;
+ *				write: a saved trace, which is replayed and
+ *				opens a new window to measure it
+ * /proc/pagecache_trace/stats	replay coverage and window times
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/hash.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/pagecache_trace.h>
+#include <linux/path.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#define PCT_MAX_FILES		1024
+#define PCT_MAX_EXTENTS		16384
+#define PCT_HASH_BITS		8
+
+struct pct_file {
+	struct hlist_node	hash;
+	struct inode		*inode;
+	struct path		path;	/* held only while recording */
+	char			*name;	/* set when the window closes */
+	unsigned int		id;
+};
+
+struct pct_extent {
+	pgoff_t			index;
+	unsigned int		nr;
+	unsigned int		file;
+};
+
+int pagecache_trace_active __read_mostly;
+
+/* pct_lock guards the recording state against the miss hook */
+static DEFINE_SPINLOCK(pct_lock);
+/* pct_mutex serialises the control, trace and replay paths */
+static DEFINE_MUTEX(pct_mutex);
+
+static struct hlist_head pct_hash[1 << PCT_HASH_BITS];
+static struct pct_file *pct_files[PCT_MAX_FILES];
+static unsigned int pct_nr_files;
+static struct pct_extent *pct_extents;
+static unsigned int pct_nr_extents;
+static unsigned long pct_dropped;
+static unsigned long pct_window_start;
+static int pct_window_replay;
+
+static struct file *pct_replay_files[PCT_MAX_FILES];
+static unsigned int pct_replay_nr_files;
+static struct pct_extent *pct_replay_extents;
+static unsigned int pct_replay_nr_extents;
+static struct task_struct *pct_replay_task;
+static int pct_replay_loading;
+
+static struct {
+	unsigned long	demand_pages;	/* read on demand in the window */
+	unsigned long	record_demand;	/* demand_pages of the last window
+					   without a replay */
+	unsigned long	replay_demand;	/* and of the last one with a replay */
+	unsigned long	replay_pages;	/* read by the last replay */
+	unsigned int	submit_ms;	/* time to queue the last replay */
+	unsigned int	record_ms;	/* last window without a replay */
+	unsigned int	replay_ms;	/* last window with a replay */
+} pct_stats;
+
+static void pct_stop_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(pct_stop_work, pct_stop_fn);
+
+void __pagecache_trace_miss(struct file *filp, pgoff_t index,
+			    unsigned long span, unsigned long nr)
+{
+	struct inode *inode = filp->f_mapping->host;
+	struct hlist_head *head = &pct_hash[hash_ptr(inode, PCT_HASH_BITS)];
+	struct hlist_node *pos;
+	struct pct_file *pf;
+	struct pct_extent *ext;
+
+	/* the replay's own reads are not misses */
+	if (current == pct_replay_task)
+		return;
+
+	spin_lock(&pct_lock);
+	if (!pagecache_trace_active)
+		goto out;
+
+	pct_stats.demand_pages += nr;
+
+	hlist_for_each_entry(pf, pos, head, hash)
+		if (pf->inode == inode)
+			goto found;
+
+	if (pct_nr_files == PCT_MAX_FILES)
+		goto drop;
+	pf = kmalloc(sizeof(*pf), GFP_ATOMIC);
+	if (!pf)
+		goto drop;
+	pf->inode = inode;
+	pf->path = filp->f_path;
+	path_get(&pf->path);
+	pf->name = NULL;
+	pf->id = pct_nr_files;
+	hlist_add_head(&pf->hash, head);
+	pct_files[pct_nr_files++] = pf;
+
+found:
+	/* sequential misses usually continue the previous extent */
+	if (pct_nr_extents) {
+		ext = &pct_extents[pct_nr_extents - 1];
+		if (ext->file == pf->id && ext->index + ext->nr == index) {
+			ext->nr += span;
+			goto out;
+		}
+	}
+	if (pct_nr_extents == PCT_MAX_EXTENTS)
+		goto drop;
+	ext = &pct_extents[pct_nr_extents++];
+	ext->file = pf->id;
+	ext->index = index;
+	ext->nr = span;
+	goto out;
+
+drop:
+	pct_dropped++;
+out:
+	spin_unlock(&pct_lock);
+}
+
+static int pct_extent_cmp(const void *a, const void *b)
+{
+	const struct pct_extent *x = a, *y = b;
+
+	if (x->file != y->file)
+		return x->file < y->file ? -1 : 1;
+	if (x->index != y->index)
+		return x->index < y->index ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Sort by file and offset, then fold overlapping and adjacent extents.
+ * Extents must not wrap and must lie within their file, which keeps the
+ * folded length within nr.  pct_load_line() checks this for written traces.
+ */
+static unsigned int pct_sort_extents(struct pct_extent *ext, unsigned int n)
+{
+	unsigned int i, out = 0;
+
+	sort(ext, n, sizeof(*ext), pct_extent_cmp, NULL);
+
+	for (i = 0; i < n; i++) {
+		struct pct_extent *prev = out ? &ext[out - 1] : NULL;
+
+		if (prev && prev->file == ext[i].file &&
+		    prev->index + prev->nr >= ext[i].index) {
+			pgoff_t end = max(prev->index + prev->nr,
+					  ext[i].index + ext[i].nr);
+
+			prev->nr = end - prev->index;
+			continue;
+		}
+		ext[out++] = ext[i];
+	}
+	return out;
+}
+
+/* Drop the previous window's trace.  Called with pct_mutex held. */
+static void pct_reset(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < pct_nr_files; i++) {
+		kfree(pct_files[i]->name);
+		kfree(pct_files[i]);
+	}
+	for (i = 0; i < ARRAY_SIZE(pct_hash); i++)
+		INIT_HLIST_HEAD(&pct_hash[i]);
+	pct_nr_files = 0;
+	pct_nr_extents = 0;
+	pct_dropped = 0;
+}
+
+static int pct_start(unsigned int secs, int replay)
+{
+	if (pagecache_trace_active)
+		return -EBUSY;
+
+	if (!pct_extents) {
+		pct_extents = vmalloc(PCT_MAX_EXTENTS * sizeof(*pct_extents));
+		if (!pct_extents)
+			return -ENOMEM;
+	}
+	pct_reset();
+
+	pct_stats.demand_pages = 0;
+	pct_window_start = jiffies;
+	pct_window_replay = replay;
+
+	spin_lock(&pct_lock);
+	pagecache_trace_active = 1;
+	spin_unlock(&pct_lock);
+
+	if (secs)
+		schedule_delayed_work(&pct_stop_work, secs * HZ);
+	return 0;
+}
+
+/*
+ * Turn the recorded paths into names and drop the references, so that a
+ * closed window doesn't keep the files' mounts busy.  An unlinked file
+ * can't be opened by name on replay and gets no name.
+ */
+static void pct_put_paths(void)
+{
+	struct pct_file *pf;
+	unsigned int i;
+	char *buf, *name;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+
+	for (i = 0; i < pct_nr_files; i++) {
+		pf = pct_files[i];
+		if (buf && !d_unlinked(pf->path.dentry)) {
+			name = d_path(&pf->path, buf, PAGE_SIZE);
+			if (!IS_ERR(name))
+				pf->name = kstrdup(name, GFP_KERNEL);
+		}
+		path_put(&pf->path);
+	}
+
+	free_page((unsigned long)buf);
+}
+
+static void pct_stop(void)
+{
+	unsigned int ms;
+
+	if (!pagecache_trace_active)
+		return;
+
+	spin_lock(&pct_lock);
+	pagecache_trace_active = 0;
+	spin_unlock(&pct_lock);
+
+	ms = jiffies_to_msecs(jiffies - pct_window_start);
+	if (pct_window_replay) {
+		pct_stats.replay_ms = ms;
+		pct_stats.replay_demand = pct_stats.demand_pages;
+	} else {
+		pct_stats.record_ms = ms;
+		pct_stats.record_demand = pct_stats.demand_pages;
+	}
+
+	pct_put_paths();
+	pct_nr_extents = pct_sort_extents(pct_extents, pct_nr_extents);
+}
+
+static void pct_stop_fn(struct work_struct *work)
+{
+	mutex_lock(&pct_mutex);
+	pct_stop();
+	mutex_unlock(&pct_mutex);
+}
+
+static int pct_replay_fn(void *unused)
+{
+	unsigned long start = jiffies;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < pct_replay_nr_extents; i++) {
+		struct pct_extent *ext = &pct_replay_extents[i];
+		struct file *filp = pct_replay_files[ext->file];
+
+		ret = force_page_cache_readahead(filp->f_mapping, filp,
+						 ext->index, ext->nr);
+		if (ret > 0)
+			pct_stats.replay_pages += ret;
+	}
+	pct_stats.submit_ms = jiffies_to_msecs(jiffies - start);
+
+	mutex_lock(&pct_mutex);
+	for (i = 0; i < pct_replay_nr_files; i++)
+		fput(pct_replay_files[i]);
+	pct_replay_nr_files = 0;
+	pct_replay_nr_extents = 0;
+	pct_replay_task = NULL;
+	mutex_unlock(&pct_mutex);
+
+	return 0;
+}
+
+/*
+ * /proc/pagecache_trace/trace, read side: walk the sorted extents and
+ * print the path whenever the file changes.
+ */
+static void *pct_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&pct_mutex);
+	if (pagecache_trace_active)
+		return ERR_PTR(-EBUSY);
+	if (*pos >= pct_nr_extents)
+		return NULL;
+	return &pct_extents[*pos];
+}
+
+static void *pct_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	if (++*pos >= pct_nr_extents)
+		return NULL;
+	return &pct_extents[*pos];
+}
+
+static void pct_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&pct_mutex);
+}
+
+static int pct_seq_show(struct seq_file *m, void *v)
+{
+	struct pct_extent *ext = v;
+	struct pct_file *pf = pct_files[ext->file];
+
+	/* no name: unlinked, or out of memory when the window closed */
+	if (!pf->name)
+		return 0;
+
+	if (ext == pct_extents || ext[-1].file != ext->file) {
+		seq_escape(m, pf->name, "\n");
+		seq_putc(m, '\n');
+	}
+	seq_printf(m, "%lu %u\n", ext->index, ext->nr);
+	return 0;
+}
+
+static const struct seq_operations pct_seq_ops = {
+	.start	= pct_seq_start,
+	.next	= pct_seq_next,
+	.stop	= pct_seq_stop,
+	.show	= pct_seq_show,
+};
+
+/*
+ * Write side: parse a saved trace line by line.  Writes may split lines
+ * anywhere, so a partial line is carried over to the next write.
+ */
+struct pct_loader {
+	int		file;		/* current replay file, -1 to skip */
+	int		len;		/* -1 while discarding an overlong line */
+	char		line[PATH_MAX];
+};
+
+static void pct_load_line(struct pct_loader *ld)
+{
+	struct pct_extent *ext;
+	unsigned long index;
+	unsigned int nr;
+	struct file *filp;
+	pgoff_t end;
+
+	if (ld->line[0] == '/') {
+		ld->file = -1;
+		if (pct_replay_nr_files == PCT_MAX_FILES)
+			return;
+		filp = filp_open(ld->line, O_RDONLY | O_LARGEFILE, 0);
+		if (IS_ERR(filp))
+			return;
+		ld->file = pct_replay_nr_files;
+		pct_replay_files[pct_replay_nr_files++] = filp;
+		return;
+	}
+
+	if (ld->file < 0 || pct_replay_nr_extents == PCT_MAX_EXTENTS)
+		return;
+	if (sscanf(ld->line, "%lu %u", &index, &nr) != 2 || !nr)
+		return;
+
+	/* a stale or hand-edited trace may run past the file, or wrap */
+	filp = pct_replay_files[ld->file];
+	end = DIV_ROUND_UP(i_size_read(filp->f_mapping->host), PAGE_CACHE_SIZE);
+	if (index + nr < index || index + nr > end)
+		return;
+
+	ext = &pct_replay_extents[pct_replay_nr_extents++];
+	ext->file = ld->file;
+	ext->index = index;
+	ext->nr = nr;
+}
+
+static ssize_t pct_trace_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct pct_loader *ld = ((struct seq_file *)file->private_data)->private;
+	size_t done;
+	char c;
+
+	if (!ld)
+		return -EINVAL;
+
+	for (done = 0; done < count; done++) {
+		if (get_user(c, buf + done))
+			return -EFAULT;
+
+		if (c == '\n') {
+			if (ld->len > 0) {
+				ld->line[ld->len] = '\0';
+				pct_load_line(ld);
+			}
+			ld->len = 0;
+		} else if (ld->len >= 0) {
+			ld->line[ld->len++] = c;
+			if (ld->len == PATH_MAX)
+				ld->len = -1;
+		}
+	}
+	return count;
+}
+
+static int pct_trace_open(struct inode *inode, struct file *file)
+{
+	struct pct_loader *ld = NULL;
+	int ret;
+
+	if (file->f_mode & FMODE_WRITE) {
+		mutex_lock(&pct_mutex);
+		if (pct_replay_task || pct_replay_loading ||
+		    pagecache_trace_active) {
+			mutex_unlock(&pct_mutex);
+			return -EBUSY;
+		}
+		if (!pct_replay_extents) {
+			pct_replay_extents = vmalloc(PCT_MAX_EXTENTS *
+						sizeof(*pct_replay_extents));
+			if (!pct_replay_extents) {
+				mutex_unlock(&pct_mutex);
+				return -ENOMEM;
+			}
+		}
+		pct_replay_loading = 1;
+		mutex_unlock(&pct_mutex);
+
+		ld = kzalloc(sizeof(*ld), GFP_KERNEL);
+		if (!ld) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		ld->file = -1;
+	}
+
+	ret = seq_open(file, &pct_seq_ops);
+	if (ret)
+		goto err;
+	((struct seq_file *)file->private_data)->private = ld;
+	return 0;
+
+err:
+	kfree(ld);
+	if (file->f_mode & FMODE_WRITE) {
+		mutex_lock(&pct_mutex);
+		pct_replay_loading = 0;
+		mutex_unlock(&pct_mutex);
+	}
+	return ret;
+}
+
+static int pct_trace_release(struct inode *inode, struct file *file)
+{
+	struct pct_loader *ld = ((struct seq_file *)file->private_data)->private;
+	struct task_struct *task;
+	unsigned int i;
+	int ret;
+
+	if (!ld)
+		return seq_release(inode, file);
+
+	if (ld->len > 0) {
+		ld->line[ld->len] = '\0';
+		pct_load_line(ld);
+	}
+	kfree(ld);
+
+	mutex_lock(&pct_mutex);
+	pct_replay_loading = 0;
+	pct_replay_nr_extents = pct_sort_extents(pct_replay_extents,
+						 pct_replay_nr_extents);
+	if (!pct_replay_nr_extents)
+		goto drop;
+
+	task = kthread_create(pct_replay_fn, NULL, "pagecache_replay");
+	if (IS_ERR(task))
+		goto drop;
+
+	/*
+	 * Measure the replay over a fresh window.  The readahead is still
+	 * worth doing if no window can be opened, it just goes unmeasured.
+	 */
+	pct_stats.replay_pages = 0;
+	ret = pct_start(0, 1);
+	if (ret)
+		pr_warn("pagecache_trace: replay not measured, window start failed: %d\n",
+			ret);
+	pct_replay_task = task;
+	wake_up_process(task);
+	mutex_unlock(&pct_mutex);
+
+	return seq_release(inode, file);
+
+drop:
+	for (i = 0; i < pct_replay_nr_files; i++)
+		fput(pct_replay_files[i]);
+	pct_replay_nr_files = 0;
+	pct_replay_nr_extents = 0;
+	mutex_unlock(&pct_mutex);
+
+	return seq_release(inode, file);
+}
+
+static const struct file_operations pct_trace_fops = {
+	.open		= pct_trace_open,
+	.read		= seq_read,
+	.write		= pct_trace_write,
+	.llseek		= seq_lseek,
+	.release	= pct_trace_release,
+};
+
+static ssize_t pct_control_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	char cmd[32], *s;
+	unsigned int secs = 0;
+	int ret = 0;
+
+	if (count >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, count))
+		return -EFAULT;
+	cmd[count] = '\0';
+	s = strim(cmd);
+
+	mutex_lock(&pct_mutex);
+	if (!strncmp(s, "start", 5)) {
+		/* a trace being written opens its own window on close */
+		if (pct_replay_loading)
+			ret = -EBUSY;
+		else if (s[5] && sscanf(s + 5, "%u", &secs) != 1)
+			ret = -EINVAL;
+		else
+			ret = pct_start(secs, 0);
+	} else if (!strcmp(s, "stop")) {
+		cancel_delayed_work(&pct_stop_work);
+		pct_stop();
+	} else {
+		ret = -EINVAL;
+	}
+	mutex_unlock(&pct_mutex);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations pct_control_fops = {
+	.write		= pct_control_write,
+	.llseek		= noop_llseek,
+};
+
+static int pct_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long demand, replay, before, after;
+
+	mutex_lock(&pct_mutex);
+	demand = pct_stats.demand_pages;
+	replay = pct_stats.replay_pages;
+	before = pct_stats.record_demand;
+	after = pct_stats.replay_demand;
+
+	seq_printf(m, "active:           %d\n", pagecache_trace_active);
+	seq_printf(m, "replaying:        %d\n", pct_replay_task != NULL);
+	seq_printf(m, "files:            %u\n", pct_nr_files);
+	seq_printf(m, "extents:          %u\n", pct_nr_extents);
+	seq_printf(m, "dropped:          %lu\n", pct_dropped);
+	seq_printf(m, "demand_pages:     %lu\n", demand);
+	seq_printf(m, "replay_pages:     %lu\n", replay);
+	seq_printf(m, "record_demand:    %lu\n", before);
+	seq_printf(m, "replay_demand:    %lu\n", after);
+	/*
+	 * Share of the recorded window's demand reads that were gone in
+	 * the replay window.  Replayed pages nobody touched don't count.
+	 */
+	seq_printf(m, "hit_ratio:        %lu%%\n",
+		   before > after ? (before - after) * 100 / before : 0);
+	seq_printf(m, "replay_submit_ms: %u\n", pct_stats.submit_ms);
+	seq_printf(m, "record_window_ms: %u\n", pct_stats.record_ms);
+	seq_printf(m, "replay_window_ms: %u\n", pct_stats.replay_ms);
+	seq_printf(m, "time_saved_ms:    %d\n",
+		   pct_stats.record_ms && pct_stats.replay_ms ?
+		   (int)pct_stats.record_ms - (int)pct_stats.replay_ms : 0);
+	mutex_unlock(&pct_mutex);
+
+	return 0;
+}
+
+static int pct_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pct_stats_show, NULL);
+}
+
+static const struct file_operations pct_stats_fops = {
+	.open		= pct_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pagecache_trace_init(void)
+{
+	struct proc_dir_entry *dir;
+
+	dir = proc_mkdir("pagecache_trace", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	proc_create("control", S_IWUSR, dir, &pct_control_fops);
+	proc_create("trace", S_IRUSR | S_IWUSR, dir, &pct_trace_fops);
+	proc_create("stats", S_IRUGO, dir, &pct_stats_fops);
+
+	return 0;
+}
+module_init(pagecache_trace_init);
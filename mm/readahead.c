@@ -17,6 +17,7 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/pagecache_trace.h>
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -158,6 +159,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	LIST_HEAD(page_pool);
 	int page_idx;
 	int ret = 0;
+	pgoff_t first = 0, last = 0;
 	loff_t isize = i_size_read(inode);
 
 	if (isize == 0)
@@ -187,6 +189,9 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
+		if (!ret)
+			first = page_offset;
+		last = page_offset;
 		ret++;
 	}
 
@@ -195,8 +200,10 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	 * uptodate then the caller will launch readpage again, and
 	 * will then handle the error.
 	 */
-	if (ret)
+	if (ret) {
+		pagecache_trace_miss(filp, first, last - first + 1, ret);
 		read_pages(mapping, filp, &page_pool, ret);
+	}
 	BUG_ON(!list_empty(&page_pool));
 out:
 	return ret;
@@ -255,6 +262,7 @@ unsigned long ra_submit(struct file_ra_state *ra,
 
 	actual = __do_page_cache_readahead(mapping, filp,
 					ra->start, ra->size, ra->async_size);
+	ra->ra_read += actual;
 
 	return actual;
 }
@@ -412,6 +420,8 @@ ondemand_readahead(struct address_space *mapping,
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		ra_pattern_sequential(ra);
+		ra->ra_used += ra->size;
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
@@ -434,6 +444,8 @@ ondemand_readahead(struct address_space *mapping,
 		if (!start || start - offset > max)
 			return 0;
 
+		ra_pattern_sequential(ra);
+		ra->ra_used += start - offset;
 		ra->start = start;
 		ra->size = start - offset;	/* old async_size */
 		ra->size += req_size;
@@ -451,25 +463,43 @@ ondemand_readahead(struct address_space *mapping,
 	/*
 	 * sequential cache miss
 	 */
-	if (offset - (ra->prev_pos >> PAGE_CACHE_SHIFT) <= 1UL)
+	if (offset - (ra->prev_pos >> PAGE_CACHE_SHIFT) <= 1UL) {
+		ra_pattern_sequential(ra);
 		goto initial_readahead;
+	}
 
 	/*
 	 * Query the page cache and look for the traces(cached history pages)
 	 * that a sequential stream would leave behind.
 	 */
-	if (try_context_readahead(mapping, ra, offset, req_size, max))
+	if (try_context_readahead(mapping, ra, offset, req_size, max)) {
+		ra_pattern_sequential(ra);
 		goto readit;
+	}
 
 	/*
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
+	ra_pattern_random(ra);
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
+	/*
+	 * A file with a random history (resource lookups in an APK) gets
+	 * just what was asked for and no marker; one that has been read
+	 * sequentially (dex verification) starts at half the maximum.
+	 */
+	if (ra->pattern >= RA_PATTERN_RANDOM && req_size <= max) {
+		ra->start = offset;
+		ra->size = req_size;
+		ra->async_size = 0;
+		goto readit;
+	}
 	ra->start = offset;
 	ra->size = get_init_ra_size(req_size, max);
+	if (ra->pattern <= RA_PATTERN_SEQ)
+		ra->size = max_t(unsigned long, ra->size, max / 2);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
 
 readit:
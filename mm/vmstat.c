@@ -761,6 +761,9 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"pgalloc_bulk",
+	"zone_lock",
+	"zone_lock_contended",
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -1562,6 +1562,7 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 	int err, size;
 	struct sk_buff *skb;
 	int sent = 0;
+	int unwoken = 0;
 	struct scm_cookie tmp_scm;
 	bool fds_sent = false;
 	int max_level;
@@ -1606,11 +1607,19 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 			size = SKB_MAX_ALLOC;
 
 		/*
-		 *	Grab a buffer
+		 *	Grab a buffer.  The reader is woken once per batch of
+		 *	buffers rather than once per buffer, but always before
+		 *	we could block waiting for it to drain the queue.
 		 */
 
-		skb = sock_alloc_send_skb(sk, size, msg->msg_flags&MSG_DONTWAIT,
+		skb = sock_alloc_send_skb(sk, size,
+					  unwoken || (msg->msg_flags&MSG_DONTWAIT),
 					  &err);
+		if (skb == NULL && unwoken && !(msg->msg_flags&MSG_DONTWAIT)) {
+			other->sk_data_ready(other, unwoken);
+			unwoken = 0;
+			skb = sock_alloc_send_skb(sk, size, 0, &err);
+		}
 
 		if (skb == NULL)
 			goto out_err;
@@ -1650,10 +1659,12 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 		if (max_level > unix_sk(other)->recursion_level)
 			unix_sk(other)->recursion_level = max_level;
 		unix_state_unlock(other);
-		other->sk_data_ready(other, size);
+		unwoken += size;
 		sent += size;
 	}
 
+	if (unwoken)
+		other->sk_data_ready(other, unwoken);
 	scm_destroy(siocb->scm);
 	siocb->scm = NULL;
 
@@ -1667,6 +1678,8 @@ pipe_err:
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (unwoken)
+		other->sk_data_ready(other, unwoken);
 	scm_destroy(siocb->scm);
 	siocb->scm = NULL;
 	return sent ? : err;
@@ -1749,7 +1762,20 @@ static int unix_dgram_recvmsg(struct kiocb *iocb, struct socket *sock,
 		goto out_unlock;
 	}
 
-	wake_up_interruptible_sync_poll(&u->peer_wait,
+	/*
+	 * Only writers blocked on a full queue sleep on peer_wait, so
+	 * skip the wait queue lock when nobody is there.  Pairs with the
+	 * barrier in prepare_to_wait_exclusive() and sock_poll_wait().
+	 *
+	 * This wake is not batched across receives.  Writers wait
+	 * exclusively, so each wake lets only one of them go.  The queue
+	 * length seen here races with other readers.  Deferring it until
+	 * the queue is half empty would strand a writer whose reader
+	 * stops after one message to wait for it.
+	 */
+	smp_mb();
+	if (waitqueue_active(&u->peer_wait))
+		wake_up_interruptible_sync_poll(&u->peer_wait,
 					POLLOUT | POLLWRNORM | POLLWRBAND);
 
 	if (msg->msg_name)
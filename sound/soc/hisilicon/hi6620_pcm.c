@@ -56,10 +56,14 @@
 the 2 MACRO should be used seperately
 CONFIG_SND_TEST_AUDIO_PCM_LOOP : for ST, simu data send of mailbox
 __DRV_AUDIO_MAILBOX_WORK__   : leave mailbox's work to workqueue
+CONFIG_SND_HI6620_PCM_FAST_PATH : handle period elapsed directly in the
+                                  mailbox callback (tasklet_hi), no workqueue
 */
 #ifndef CONFIG_SND_TEST_AUDIO_PCM_LOOP
+#ifndef CONFIG_SND_HI6620_PCM_FAST_PATH
 #define __DRV_AUDIO_MAILBOX_WORK__
 #endif
+#endif
 
 /*****************************************************************************
   1 ͷļ
@@ -76,6 +80,8 @@ __DRV_AUDIO_MAILBOX_WORK__   : leave mailbox's work to workqueue
 #include <linux/kernel.h>
 #include <linux/mutex.h>
 #include <linux/proc_fs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -176,6 +182,19 @@ static const unsigned int freq[] = {
 
 static u64 hi6620_pcm_dmamask           = (u64)(0xffffffff);
 
+/* timer scheduled readers need a position finer than a period */
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+#define HI6620_PCM_INFO_NO_PERIOD_WAKEUP    SNDRV_PCM_INFO_NO_PERIOD_WAKEUP
+#else
+#define HI6620_PCM_INFO_NO_PERIOD_WAKEUP    0
+#endif
+
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+/* DMA position words published by HIFI, read by the pointer callback */
+static struct hi6620_pcm_dma_pos *hi6620_dma_pos = NULL;
+static dma_addr_t hi6620_dma_pos_phys            = 0;
+#endif
+
 struct proc_dir_entry *audio_pcm_dir    = NULL;
 
 static struct snd_soc_dai_driver hi6620_dai[] =
@@ -234,6 +253,7 @@ static const struct snd_pcm_hardware hi6620_hardware_playback =
                       | SNDRV_PCM_INFO_NONINTERLEAVED
                       | SNDRV_PCM_INFO_MMAP
                       | SNDRV_PCM_INFO_MMAP_VALID
+                      | HI6620_PCM_INFO_NO_PERIOD_WAKEUP
                       | SNDRV_PCM_INFO_PAUSE,
     .formats          = SNDRV_PCM_FMTBIT_S16_LE,
     .channels_min     = HI6620_PB_MIN_CHANNELS,
@@ -249,7 +269,10 @@ static const struct snd_pcm_hardware hi6620_hardware_playback =
 /* define the capability of capture channel */
 static const struct snd_pcm_hardware hi6620_hardware_capture =
 {
-    .info             = SNDRV_PCM_INFO_INTERLEAVED,
+    .info             = SNDRV_PCM_INFO_INTERLEAVED
+                      | SNDRV_PCM_INFO_MMAP
+                      | SNDRV_PCM_INFO_MMAP_VALID
+                      | HI6620_PCM_INFO_NO_PERIOD_WAKEUP,
     .formats          = SNDRV_PCM_FMTBIT_S16_LE,
     .rates            = SNDRV_PCM_RATE_48000,
     .channels_min     = HI6620_CP_MIN_CHANNELS,
@@ -294,10 +317,41 @@ static u32 pcm_pb_status_open = 0;
 DEFINE_SEMAPHORE(g_pcm_cp_open_sem);
 DEFINE_SEMAPHORE(g_pcm_pb_open_sem);
 
+#ifdef __DRV_AUDIO_MAILBOX_WORK__
+#define PCM_INTR_LOCK(sem)      (void)down_interruptible(sem)
+#define PCM_INTR_UNLOCK(sem)    up(sem)
+#else
+/*
+ * period elapsed is handled in the mailbox callback, which may run in
+ * tasklet context, so the open status is also guarded by a spinlock
+ */
+static DEFINE_SPINLOCK(g_pcm_open_lock);
+#define PCM_INTR_LOCK(sem)      spin_lock(&g_pcm_open_lock)
+#define PCM_INTR_UNLOCK(sem)    spin_unlock(&g_pcm_open_lock)
+#endif
+
+/* indexed by SNDRV_PCM_STREAM_PLAYBACK / SNDRV_PCM_STREAM_CAPTURE */
+static struct hi6620_pcm_latency_stat hi6620_latency_stat[2];
+
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+/*
+ * mailbox_send_msg() refuses to send from interrupt context, so the
+ * period elapsed handling stays in the mailbox tasklet and the SET_BUF and
+ * trigger requests raised there are queued in order and sent from this
+ * high priority workqueue
+ */
+static struct workqueue_struct *hi6620_set_buf_wq;
+static struct hi6620_pcm_msg_queue hi6620_msg_queue[2];
+#endif
+
 /*****************************************************************************
   3 
 *****************************************************************************/
 STATIC int hi6620_notify_pcm_set_buf( struct snd_pcm_substream *substream );
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+STATIC int hi6620_notify_pcm_trigger( int cmd,
+                                        struct snd_pcm_substream *substream );
+#endif
 #ifdef CONFIG_SND_TEST_AUDIO_PCM_LOOP
 STATIC irq_rt_t hi6620_notify_recv_isr( void *usr_para, void *mail_handle,  unsigned int mail_len );
 #endif
@@ -400,6 +454,235 @@ void pcm_mailbox_work_func(struct work_struct *work)
 
 #endif
 
+/*****************************************************************************
+     : hi6620_pcm_set_open_status
+   : PCMͨ״̬period elapsedͬ
+   : u32 *status    : pcm_pb_status_openpcm_cp_status_open
+             u32 value      : 0 ر, 1 
+   : 
+   ֵ  : 
+ ú  : hi6620_pcm_open()hi6620_pcm_close()
+   :
+*****************************************************************************/
+STATIC void hi6620_pcm_set_open_status(u32 *status, u32 value)
+{
+#ifdef __DRV_AUDIO_MAILBOX_WORK__
+    *status = value;
+#else
+    spin_lock_bh(&g_pcm_open_lock);
+    *status = value;
+    spin_unlock_bh(&g_pcm_open_lock);
+#endif
+}
+
+/*****************************************************************************
+     : hi6620_pcm_record_elapsed
+   : ͳƱperiod elapsedڵƫ붶ֱͼ
+   : struct snd_pcm_substream *substream
+             struct hi6620_runtime_data *prtd
+   : 
+   ֵ  : 
+ ú  : hi6620_intr_handle_pb()hi6620_intr_handle_cp()
+   :
+*****************************************************************************/
+STATIC void hi6620_pcm_record_elapsed(struct snd_pcm_substream *substream,
+                                        struct hi6620_runtime_data *prtd)
+{
+    struct hi6620_pcm_latency_stat *stat    = &hi6620_latency_stat[substream->stream];
+    ktime_t now                             = ktime_get();
+    unsigned int jitter_us                  = 0;
+    unsigned int bucket                     = 0;
+
+    stat->elapsed++;
+
+    if ((0 != prtd->last_elapsed.tv64) && (0 != prtd->period_time_us))
+    {
+        jitter_us = (unsigned int)abs64(ktime_us_delta(now, prtd->last_elapsed)
+                                        - (s64)prtd->period_time_us);
+        bucket = min_t(unsigned int, fls(jitter_us), HI6620_JITTER_BUCKETS - 1);
+        stat->jitter_hist[bucket]++;
+        if (jitter_us > stat->max_jitter_us)
+            stat->max_jitter_us = jitter_us;
+    }
+
+    prtd->last_elapsed = now;
+}
+
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+/*****************************************************************************
+     : hi6620_pcm_send_msg
+   : ڽзһŶӵ
+   : struct snd_pcm_substream *substream
+             int msg : HI6620_PCM_MSG_SET_BUF  SNDRV_PCM_TRIGGER_*
+   : 
+   ֵ  : 
+ ú  : hi6620_pcm_msg_work_func()
+   : hi6620_notify_pcm_set_buf()hi6620_notify_pcm_trigger()
+*****************************************************************************/
+STATIC void hi6620_pcm_send_msg(struct snd_pcm_substream *substream, int msg)
+{
+    struct hi6620_runtime_data *prtd        =
+                (struct hi6620_runtime_data *)substream->runtime->private_data;
+    int ret                                 = OK;
+
+    if (HI6620_PCM_MSG_SET_BUF == msg)
+    {
+        if (STATUS_RUNNING != prtd->status)
+        {
+            logd("dma stopped\n");
+            return;
+        }
+
+        ret = hi6620_notify_pcm_set_buf( substream );
+        if( ret < 0 )
+        {
+            loge("hi6620_notify_pcm_set_buf(ret=%d)\n", ret);
+            return;
+        }
+
+        spin_lock_bh(&prtd->lock);
+        prtd->period_next = (prtd->period_next + 1) % substream->runtime->periods;
+        spin_unlock_bh(&prtd->lock);
+        return;
+    }
+
+    /* STATUS_STOPPING was already set when a stop was queued */
+    ret = hi6620_notify_pcm_trigger( msg, substream );
+    if ( ret < 0 )
+    {
+        loge("hi6620_notify_pcm_trigger ret : %d\n", ret);
+        return;
+    }
+
+    if ((SNDRV_PCM_TRIGGER_START == msg)
+        || (SNDRV_PCM_TRIGGER_RESUME == msg)
+        || (SNDRV_PCM_TRIGGER_PAUSE_RELEASE == msg))
+    {
+        spin_lock_bh(&prtd->lock);
+        prtd->status = STATUS_RUNNING;
+        prtd->period_next = (prtd->period_next + 1) % substream->runtime->periods;
+        prtd->last_elapsed = ktime_set(0, 0);
+        spin_unlock_bh(&prtd->lock);
+    }
+}
+
+/*****************************************************************************
+     : hi6620_pcm_msg_work_func
+   : ڽа˳һstreamŶӵȫ
+   : struct work_struct *work
+   : 
+   ֵ  : 
+ ú  : hi6620_pcm_queue_msg()
+   : hi6620_pcm_send_msg()
+*****************************************************************************/
+STATIC void hi6620_pcm_msg_work_func(struct work_struct *work)
+{
+    struct hi6620_pcm_msg_queue *priv =
+            container_of(work, struct hi6620_pcm_msg_queue, work);
+    struct snd_pcm_substream *substream     = NULL;
+    struct semaphore *open_sem              = NULL;
+    u32 *open_status                        = NULL;
+    unsigned long flags                     = 0;
+    int msg                                 = 0;
+
+    if (SNDRV_PCM_STREAM_PLAYBACK == priv->pcm_mode)
+    {
+        open_sem    = &g_pcm_pb_open_sem;
+        open_status = &pcm_pb_status_open;
+    }
+    else
+    {
+        open_sem    = &g_pcm_cp_open_sem;
+        open_status = &pcm_cp_status_open;
+    }
+
+    /* SEM used to protect close while sending the requests */
+    down(open_sem);
+
+    for (;;)
+    {
+        spin_lock_irqsave(&priv->lock, flags);
+        if (priv->head == priv->tail)
+        {
+            spin_unlock_irqrestore(&priv->lock, flags);
+            break;
+        }
+        msg = priv->msg[priv->tail % HI6620_PCM_MSG_QUEUE_LEN];
+        priv->tail++;
+        substream = priv->substream;
+        spin_unlock_irqrestore(&priv->lock, flags);
+
+        /* requests of a closed stream are dropped, not sent */
+        if ((0 == *open_status) || (NULL == substream)
+            || (NULL == substream->runtime)
+            || (NULL == substream->runtime->private_data))
+        {
+            logd("pcm closed, drop msg %d\n", msg);
+            continue;
+        }
+
+        hi6620_pcm_send_msg(substream, msg);
+    }
+
+    up(open_sem);
+}
+
+/*****************************************************************************
+     : hi6620_pcm_queue_msg
+   : period elapsedtaskletдʱ˳нз
+   : struct snd_pcm_substream *substream
+             int msg : HI6620_PCM_MSG_SET_BUF  SNDRV_PCM_TRIGGER_*
+   : 
+   ֵ  : OK  -EBUSY
+ ú  : hi6620_intr_handle_pb()hi6620_intr_handle_cp()
+             hi6620_pcm_hifi_trigger()
+   :
+*****************************************************************************/
+STATIC int hi6620_pcm_queue_msg(struct snd_pcm_substream *substream, int msg)
+{
+    struct hi6620_pcm_msg_queue *priv = &hi6620_msg_queue[substream->stream];
+    unsigned long flags               = 0;
+
+    spin_lock_irqsave(&priv->lock, flags);
+    if (HI6620_PCM_MSG_QUEUE_LEN == priv->head - priv->tail)
+    {
+        spin_unlock_irqrestore(&priv->lock, flags);
+        loge("msg queue full, drop msg %d\n", msg);
+        return -EBUSY;
+    }
+    priv->substream = substream;
+    priv->msg[priv->head % HI6620_PCM_MSG_QUEUE_LEN] = msg;
+    priv->head++;
+    spin_unlock_irqrestore(&priv->lock, flags);
+
+    queue_work(hi6620_set_buf_wq, &priv->work);
+
+    return OK;
+}
+
+/*****************************************************************************
+     : hi6620_pcm_msg_pending
+   : ѯstreamǷδ͵
+   : struct snd_pcm_substream *substream
+   : 
+   ֵ  : bool
+ ú  : hi6620_pcm_hifi_trigger()
+   :
+*****************************************************************************/
+STATIC bool hi6620_pcm_msg_pending(struct snd_pcm_substream *substream)
+{
+    struct hi6620_pcm_msg_queue *priv = &hi6620_msg_queue[substream->stream];
+    unsigned long flags               = 0;
+    bool pending                      = false;
+
+    spin_lock_irqsave(&priv->lock, flags);
+    pending = (priv->head != priv->tail);
+    spin_unlock_irqrestore(&priv->lock, flags);
+
+    return pending;
+}
+#endif
+
 /*****************************************************************************
      : hi6620_intr_handle_pb
    : PLAYBACK֧, ˼ͨһݴɺĴ
@@ -453,8 +736,15 @@ STATIC irq_rt_t hi6620_intr_handle_pb(struct snd_pcm_substream *substream)
     prtd->period_cur = (prtd->period_cur) % num_period;
     spin_unlock(&prtd->lock);
 
+    hi6620_pcm_record_elapsed(substream, prtd);
+
     snd_pcm_period_elapsed(substream);
 
+    if (SNDRV_PCM_STATE_XRUN == substream->runtime->status->state)
+    {
+        hi6620_latency_stat[SNDRV_PCM_STREAM_PLAYBACK].xrun++;
+    }
+
     if (STATUS_RUNNING != prtd->status)
     {
         logd("End, dma stopped\n");
@@ -464,6 +754,7 @@ STATIC irq_rt_t hi6620_intr_handle_pb(struct snd_pcm_substream *substream)
     avail = (snd_pcm_uframes_t)snd_pcm_playback_hw_avail(substream->runtime);
     if(avail < rt_period_size)
     {
+        hi6620_latency_stat[SNDRV_PCM_STREAM_PLAYBACK].underrun++;
         logd("End, avail(%d)< rt_period_size(%d)\n", avail, rt_period_size);
         return IRQ_HDD_SIZE;
     }
@@ -473,6 +764,9 @@ STATIC irq_rt_t hi6620_intr_handle_pb(struct snd_pcm_substream *substream)
         DMA˽жϣݿɰʱʹµDMA
          MailBox֪ͨHIFIһεDMA
         */
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+        (void)hi6620_pcm_queue_msg(substream, HI6620_PCM_MSG_SET_BUF);
+#else
         ret = hi6620_notify_pcm_set_buf( substream );
         if( ret < 0 )
         {
@@ -483,6 +777,7 @@ STATIC irq_rt_t hi6620_intr_handle_pb(struct snd_pcm_substream *substream)
         spin_lock(&prtd->lock);
         prtd->period_next = (prtd->period_next + 1) % num_period;
         spin_unlock(&prtd->lock);
+#endif
     }
 
     logd("End\r\n");
@@ -546,11 +841,19 @@ STATIC irq_rt_t hi6620_intr_handle_cp(struct snd_pcm_substream *substream)
         return IRQ_HDD_STATUS;
     }
 
+    hi6620_pcm_record_elapsed(substream, prtd);
+
     snd_pcm_period_elapsed(substream);
 
+    if (SNDRV_PCM_STATE_XRUN == substream->runtime->status->state)
+    {
+        hi6620_latency_stat[SNDRV_PCM_STREAM_CAPTURE].xrun++;
+    }
+
     avail = (snd_pcm_uframes_t)snd_pcm_capture_hw_avail(substream->runtime);
     if(avail < rt_period_size)
     {
+        hi6620_latency_stat[SNDRV_PCM_STREAM_CAPTURE].underrun++;
         logd("avail(%d)< rt_period_size(%d)\n", avail, rt_period_size);
         return IRQ_HDD_SIZE;
     }
@@ -560,6 +863,9 @@ STATIC irq_rt_t hi6620_intr_handle_cp(struct snd_pcm_substream *substream)
         DMA˽жϣݿɰʱʹµDMA
          MailBox֪ͨHIFIһεDMA
         */
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+        (void)hi6620_pcm_queue_msg(substream, HI6620_PCM_MSG_SET_BUF);
+#else
         ret = hi6620_notify_pcm_set_buf( substream );
         if( ret < 0 )
         {
@@ -570,6 +876,7 @@ STATIC irq_rt_t hi6620_intr_handle_cp(struct snd_pcm_substream *substream)
         spin_lock(&prtd->lock);
         prtd->period_next = (prtd->period_next + 1) % num_period;
         spin_unlock(&prtd->lock);
+#endif
     }
 
     logd("End\r\n");
@@ -603,16 +910,16 @@ STATIC irq_rt_t hi6620_mb_intr_handle(unsigned short pcm_mode,
         if ( NULL != substream)
         {
             /* SEM used to protect close while doing _intr_handle_pb */
-            ret = down_interruptible(&g_pcm_pb_open_sem);
+            PCM_INTR_LOCK(&g_pcm_pb_open_sem);
             if (0 == pcm_pb_status_open)
             {
                 logd("pcm playback closed\n");
-                up(&g_pcm_pb_open_sem);
+                PCM_INTR_UNLOCK(&g_pcm_pb_open_sem);
                 return IRQ_HDD;
             }
 
             ret = hi6620_intr_handle_pb(substream);
-            up(&g_pcm_pb_open_sem);
+            PCM_INTR_UNLOCK(&g_pcm_pb_open_sem);
         }
         else
         {
@@ -624,16 +931,16 @@ STATIC irq_rt_t hi6620_mb_intr_handle(unsigned short pcm_mode,
         if ( NULL != substream)
         {
             /* SEM used to protect close while doing _intr_handle_cp */
-            ret = down_interruptible(&g_pcm_cp_open_sem);
+            PCM_INTR_LOCK(&g_pcm_cp_open_sem);
 
             if (0 == pcm_cp_status_open)
             {
                 logd("pcm capture closed\n");
-                up(&g_pcm_cp_open_sem);
+                PCM_INTR_UNLOCK(&g_pcm_cp_open_sem);
                 return IRQ_HDD;
             }
             ret = hi6620_intr_handle_cp(substream);
-            up(&g_pcm_cp_open_sem);
+            PCM_INTR_UNLOCK(&g_pcm_cp_open_sem);
         }
         else
         {
@@ -1018,6 +1325,53 @@ STATIC int hi6620_notify_pcm_set_buf( struct snd_pcm_substream *substream )
     return ret;
 }
 
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+/*****************************************************************************
+     : hi6620_notify_pcm_pointer
+   : ˼ͨŸ֪HIFI DMAλùֵַHIFIDMA˹
+             ǰλдù֣pointerصֱӶȡ
+   : unsigned short pcm_mode : PLAYBACK or CAPTURE
+   : 
+   ֵ  : STATIC int, 0 for Success; Others for error
+ ú  : hi6620_pcm_hifi_hw_params()
+   :
+*****************************************************************************/
+STATIC int hi6620_notify_pcm_pointer( unsigned short pcm_mode )
+{
+    struct hifi_chn_pcm_pointer msg_body    = { 0 };
+    int ret                                 = OK;
+
+    if ( (SNDRV_PCM_STREAM_PLAYBACK != pcm_mode) &&
+            (SNDRV_PCM_STREAM_CAPTURE != pcm_mode) )
+    {
+        loge("pcm_mode=%d\n", pcm_mode);
+        return -EINVAL;
+    }
+
+    if (NULL == hi6620_dma_pos)
+    {
+        return -ENOMEM;
+    }
+
+    hi6620_dma_pos->pos[pcm_mode] = HI6620_DMA_POS_INVALID;
+
+    msg_body.msg_type   = (unsigned short)HI_CHN_MSG_PCM_POINTER;
+    msg_body.pcm_mode   = pcm_mode;
+    msg_body.pos_addr   = (unsigned int)(hi6620_dma_pos_phys
+                            + pcm_mode * sizeof(hi6620_dma_pos->pos[0]));
+
+    /* mail-box send */
+    ret = hi6620_mailbox_send_data( &msg_body, sizeof(struct hifi_chn_pcm_pointer), 0 );
+    if( OK != ret )
+    {
+        ret = -EBUSY;
+    }
+    logi("mailbox ret=%d\r\n", ret);
+
+    return ret;
+}
+#endif
+
 /*****************************************************************************
      : hi6620_notify_recv_isr
    : ˼ͨϢյݰݣӦ
@@ -1107,6 +1461,21 @@ STATIC irq_rt_t hi6620_notify_recv_isr( void *usr_para, void *mail_handle,  unsi
             loge("ret : %d\n", ret);
         }
         break;
+    case HI_CHN_MSG_PCM_PERIOD_STOP:
+        substream = mail_buf.substream;
+        spin_lock(&g_pcm_open_lock);
+        if ((NULL != substream) && (NULL != substream->runtime))
+        {
+            prtd = (struct hi6620_runtime_data *)substream->runtime->private_data;
+            if ((NULL != prtd) && (STATUS_STOPPING == prtd->status))
+            {
+                prtd->status = STATUS_STOP;
+                logi("stop now !\n");
+            }
+        }
+        spin_unlock(&g_pcm_open_lock);
+        ret = IRQ_HDD;
+        break;
     default:
         ret = IRQ_NH_TYPE;
         /*ϢͲӦ*/
@@ -1198,6 +1567,8 @@ STATIC int hi6620_pcm_hifi_hw_params(struct snd_pcm_substream *substream,
     }
     prtd->period_size = params_period_bytes(params);
     prtd->period_next = 0;
+    prtd->period_time_us = (unsigned int)div_u64((u64)params_period_size(params) * USEC_PER_SEC,
+                                                 params_rate(params));
 
     /* ͨ˼ͨŸ֪HIFIhw_params */
     ret = hi6620_notify_pcm_hw_params( (unsigned short)substream->stream, params );
@@ -1210,6 +1581,14 @@ STATIC int hi6620_pcm_hifi_hw_params(struct snd_pcm_substream *substream,
         return ret;
     }
 
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+    /* λùֲʱpointer˵period㣬Ӱ */
+    if ( hi6620_notify_pcm_pointer( (unsigned short)substream->stream ) < 0 )
+    {
+        logi("dma position word not available, use period position\n");
+    }
+#endif
+
     OUT_FUNCTION;
 
     return ret;
@@ -1263,6 +1642,14 @@ STATIC int hi6620_pcm_hifi_prepare(struct snd_pcm_substream *substream)
     prtd->status        = STATUS_STOP;
     prtd->period_next   = 0;
     prtd->period_cur    = 0;
+    prtd->last_elapsed  = ktime_set(0, 0);
+
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+    if (NULL != hi6620_dma_pos)
+    {
+        hi6620_dma_pos->pos[substream->stream] = HI6620_DMA_POS_INVALID;
+    }
+#endif
     return ret;
 }
 
@@ -1296,6 +1683,41 @@ STATIC int hi6620_pcm_hifi_trigger(int cmd, struct snd_pcm_substream *substream)
     logd("entry : %s, cmd : %d\n", substream->stream == SNDRV_PCM_STREAM_PLAYBACK
             ? "PLAYBACK" : "CAPTURE", cmd);
 
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+    /*
+     * XRUN and drain stop the stream from snd_pcm_period_elapsed() in the
+     * mailbox tasklet, where the mailbox can't send; queue the command then,
+     * and also while earlier requests are queued so HIFI gets them in order
+     */
+    if (in_interrupt() || hi6620_pcm_msg_pending(substream))
+    {
+        switch (cmd)
+        {
+        case SNDRV_PCM_TRIGGER_STOP:
+        case SNDRV_PCM_TRIGGER_SUSPEND:
+        case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+            spin_lock(&prtd->lock);
+            prtd->status = STATUS_STOPPING;
+            spin_unlock(&prtd->lock);
+            /* fall through */
+        case SNDRV_PCM_TRIGGER_START:
+        case SNDRV_PCM_TRIGGER_RESUME:
+        case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+            ret = hi6620_pcm_queue_msg(substream, cmd);
+            break;
+
+        default:
+            loge("cmd error : %d", cmd);
+            ret = -EINVAL;
+            break;
+        }
+
+        OUT_FUNCTION;
+
+        return ret;
+    }
+#endif
+
     switch (cmd)
     {
     case SNDRV_PCM_TRIGGER_START:
@@ -1313,6 +1735,7 @@ STATIC int hi6620_pcm_hifi_trigger(int cmd, struct snd_pcm_substream *substream)
             spin_lock(&prtd->lock);
             prtd->status = STATUS_RUNNING;
             prtd->period_next = (prtd->period_next + 1) % num_periods;
+            prtd->last_elapsed = ktime_set(0, 0);
             spin_unlock(&prtd->lock);
         }
         break;
@@ -1366,6 +1789,19 @@ STATIC snd_pcm_uframes_t hi6620_pcm_hifi_pointer(struct snd_pcm_substream *subst
     struct hi6620_runtime_data *prtd        =
                 (struct hi6620_runtime_data *)substream->runtime->private_data;
     long frame                     = 0L;
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+    unsigned int pos               = HI6620_DMA_POS_INVALID;
+
+    /* HIFIDMAλʱֱӶȡɵperiod */
+    if (NULL != hi6620_dma_pos)
+    {
+        pos = hi6620_dma_pos->pos[substream->stream];
+        if (pos < snd_pcm_lib_buffer_bytes(substream))
+        {
+            return bytes_to_frames(runtime, pos);
+        }
+    }
+#endif
 
     frame = bytes_to_frames(runtime, prtd->period_cur * prtd->period_size);
     if(frame >= runtime->buffer_size)
@@ -1411,6 +1847,8 @@ STATIC int hi6620_pcm_hifi_open(struct snd_pcm_substream *substream)
 
     substream->runtime->private_data = prtd;
 
+    memset(&hi6620_latency_stat[substream->stream], 0, sizeof(struct hi6620_pcm_latency_stat));
+
     if (SNDRV_PCM_STREAM_PLAYBACK == substream->stream)
         snd_soc_set_runtime_hwparams(substream, &hi6620_hardware_playback);
     else
@@ -1488,6 +1926,10 @@ static int hi6620_pcm_hw_free(struct snd_pcm_substream *substream)
     prtd    = (struct hi6620_runtime_data *)substream->runtime->private_data;
 
     if (substream->pcm->device == 0){
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+        /* a stop queued from the tasklet must reach HIFI before waiting */
+        flush_work_sync(&hi6620_msg_queue[substream->stream].work);
+#endif
         for(i = 0; i < 30 ; i++){  /* wait for dma ok */
             if (STATUS_STOP == prtd->status){
                 break;
@@ -1500,6 +1942,9 @@ static int hi6620_pcm_hw_free(struct snd_pcm_substream *substream)
         }
 #ifdef  __DRV_AUDIO_MAILBOX_WORK__
         flush_workqueue(hi6620_pcm_mailbox_workqueue.pcm_mailbox_delay_wq);
+#endif
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+        flush_work_sync(&hi6620_msg_queue[substream->stream].work);
 #endif
         ret = hi6620_pcm_hifi_hw_free(substream);
     }
@@ -1538,13 +1983,13 @@ static int hi6620_pcm_open(struct snd_pcm_substream *substream)
         if(SNDRV_PCM_STREAM_CAPTURE == substream->stream)
         {
             ret = down_interruptible(&g_pcm_cp_open_sem);
-            pcm_cp_status_open = (u32)1;
+            hi6620_pcm_set_open_status(&pcm_cp_status_open, (u32)1);
             up(&g_pcm_cp_open_sem);
         }
         else if(SNDRV_PCM_STREAM_PLAYBACK == substream->stream)
         {
             ret = down_interruptible(&g_pcm_pb_open_sem);
-            pcm_pb_status_open = (u32)1;
+            hi6620_pcm_set_open_status(&pcm_pb_status_open, (u32)1);
             up(&g_pcm_pb_open_sem);
         }
         else
@@ -1569,14 +2014,14 @@ static int hi6620_pcm_close(struct snd_pcm_substream *substream)
         if(SNDRV_PCM_STREAM_CAPTURE == substream->stream)
         {
             ret = down_interruptible(&g_pcm_cp_open_sem);
-            pcm_cp_status_open = (u32)0;
+            hi6620_pcm_set_open_status(&pcm_cp_status_open, (u32)0);
             ret = hi6620_pcm_hifi_close(substream);
             up(&g_pcm_cp_open_sem);
         }
         else if(SNDRV_PCM_STREAM_PLAYBACK == substream->stream)
         {
             ret = down_interruptible(&g_pcm_pb_open_sem);
-            pcm_pb_status_open = (u32)0;
+            hi6620_pcm_set_open_status(&pcm_pb_status_open, (u32)0);
             ret = hi6620_pcm_hifi_close(substream);
             up(&g_pcm_pb_open_sem);
         }
@@ -1629,12 +2074,34 @@ STATIC int hi6620_pcm_new(struct snd_card *card,
         }
         logi("pcm->device = 0\n");
 
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+        hi6620_dma_pos = dma_alloc_coherent(pcm->card->dev, sizeof(struct hi6620_pcm_dma_pos),
+                                            &hi6620_dma_pos_phys, GFP_KERNEL);
+        if (NULL == hi6620_dma_pos)
+        {
+            logi("dma position word alloc failed, use period position\n");
+        }
+        else
+        {
+            hi6620_dma_pos->pos[SNDRV_PCM_STREAM_PLAYBACK] = HI6620_DMA_POS_INVALID;
+            hi6620_dma_pos->pos[SNDRV_PCM_STREAM_CAPTURE]  = HI6620_DMA_POS_INVALID;
+        }
+#endif
+
         /* ע˼ͨݽպ */
         ret = hi6620_notify_isr_register( (void *)hi6620_notify_recv_isr );
         if (ret)
         {
             loge("notify Isr register error : %d\n", ret);
             snd_pcm_lib_preallocate_free_for_all(pcm);
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+            if (NULL != hi6620_dma_pos)
+            {
+                dma_free_coherent(pcm->card->dev, sizeof(struct hi6620_pcm_dma_pos),
+                                  (void *)hi6620_dma_pos, hi6620_dma_pos_phys);
+                hi6620_dma_pos = NULL;
+            }
+#endif
         }
     }
     else
@@ -1660,6 +2127,13 @@ static void hi6620_pcm_free(struct snd_pcm *pcm)
 
     if (pcm->device == 0) {
         logi("pcm->device = 0\n");
+#ifdef CONFIG_SND_HI6620_PCM_DMA_POS
+        if (NULL != hi6620_dma_pos) {
+            dma_free_coherent(pcm->card->dev, sizeof(struct hi6620_pcm_dma_pos),
+                              (void *)hi6620_dma_pos, hi6620_dma_pos_phys);
+            hi6620_dma_pos = NULL;
+        }
+#endif
     }
     snd_pcm_lib_preallocate_free_for_all(pcm);
 
@@ -1712,6 +2186,20 @@ static int __devinit hi6620_platform_probe(struct platform_device *pdev)
 /*  put INIT_DELAYED_WORK to open() function
     INIT_DELAYED_WORK(&hi6620_pcm_mailbox_workqueue.pcm_mailbox_delay_work, pcm_mailbox_work_func); */
 #endif
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+    hi6620_set_buf_wq = alloc_workqueue("pcm_set_buf_wq", WQ_HIGHPRI, 1);
+    if (!hi6620_set_buf_wq) {
+        pr_err("%s(%u) : workqueue create failed", __FUNCTION__,__LINE__);
+        ret = -ENOMEM;
+        goto pcm_set_buf_wq_failed;
+    }
+    INIT_WORK(&hi6620_msg_queue[SNDRV_PCM_STREAM_PLAYBACK].work, hi6620_pcm_msg_work_func);
+    spin_lock_init(&hi6620_msg_queue[SNDRV_PCM_STREAM_PLAYBACK].lock);
+    hi6620_msg_queue[SNDRV_PCM_STREAM_PLAYBACK].pcm_mode = SNDRV_PCM_STREAM_PLAYBACK;
+    INIT_WORK(&hi6620_msg_queue[SNDRV_PCM_STREAM_CAPTURE].work, hi6620_pcm_msg_work_func);
+    spin_lock_init(&hi6620_msg_queue[SNDRV_PCM_STREAM_CAPTURE].lock);
+    hi6620_msg_queue[SNDRV_PCM_STREAM_CAPTURE].pcm_mode = SNDRV_PCM_STREAM_CAPTURE;
+#endif
 
     OUT_FUNCTION;
 
@@ -1727,6 +2215,11 @@ pcm_mailbox_wq_failed:
     snd_soc_unregister_platform(&pdev->dev);
     snd_soc_unregister_dais(&pdev->dev, ARRAY_SIZE(hi6620_dai));
 #endif
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+pcm_set_buf_wq_failed:
+    snd_soc_unregister_platform(&pdev->dev);
+    snd_soc_unregister_dais(&pdev->dev, ARRAY_SIZE(hi6620_dai));
+#endif
 
 probe_failed:
 
@@ -1749,6 +2242,12 @@ static int __devexit hi6620_platform_remove(struct platform_device *pdev)
         destroy_workqueue(hi6620_pcm_mailbox_workqueue.pcm_mailbox_delay_wq);
     }
 #endif
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+    if(hi6620_set_buf_wq) {
+        flush_workqueue(hi6620_set_buf_wq);
+        destroy_workqueue(hi6620_set_buf_wq);
+    }
+#endif
 
     snd_soc_unregister_platform(&pdev->dev);
     snd_soc_unregister_dais(&pdev->dev, ARRAY_SIZE(hi6620_dai));
@@ -1795,6 +2294,33 @@ static int status_write_proc_hstatus(struct file *file, const char *buffer,
     return count;
 }
 
+static int latency_read_proc_hstatus(char *page, char **start, off_t offset,
+                    int count, int *eof, void *data)
+{
+    static const char *stream_name[] = { "playback", "capture" };
+    struct hi6620_pcm_latency_stat *stat = NULL;
+    int len = 0;
+    int i   = 0;
+    int j   = 0;
+
+    for (i = 0; i < ARRAY_SIZE(hi6620_latency_stat); i++)
+    {
+        stat = &hi6620_latency_stat[i];
+        len += sprintf(page + len, "%s: elapsed %u underrun %u xrun %u max_jitter %uus\n",
+                       stream_name[i], stat->elapsed, stat->underrun,
+                       stat->xrun, stat->max_jitter_us);
+        len += sprintf(page + len, "  jitter(us)");
+        for (j = 0; j < HI6620_JITTER_BUCKETS; j++)
+        {
+            len += sprintf(page + len, " <%u:%u", 1U << j, stat->jitter_hist[j]);
+        }
+        len += sprintf(page + len, "\n");
+    }
+
+    *eof = 1;
+    return len;
+}
+
 static int __init hi6620_init(void)
 {
     struct proc_dir_entry *ent;
@@ -1815,12 +2341,20 @@ static int __init hi6620_init(void)
     ent->read_proc = status_read_proc_hstatus;
     ent->write_proc = status_write_proc_hstatus;
 
+    /* Creating read only "latency" entry */
+    ent = create_proc_read_entry("latency", 0444, audio_pcm_dir,
+                                 latency_read_proc_hstatus, NULL);
+    if (ent == NULL) {
+        loge("Unable to create /proc/hpcm/latency entry");
+    }
+
     return platform_driver_register(&hi6620_platform_driver);
 }
 module_init(hi6620_init);
 
 static void __exit hi6620_exit(void)
 {
+    remove_proc_entry("latency", audio_pcm_dir);
     remove_proc_entry("status", audio_pcm_dir);
 
     platform_driver_unregister(&hi6620_platform_driver);
@@ -177,6 +177,35 @@ struct hi6620_simu_pcm_data
 };
 #endif
 
+/* period elapsed timing statistic of one stream, shown in /proc/hpcm/latency */
+#define HI6620_JITTER_BUCKETS   ( 16 )
+
+struct hi6620_pcm_latency_stat
+{
+    unsigned int    elapsed;        /* period elapsed count */
+    unsigned int    underrun;       /* no period queued when DSP finished one (overrun for capture) */
+    unsigned int    xrun;           /* stream stopped with XRUN in period elapsed */
+    unsigned int    max_jitter_us;  /* max deviation from nominal period time */
+    unsigned int    jitter_hist[HI6620_JITTER_BUCKETS]; /* bucket n : [2^(n-1), 2^n) us */
+};
+
+#ifdef CONFIG_SND_HI6620_PCM_FAST_PATH
+/* mailbox requests of one stream, queued in tasklet context and sent from process context */
+#define HI6620_PCM_MSG_QUEUE_LEN    ( 64 )      /* power of 2, > HI6620_MAX_PERIODS */
+#define HI6620_PCM_MSG_SET_BUF      ( -1 )      /* other entries are SNDRV_PCM_TRIGGER_* */
+
+struct hi6620_pcm_msg_queue
+{
+    struct work_struct          work;
+    spinlock_t                  lock;
+    struct snd_pcm_substream   *substream;
+    unsigned short              pcm_mode;   /* PLAYBACK  CAPTURE */
+    unsigned int                head;       /* next entry to fill */
+    unsigned int                tail;       /* next entry to send */
+    int                         msg[HI6620_PCM_MSG_QUEUE_LEN];
+};
+#endif
+
 #ifdef __DRV_AUDIO_MAILBOX_WORK__
 struct hi6620_pcm_mailbox_wq
 {
@@ -202,6 +231,8 @@ struct hi6620_runtime_data
     unsigned int        period_next;  /* record which period to fix dma next time */
     unsigned int        period_cur;   /* record which period using now */
     unsigned int        period_size;  /* DMA SIZE */
+    unsigned int        period_time_us; /* nominal period time */
+    ktime_t             last_elapsed; /* time of last period elapsed */
     enum HI6620_STATUS  status;       /* pcm status running or stop */
 #ifdef __DRV_AUDIO_MAILBOX_WORK__
     struct hi6620_pcm_mailbox_data hi6620_pcm_mailbox;
@@ -268,6 +299,21 @@ struct hifi_channel_set_buffer
     unsigned int    data_len;   /* ݳȣλByte */
 };
 
+/* AP˼ͨŴݸHIFIݣ֪HIFIDMAλõĹֵַ */
+struct hifi_chn_pcm_pointer
+{
+    HI_CHN_COMMON
+    unsigned int    pos_addr;   /* ַHIFIд뵱ǰDMAbufferеֽƫ */
+};
+
+/* HIFIDMAλãÿͨһ֣λһڴ */
+#define HI6620_DMA_POS_INVALID  ( 0xFFFFFFFF )
+
+struct hi6620_pcm_dma_pos
+{
+    volatile unsigned int   pos[2];     /* SNDRV_PCM_STREAM_PLAYBACK/CAPTUREΪ± */
+};
+
 /* HIFI˼ͨŴݸAPݣDMAݰɺ󴫵 */
 struct hifi_chn_pcm_period_elapsed
 {